@@ -0,0 +1,85 @@
+# Compares the PNG encoders behind `Blendend.Canvas.to_png/2`.
+#
+#     mix run bench/png_encode.exs [width] [height]
+#
+# Every row encodes the same canvas. The first row is Blend2D's own PNG
+# codec (`Blendend.Native.canvas_to_png/1`), the baseline every option is
+# measured against; the others go through blendend's encoder. Times are the
+# median of several runs; sizes are the PNG byte count.
+
+alias Blendend.Canvas
+alias Blendend.Native
+alias Blendend.Style.Color
+
+{width, height} =
+  case System.argv() do
+    [w, h] -> {String.to_integer(w), String.to_integer(h)}
+    _ -> {1024, 768}
+  end
+
+runs = 7
+
+# A mix of flat areas, antialiased edges and translucency, so neither the
+# filters nor zlib get an unrealistically easy input.
+:rand.seed(:exsss, {1, 2, 3})
+{:ok, canvas} = Canvas.new(width, height)
+:ok = Canvas.clear(canvas, fill: Color.rgb!(245, 240, 230))
+
+channel = fn -> :rand.uniform(256) - 1 end
+
+for _ <- 1..400 do
+  color = Color.rgb!(channel.(), channel.(), channel.(), 95 + :rand.uniform(160))
+  {x, y, r} = {:rand.uniform() * width, :rand.uniform() * height, 4 + :rand.uniform() * 60}
+  :ok = Canvas.Fill.circle(canvas, x, y, r, fill: color)
+end
+
+median = fn times -> times |> Enum.sort() |> Enum.at(div(length(times), 2)) end
+
+measure = fn encode ->
+  {:ok, png} = encode.()
+
+  times =
+    for _ <- 1..runs do
+      {us, {:ok, _}} = :timer.tc(encode)
+      us
+    end
+
+  {median.(times), byte_size(png)}
+end
+
+threads = :erlang.system_info(:dirty_cpu_schedulers_online)
+
+cases = [
+  {"Blend2D codec (baseline)", fn -> Native.canvas_to_png(canvas) end},
+  {"default (6, adaptive)", fn -> Native.canvas_to_png(canvas, threads: 1) end},
+  {"compression: 0", fn -> Native.canvas_to_png(canvas, compression: 0, threads: 1) end},
+  {"fast: true", fn -> Native.canvas_to_png(canvas, fast: true, threads: 1) end},
+  {"compression: 9", fn -> Native.canvas_to_png(canvas, compression: 9, threads: 1) end},
+  {"opaque: true", fn -> Native.canvas_to_png(canvas, opaque: true, threads: 1) end},
+  {"default, threads: #{threads}", fn -> Native.canvas_to_png(canvas, threads: threads) end},
+  {"fast: true, threads: #{threads}",
+   fn -> Native.canvas_to_png(canvas, fast: true, threads: threads) end}
+]
+
+{base_us, base_size} = measure.(elem(hd(cases), 1))
+
+IO.puts("#{width}x#{height} RGBA, median of #{runs} runs\n")
+
+IO.puts(
+  String.pad_trailing("encoder", 32) <>
+    String.pad_leading("time", 10) <>
+    String.pad_leading("size", 12) <>
+    String.pad_leading("time/base", 11) <> String.pad_leading("size/base", 11)
+)
+
+for {name, encode} <- cases do
+  {us, size} = if name =~ "baseline", do: {base_us, base_size}, else: measure.(encode)
+
+  IO.puts(
+    String.pad_trailing(name, 32) <>
+      String.pad_leading("#{Float.round(us / 1000, 1)} ms", 10) <>
+      String.pad_leading("#{size} B", 12) <>
+      String.pad_leading("#{Float.round(us / base_us, 2)}x", 11) <>
+      String.pad_leading("#{Float.round(size / base_size, 2)}x", 11)
+  )
+end
@@ -1,21 +1,76 @@
 #include "canvas.h"
 #include "../geometries/matrix2d.h"
+#include "../images/base64.h"
+#include "../images/file_sink.h"
 #include "../images/image.h"
+#include "../images/png_encoder.h"
+#include "../images/qoi_encoder.h"
 #include "../nif/nif_resource.h"
 #include "../nif/nif_util.h"
 #include "../styles/styles.h"
 
+#include <algorithm>
 #include <blend2d/blend2d.h>
 
+// Parses the optional keyword list of Canvas.new/3 into a context create info.
+//
+//   threads: n              -> worker threads used by the rendering context
+//                              (0 keeps the synchronous single-threaded mode)
+//   command_queue_limit: n  -> commands queued before a batch is handed to workers
+static bool parse_canvas_options(ErlNifEnv* env, ERL_NIF_TERM list, BLContextCreateInfo* ci)
+{
+  if(!enif_is_list(env, list))
+    return false;
+
+  ERL_NIF_TERM head, tail = list;
+  while(enif_get_list_cell(env, tail, &head, &tail)) {
+    int arity;
+    const ERL_NIF_TERM* tuple;
+    char key[32];
+    unsigned value;
+
+    if(!enif_get_tuple(env, head, &arity, &tuple) || arity != 2)
+      return false;
+    if(!enif_get_atom(env, tuple[0], key, sizeof(key), ERL_NIF_UTF8))
+      return false;
+    if(!enif_get_uint(env, tuple[1], &value))
+      return false;
+
+    if(std::strcmp(key, "threads") == 0) {
+      ci->thread_count = value;
+    }
+    else if(std::strcmp(key, "command_queue_limit") == 0) {
+      ci->command_queue_limit = value;
+    }
+    else {
+      return false;
+    }
+  }
+
+  // Blend2D may not be able to acquire the requested workers from its thread
+  // pool; render synchronously in that case instead of failing to begin.
+  if(ci->thread_count > 0)
+    ci->flags |= BL_CONTEXT_CREATE_FLAG_FALLBACK_TO_SYNC;
+
+  return true;
+}
+
 // Canvas.new(width, height)
+// Canvas.new(width, height, opts)
 ERL_NIF_TERM canvas_new(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
 {
   int w, h;
 
-  if(argc != 2 || !enif_get_int(env, argv[0], &w) || !enif_get_int(env, argv[1], &h)) {
+  if(argc < 2 || argc > 3 || !enif_get_int(env, argv[0], &w) ||
+     !enif_get_int(env, argv[1], &h)) {
     return make_result_error(env, "canvas_dimensions_must_be_integer");
   }
 
+  BLContextCreateInfo ci{};
+  if(argc == 3 && !parse_canvas_options(env, argv[2], &ci)) {
+    return make_result_error(env, "canvas_invalid_options");
+  }
+
   auto canvas = NifResource<Canvas>::alloc();
 
   BLResult r = canvas->img.create(w, h, BL_FORMAT_PRGB32);
@@ -24,19 +79,123 @@ ERL_NIF_TERM canvas_new(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
     return make_result_error(env, "canvas_image_create_failed");
   }
 
-  // 2) Begin a context on that image
-  BLContextCreateInfo ci{};
-
   BLResult rc = canvas->ctx.begin(canvas->img, &ci);
   if(rc != BL_SUCCESS) {
     canvas->destroy();
     return make_result_error(env, "canvas_context_begin_failed");
   }
+  canvas->create_info = ci;
+  canvas->size = canvas->img.size();
+
+  // A new canvas has never been exported; its first delta is the full frame.
+  canvas->dirty.add_all();
 
   ERL_NIF_TERM term = NifResource<Canvas>::make(env, canvas);
   return make_result_ok(env, term);
 }
 
+// canvas_clone(Canvas) -> {:ok, Canvas} | {:error, reason}
+//
+// A new canvas with a copy of the pixels and the same context options. The
+// rendering state (transform, clip, saved states) starts out fresh.
+ERL_NIF_TERM canvas_clone(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 1)
+    return enif_make_badarg(env);
+
+  auto src = NifResource<Canvas>::get(env, argv[0]);
+  if(src == nullptr)
+    return make_result_error(env, "canvas_clone_invalid_canvas");
+
+  auto canvas = NifResource<Canvas>::alloc();
+  if(canvas == nullptr)
+    return make_result_error(env, "canvas_clone_failed");
+
+  {
+    CanvasLock lock(src, CanvasLock::kRead);
+    if(!lock) {
+      enif_release_resource(canvas);
+      return make_result_error(env, "canvas_busy");
+    }
+
+    src->ctx.flush(BL_CONTEXT_FLUSH_SYNC);
+    if(canvas->img.assign_deep(src->img) != BL_SUCCESS) {
+      enif_release_resource(canvas);
+      return make_result_error(env, "canvas_clone_failed");
+    }
+    canvas->create_info = src->create_info;
+    canvas->size = src->size;
+  }
+
+  if(canvas->ctx.begin(canvas->img, &canvas->create_info) != BL_SUCCESS) {
+    enif_release_resource(canvas);
+    return make_result_error(env, "canvas_context_begin_failed");
+  }
+  canvas->dirty.add_all();
+
+  return make_result_ok(env, NifResource<Canvas>::make(env, canvas));
+}
+
+// canvas_to_image(Canvas, Format) -> {:ok, Image} | {:error, reason}
+//
+//   Format :: :prgb32 | :a8 (the alpha channel, for fill_mask)
+//
+// Copies the current pixels into a new image. The image does not change
+// when the canvas is drawn on afterwards.
+ERL_NIF_TERM canvas_to_image(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 2)
+    return enif_make_badarg(env);
+
+  auto canvas = NifResource<Canvas>::get(env, argv[0]);
+  if(canvas == nullptr)
+    return make_result_error(env, "canvas_to_image_invalid_canvas");
+
+  char format[8];
+  if(!enif_get_atom(env, argv[1], format, sizeof(format), ERL_NIF_UTF8) ||
+     (strcmp(format, "prgb32") != 0 && strcmp(format, "a8") != 0))
+    return make_result_error(env, "canvas_to_image_invalid_format");
+
+  CanvasLock lock(canvas, CanvasLock::kRead);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
+  canvas->ctx.flush(BL_CONTEXT_FLUSH_SYNC);
+
+  BLImage copy;
+  BLResult r;
+  if(strcmp(format, "prgb32") == 0) {
+    r = copy.assign_deep(canvas->img);
+  }
+  else {
+    BLSizeI sz = canvas->img.size();
+    BLImageData src{}, dst{};
+    r = copy.create(sz.w, sz.h, BL_FORMAT_A8);
+    if(r == BL_SUCCESS)
+      r = canvas->img.get_data(&src);
+    if(r == BL_SUCCESS)
+      r = copy.get_data(&dst);
+    if(r == BL_SUCCESS) {
+      for(int y = 0; y < sz.h; y++) {
+        const uint8_t* srow =
+            static_cast<const uint8_t*>(src.pixel_data) + intptr_t(y) * src.stride;
+        uint8_t* drow = static_cast<uint8_t*>(dst.pixel_data) + intptr_t(y) * dst.stride;
+        for(int x = 0; x < sz.w; x++)
+          drow[x] = srow[x * 4 + 3];
+      }
+    }
+  }
+  if(r != BL_SUCCESS)
+    return make_result_error(env, "canvas_to_image_failed");
+
+  auto img = NifResource<Image>::alloc();
+  if(img == nullptr)
+    return make_result_error(env, "canvas_to_image_failed");
+  img->value = std::move(copy);
+
+  return make_result_ok(env, NifResource<Image>::make(env, img));
+}
+
 ERL_NIF_TERM canvas_clear(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
 {
   if(argc < 1)
@@ -46,9 +205,15 @@ ERL_NIF_TERM canvas_clear(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
   if(!canvas)
     return make_result_error(env, "canvas_clear_invalid_canvas");
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   Style style{};
   parse_style(env, argv, argc, 1, &style);
 
+  canvas->dirty.add_all();
+
   if(!style.has_fill()) {
     canvas->ctx.clear_all();
     canvas->ctx.flush(BL_CONTEXT_FLUSH_SYNC);
@@ -75,7 +240,8 @@ ERL_NIF_TERM canvas_size(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
     return make_result_error(env, "invalid_canvas_resource");
   }
 
-  BLSizeI sz = canvas->img.size();
+  // The size never changes after canvas_new; no lock needed.
+  const BLSizeI sz = canvas->size;
 
   ERL_NIF_TERM width = enif_make_int(env, sz.w);
   ERL_NIF_TERM height = enif_make_int(env, sz.h);
@@ -91,6 +257,10 @@ ERL_NIF_TERM canvas_save_state(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv
   if(!canvas)
     return make_result_error(env, "canvas_save_state_invalid_canvas");
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   BLResult r = canvas->ctx.save();
   if(r != BL_SUCCESS)
     return make_result_error(env, "canvas_save_state_failed");
@@ -107,6 +277,10 @@ ERL_NIF_TERM canvas_restore_state(ErlNifEnv* env, int argc, const ERL_NIF_TERM a
   if(!canvas)
     return make_result_error(env, "canvas_restore_state_invalid_canvas");
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   BLResult r = canvas->ctx.restore();
   if(r != BL_SUCCESS)
     return make_result_error(env, "canvas_restore_state_failed");
@@ -124,6 +298,10 @@ ERL_NIF_TERM canvas_set_transform(ErlNifEnv* env, int argc, const ERL_NIF_TERM a
   if(!canvas || !mat)
     return make_result_error(env, "canvas_set_transform_invalid_args");
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   BLResult r = canvas->ctx.set_transform(mat->value);
   if(r != BL_SUCCESS)
     return make_result_error(env, "canvas_set_transform_failed");
@@ -140,6 +318,10 @@ ERL_NIF_TERM canvas_reset_transform(ErlNifEnv* env, int argc, const ERL_NIF_TERM
   if(!canvas)
     return make_result_error(env, "canvas_reset_transform_invalid_canvas");
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   BLResult r = canvas->ctx.reset_transform();
   if(r != BL_SUCCESS)
     return make_result_error(env, "canvas_reset_transform_failed");
@@ -159,6 +341,10 @@ ERL_NIF_TERM canvas_translate(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[
     return make_result_error(env, "canvas_translate_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   if(!enif_get_double(env, argv[1], &x) || !enif_get_double(env, argv[2], &y)) {
     return make_result_error(env, "canvas_translate_invalid_args");
   }
@@ -183,6 +369,10 @@ ERL_NIF_TERM canvas_post_translate(ErlNifEnv* env, int argc, const ERL_NIF_TERM
     return make_result_error(env, "canvas_post_translate_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   if(!enif_get_double(env, argv[1], &x) || !enif_get_double(env, argv[2], &y)) {
     return make_result_error(env, "canvas_post_translate_invalid_args");
   }
@@ -206,6 +396,10 @@ ERL_NIF_TERM canvas_scale(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
     return make_result_error(env, "canvas_scale_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   if(!enif_get_double(env, argv[1], &sx) || !enif_get_double(env, argv[2], &sy)) {
     return make_result_error(env, "canvas_scale_invalid_args");
   }
@@ -228,6 +422,10 @@ ERL_NIF_TERM canvas_rotate(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
     return make_result_error(env, "canvas_rotate_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   if(!enif_get_double(env, argv[1], &angle)) {
     return make_result_error(env, "canvas_rotate_invalid_angle");
   }
@@ -250,6 +448,10 @@ ERL_NIF_TERM canvas_rotate_at(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[
     return make_result_error(env, "canvas_rotate_at_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   if(!enif_get_double(env, argv[1], &angle) || !enif_get_double(env, argv[2], &cx) ||
      !enif_get_double(env, argv[3], &cy)) {
     return make_result_error(env, "canvas_rotate_at_invalid_args");
@@ -274,6 +476,10 @@ ERL_NIF_TERM canvas_skew(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
     return make_result_error(env, "canvas_skew_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   if(!enif_get_double(env, argv[1], &kx) || !enif_get_double(env, argv[2], &ky)) {
     return make_result_error(env, "canvas_skew_invalid_args");
   }
@@ -296,6 +502,10 @@ ERL_NIF_TERM canvas_post_rotate(ErlNifEnv* env, int argc, const ERL_NIF_TERM arg
     return make_result_error(env, "canvas_post_rotate_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   if(!enif_get_double(env, argv[1], &angle)) {
     return make_result_error(env, "canvas_post_rotate_invalid_angle");
   }
@@ -318,6 +528,10 @@ ERL_NIF_TERM canvas_post_rotate_at(ErlNifEnv* env, int argc, const ERL_NIF_TERM
     return make_result_error(env, "canvas_post_rotate_at_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   if(!enif_get_double(env, argv[1], &angle) || !enif_get_double(env, argv[2], &cx) ||
      !enif_get_double(env, argv[3], &cy)) {
     return make_result_error(env, "canvas_post_rotate_at_invalid_args");
@@ -340,6 +554,10 @@ ERL_NIF_TERM canvas_apply_transform(ErlNifEnv* env, int argc, const ERL_NIF_TERM
   if(!canvas || !mat)
     return make_result_error(env, "canvas_apply_transform_invalid_args");
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   BLResult res = canvas->ctx.apply_transform(mat->value);
   if(res != BL_SUCCESS)
     return make_result_error(env, "canvas_apply_transform_failed");
@@ -356,6 +574,10 @@ ERL_NIF_TERM canvas_user_transform(ErlNifEnv* env, int argc, const ERL_NIF_TERM
   if(!canvas)
     return make_result_error(env, "canvas_user_transform_invalid_canvas");
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   Matrix2D* mat = NifResource<Matrix2D>::alloc();
   if(!mat)
     return make_result_error(env, "canvas_user_transform_alloc_failed");
@@ -378,6 +600,10 @@ ERL_NIF_TERM canvas_clip_to_rect(ErlNifEnv* env, int argc, const ERL_NIF_TERM ar
     return make_result_error(env, "clip_to_rect_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   if(!enif_get_double(env, argv[1], &x) || !enif_get_double(env, argv[2], &y) ||
      !enif_get_double(env, argv[3], &w) || !enif_get_double(env, argv[4], &h)) {
     return enif_make_badarg(env);
@@ -386,6 +612,9 @@ ERL_NIF_TERM canvas_clip_to_rect(ErlNifEnv* env, int argc, const ERL_NIF_TERM ar
   BLResult r = canvas->ctx.clip_to_rect(BLRect(x, y, w, h));
   if(r != BL_SUCCESS)
     return make_result_error(env, "canvas_clip_to_rect_failed");
+  // Outside saved states and layers nothing undoes the clip any more.
+  if(canvas->layers.empty() && canvas->ctx.saved_state_count() == 0)
+    canvas->clipped = true;
 
   return enif_make_atom(env, "ok");
 }
@@ -403,11 +632,17 @@ ERL_NIF_TERM canvas_blit_image(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv
     return make_result_error(env, "canvas_blit_image_invalid_args");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   if(!enif_get_double(env, argv[2], &x) || !enif_get_double(env, argv[3], &y)) {
     return make_result_error(env, "canvas_blit_image_invalid_args");
   }
 
   BLResult r = canvas->ctx.blit_image(BLPoint(x, y), image->value);
+  BLSizeI sz = image->value.size();
+  canvas->dirty.add(canvas->ctx, BLBox(x, y, x + sz.w, y + sz.h));
   if(r != BL_SUCCESS)
     return make_result_error(env, "canvas_blit_image_failed");
 
@@ -427,12 +662,17 @@ ERL_NIF_TERM canvas_blit_image_scaled(ErlNifEnv* env, int argc, const ERL_NIF_TE
     return make_result_error(env, "canvas_blit_image_invalid_args");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   if(!enif_get_double(env, argv[2], &x) || !enif_get_double(env, argv[3], &y) ||
      !enif_get_double(env, argv[4], &w) || !enif_get_double(env, argv[5], &h)) {
     return make_result_error(env, "canvas_blit_image_invalid_args");
   }
 
   BLResult r = canvas->ctx.blit_image(BLRect(x, y, w, h), image->value);
+  canvas->dirty.add(canvas->ctx, shape_bounds(BLRect(x, y, w, h)));
   if(r != BL_SUCCESS)
     return make_result_error(env, "canvas_blit_image_failed");
 
@@ -449,6 +689,10 @@ ERL_NIF_TERM canvas_fill_mask(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[
     return make_result_error(env, "canvas_fill_mask_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   auto image = NifResource<Image>::get(env, argv[1]);
   if(image == nullptr) {
     return make_result_error(env, "canvas_fill_mask_invalid_image");
@@ -461,7 +705,7 @@ ERL_NIF_TERM canvas_fill_mask(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[
 
   // Optional style at argv[4]
   Style style{};
-  if(argc >= 5 && enif_is_list(env, argv[4])) {
+  if(argc >= 5 && is_style_arg(env, argv[4])) {
     parse_style(env, argv, argc, 4, &style);
   }
 
@@ -469,6 +713,8 @@ ERL_NIF_TERM canvas_fill_mask(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[
   style.apply(&canvas->ctx);
 
   BLResult rc = canvas->ctx.fill_mask(BLPoint(x, y), image->value);
+  BLSizeI sz = image->value.size();
+  canvas->dirty.add(canvas->ctx, BLBox(x, y, x + sz.w, y + sz.h));
 
   canvas->ctx.restore();
 
@@ -488,6 +734,10 @@ ERL_NIF_TERM canvas_set_fill_rule(ErlNifEnv* env, int argc, const ERL_NIF_TERM a
     return make_result_error(env, "set_fill_rule_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   char atom[32];
   if(!enif_get_atom(env, argv[1], atom, sizeof(atom), ERL_NIF_UTF8)) {
     return make_result_error(env, "set_fill_rule_invalid_atom");
@@ -509,54 +759,162 @@ ERL_NIF_TERM canvas_set_fill_rule(ErlNifEnv* env, int argc, const ERL_NIF_TERM a
   return enif_make_atom(env, "ok");
 }
 
-ERL_NIF_TERM canvas_to_png_base64(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+// canvas_pixels(Canvas) -> {:ok, %{data, width, height, stride, format}} | {:error, reason}
+//
+// Flushes pending commands and returns a view of the canvas pixels. The
+// binary must never change, so it is built over an Image resource that
+// shares the canvas buffer while the context is ended (Canvas::detach); the
+// next drawing call begins it again on a copy if the view is still alive.
+// When the context cannot be ended (open layers, saved states or a clip),
+// the view gets a copy of the pixels instead.
+ERL_NIF_TERM canvas_pixels(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
 {
   if(argc != 1)
     return enif_make_badarg(env);
 
   auto canvas = NifResource<Canvas>::get(env, argv[0]);
   if(canvas == nullptr) {
-    return make_result_error(env, "to_png_base64_invalid_canvas");
+    return make_result_error(env, "canvas_pixels_invalid_canvas");
   }
 
-  BLArray<uint8_t> pngData;
-  BLImageCodec png;
-  png.find_by_extension("png");
+  CanvasLock lock(canvas, CanvasLock::kRead);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
+  canvas->ctx.flush(BL_CONTEXT_FLUSH_SYNC);
 
-  canvas->ctx.end();
-  BLResult result = canvas->img.write_to_data(pngData, png);
-  if(result != BL_SUCCESS) {
-    return make_result_error(env, "canvas_to_png_base64_failed");
+  auto pixels = NifResource<Image>::alloc();
+  if(pixels == nullptr)
+    return make_result_error(env, "canvas_pixels_failed");
+
+  BLResult r = canvas->detach() ? pixels->value.assign(canvas->img)
+                                : pixels->value.assign_deep(canvas->img);
+  ERL_NIF_TERM view = r == BL_SUCCESS ? make_pixel_view(env, pixels, pixels->value) : 0;
+  // The binary holds its own reference to the resource.
+  enif_release_resource(pixels);
+  if(!view) {
+    return make_result_error(env, "canvas_pixels_failed");
   }
 
-  static const char b64_table[] =
-      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  return make_result_ok(env, view);
+}
 
-  std::string b64;
-  b64.reserve((pngData.size() + 2) / 3 * 4);
+// Parses the keyword list of Canvas.to_png/2.
+//
+//   compression: 0..9                                -> zlib level
+//   filter: :none | :sub | :up | :average | :paeth | :adaptive
+//   fast: boolean                                    -> level 1, Z_RLE, :sub filter
+//   opaque: boolean                                  -> RGB output, alpha dropped
+//   threads: pos_integer                             -> stripes encoded in parallel
+bool parse_png_options(ErlNifEnv* env, ERL_NIF_TERM list, PngOptions* opts)
+{
+  if(!enif_is_list(env, list))
+    return false;
+
+  ERL_NIF_TERM head, tail = list;
+  while(enif_get_list_cell(env, tail, &head, &tail)) {
+    int arity;
+    const ERL_NIF_TERM* tuple;
+    char key[32];
+    char value[16];
+
+    if(!enif_get_tuple(env, head, &arity, &tuple) || arity != 2)
+      return false;
+    if(!enif_get_atom(env, tuple[0], key, sizeof(key), ERL_NIF_UTF8))
+      return false;
+
+    if(strcmp(key, "compression") == 0) {
+      int level;
+      if(!enif_get_int(env, tuple[1], &level) || level < 0 || level > 9)
+        return false;
+      opts->compression = level;
+      continue;
+    }
+
+    if(strcmp(key, "threads") == 0) {
+      unsigned threads;
+      if(!enif_get_uint(env, tuple[1], &threads) || threads < 1)
+        return false;
+      opts->threads = threads;
+      continue;
+    }
+
+    if(!enif_get_atom(env, tuple[1], value, sizeof(value), ERL_NIF_UTF8))
+      return false;
+
+    if(strcmp(key, "filter") == 0) {
+      static const struct {
+        const char* name;
+        PngFilter filter;
+      } filters[] = {{"none", PNG_FILTER_NONE},
+                     {"sub", PNG_FILTER_SUB},
+                     {"up", PNG_FILTER_UP},
+                     {"average", PNG_FILTER_AVERAGE},
+                     {"paeth", PNG_FILTER_PAETH},
+                     {"adaptive", PNG_FILTER_ADAPTIVE}};
+      bool found = false;
+      for(const auto& entry : filters) {
+        if(strcmp(value, entry.name) == 0) {
+          opts->filter = entry.filter;
+          found = true;
+          break;
+        }
+      }
+      if(!found)
+        return false;
+    }
+    else if(strcmp(key, "fast") == 0 || strcmp(key, "opaque") == 0) {
+      bool flag = strcmp(value, "true") == 0;
+      if(!flag && strcmp(value, "false") != 0)
+        return false;
+      if(strcmp(key, "fast") == 0)
+        opts->fast = flag;
+      else
+        opts->opaque = flag;
+    }
+    else {
+      return false;
+    }
+  }
 
-  const uint8_t* data = pngData.data();
-  size_t len = pngData.size();
+  return true;
+}
 
-  for(size_t i = 0; i < len; i += 3) {
-    int val = (data[i] << 16) + ((i + 1 < len) ? (data[i + 1] << 8) : 0) +
-              ((i + 2 < len) ? data[i + 2] : 0);
-    b64.push_back(b64_table[(val >> 18) & 0x3F]);
-    b64.push_back(b64_table[(val >> 12) & 0x3F]);
-    b64.push_back((i + 1 < len) ? b64_table[(val >> 6) & 0x3F] : '=');
-    b64.push_back((i + 2 < len) ? b64_table[val & 0x3F] : '=');
+// Runs `encode` with a sink that appends to a binary grown as needed, and
+// makes the result term. `size_hint` is the initial capacity.
+template <typename EncodeFn>
+static bool encode_to_binary(ErlNifEnv* env, size_t size_hint, ERL_NIF_TERM* term, EncodeFn encode)
+{
+  ErlNifBinary out;
+  size_t used = 0;
+  if(!enif_alloc_binary(size_hint + 1024, &out))
+    return false;
+
+  BLResult r = encode([&](const uint8_t* data, size_t size) {
+    if(used + size > out.size && !enif_realloc_binary(&out, std::max(out.size * 2, used + size)))
+      return false;
+    memcpy(out.data + used, data, size);
+    used += size;
+    return true;
+  });
+
+  if(r != BL_SUCCESS || !enif_realloc_binary(&out, used)) {
+    enif_release_binary(&out);
+    return false;
   }
 
-  ERL_NIF_TERM bin;
-  unsigned char* buf = enif_make_new_binary(env, b64.size(), &bin);
-  std::memcpy(buf, b64.data(), b64.size());
-
-  return make_result_ok(env, bin);
+  *term = enif_make_binary(env, &out);
+  return true;
 }
 
+// canvas_to_png(Canvas [, Opts]) -> {:ok, Binary} | {:error, reason}
+//
+// With options (Canvas.to_png/2 always passes at least :threads) the image
+// goes through our own encoder (images/png_encoder.h), which writes straight
+// into the result binary. Without, it goes through Blend2D's PNG codec.
 ERL_NIF_TERM canvas_to_png(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
 {
-  if(argc != 1)
+  if(argc != 1 && argc != 2)
     return enif_make_badarg(env);
 
   auto canvas = NifResource<Canvas>::get(env, argv[0]);
@@ -564,8 +922,29 @@ ERL_NIF_TERM canvas_to_png(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
     return make_result_error(env, "to_png_invalid_canvas");
   }
 
+  PngOptions opts;
+  if(argc == 2 && !parse_png_options(env, argv[1], &opts)) {
+    return make_result_error(env, "canvas_to_png_invalid_options");
+  }
+
+  CanvasLock lock(canvas, CanvasLock::kRead);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   canvas->ctx.flush(BL_CONTEXT_FLUSH_SYNC);
 
+  if(argc == 2) {
+    BLSizeI sz = canvas->img.size();
+    ERL_NIF_TERM bin;
+    bool ok = encode_to_binary(env, size_t(sz.w) * size_t(sz.h), &bin, [&](const PngSink& sink) {
+      return png_encode(canvas->img, opts, sink);
+    });
+    if(!ok)
+      return make_result_error(env, "canvas_to_png_failed");
+
+    return make_result_ok(env, bin);
+  }
+
   BLArray<uint8_t> png_data;
   BLImageCodec png;
   png.find_by_extension("png");
@@ -584,6 +963,58 @@ ERL_NIF_TERM canvas_to_png(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
   return make_result_ok(env, bin);
 }
 
+// canvas_to_png_base64(Canvas [, Opts]) -> {:ok, Base64} | {:error, reason}
+//
+// Same encoders and options as canvas_to_png, then Base64 on top.
+ERL_NIF_TERM canvas_to_png_base64(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 1 && argc != 2)
+    return enif_make_badarg(env);
+
+  auto canvas = NifResource<Canvas>::get(env, argv[0]);
+  if(canvas == nullptr) {
+    return make_result_error(env, "to_png_base64_invalid_canvas");
+  }
+
+  PngOptions opts;
+  if(argc == 2 && !parse_png_options(env, argv[1], &opts)) {
+    return make_result_error(env, "canvas_to_png_base64_invalid_options");
+  }
+
+  CanvasLock lock(canvas, CanvasLock::kRead);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
+  // Flush, don't end: the canvas stays usable for further drawing.
+  canvas->ctx.flush(BL_CONTEXT_FLUSH_SYNC);
+
+  ERL_NIF_TERM png_term;
+  ErlNifBinary png;
+  BLArray<uint8_t> png_data;
+  if(argc == 2) {
+    const size_t hint = size_t(canvas->size.w) * size_t(canvas->size.h);
+    bool ok = encode_to_binary(env, hint, &png_term, [&](const PngSink& sink) {
+      return png_encode(canvas->img, opts, sink);
+    });
+    if(!ok || !enif_inspect_binary(env, png_term, &png))
+      return make_result_error(env, "canvas_to_png_base64_failed");
+  }
+  else {
+    BLImageCodec codec;
+    codec.find_by_extension("png");
+    if(canvas->img.write_to_data(png_data, codec) != BL_SUCCESS)
+      return make_result_error(env, "canvas_to_png_base64_failed");
+    png.data = const_cast<uint8_t*>(png_data.data());
+    png.size = png_data.size();
+  }
+
+  ERL_NIF_TERM bin;
+  unsigned char* buf = enif_make_new_binary(env, base64_encoded_size(png.size), &bin);
+  base64_encode(png.data, png.size, reinterpret_cast<char*>(buf));
+
+  return make_result_ok(env, bin);
+}
+
 ERL_NIF_TERM canvas_to_qoi(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
 {
   if(argc != 1)
@@ -594,6 +1025,10 @@ ERL_NIF_TERM canvas_to_qoi(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
     return make_result_error(env, "to_qoi_invalid_canvas");
   }
 
+  CanvasLock lock(canvas, CanvasLock::kRead);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   // Make sure everything is flushed from the context to the image
   canvas->ctx.flush(BL_CONTEXT_FLUSH_SYNC);
 
@@ -620,3 +1055,177 @@ ERL_NIF_TERM canvas_to_qoi(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
 
   return make_result_ok(env, bin);
 }
+
+// canvas_write_file(Canvas, Path, Format, Sync, PngOpts) -> :ok | {:error, reason}
+//
+//   Format  :: :png | :qoi
+//   Sync    :: boolean, fsync before closing
+//   PngOpts :: keyword list of Canvas.to_png/2 (ignored for QOI)
+//
+// Encodes straight into the file through a FileSink, so the encoded image
+// never exists as a whole in memory or as an Erlang binary. Runs on a dirty
+// IO scheduler. A failed write leaves no partial file behind, and an
+// existing file at Path untouched.
+ERL_NIF_TERM canvas_write_file(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 5)
+    return enif_make_badarg(env);
+
+  auto canvas = NifResource<Canvas>::get(env, argv[0]);
+  if(canvas == nullptr)
+    return make_result_error(env, "canvas_write_file_invalid_canvas");
+
+  ErlNifBinary path_bin;
+  if(!enif_inspect_binary(env, argv[1], &path_bin) || path_bin.size == 0 ||
+     memchr(path_bin.data, 0, path_bin.size) != nullptr)
+    return make_result_error(env, "canvas_write_file_invalid_path");
+  std::string path(reinterpret_cast<const char*>(path_bin.data), path_bin.size);
+
+  char format[8];
+  if(!enif_get_atom(env, argv[2], format, sizeof(format), ERL_NIF_UTF8) ||
+     (strcmp(format, "png") != 0 && strcmp(format, "qoi") != 0))
+    return make_result_error(env, "canvas_write_file_invalid_format");
+
+  char sync[8];
+  PngOptions opts;
+  if(!enif_get_atom(env, argv[3], sync, sizeof(sync), ERL_NIF_UTF8) ||
+     (strcmp(sync, "true") != 0 && strcmp(sync, "false") != 0) ||
+     !parse_png_options(env, argv[4], &opts))
+    return make_result_error(env, "canvas_write_file_invalid_options");
+
+  CanvasLock lock(canvas, CanvasLock::kRead);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
+  FileSink file;
+  if(!file.open(path))
+    return make_result_error(env, "canvas_write_file_open_failed");
+
+  canvas->ctx.flush(BL_CONTEXT_FLUSH_SYNC);
+
+  auto sink = [&file](const uint8_t* data, size_t size) { return file.write(data, size); };
+  BLResult r = strcmp(format, "png") == 0 ? png_encode(canvas->img, opts, sink)
+                                          : qoi_encode(canvas->img, sink);
+
+  if(r != BL_SUCCESS || !file.close(strcmp(sync, "true") == 0))
+    return make_result_error(env, "canvas_write_file_failed");
+
+  return enif_make_atom(env, "ok");
+}
+
+static ERL_NIF_TERM make_rect_map(ErlNifEnv* env, const BLBoxI& box)
+{
+  ERL_NIF_TERM keys[] = {enif_make_atom(env, "x"),
+                         enif_make_atom(env, "y"),
+                         enif_make_atom(env, "width"),
+                         enif_make_atom(env, "height")};
+  ERL_NIF_TERM values[] = {enif_make_int(env, box.x0),
+                           enif_make_int(env, box.y0),
+                           enif_make_int(env, box.x1 - box.x0),
+                           enif_make_int(env, box.y1 - box.y0)};
+  ERL_NIF_TERM map;
+  enif_make_map_from_arrays(env, keys, values, 4, &map);
+  return map;
+}
+
+// canvas_dirty_rects(Canvas) -> {:ok, [%{x, y, width, height}]}
+//
+// The regions export_delta would encode, without resetting them.
+ERL_NIF_TERM canvas_dirty_rects(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 1)
+    return enif_make_badarg(env);
+
+  auto canvas = NifResource<Canvas>::get(env, argv[0]);
+  if(canvas == nullptr)
+    return make_result_error(env, "canvas_dirty_rects_invalid_canvas");
+
+  CanvasLock lock(canvas, CanvasLock::kRead);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
+  BLSizeI sz = canvas->img.size();
+  BLBoxI boxes[DirtyRegion::kMaxRects];
+  size_t n = canvas->dirty.rects(sz.w, sz.h, boxes);
+
+  ERL_NIF_TERM list = enif_make_list(env, 0);
+  while(n-- > 0)
+    list = enif_make_list_cell(env, make_rect_map(env, boxes[n]), list);
+  return make_result_ok(env, list);
+}
+
+// canvas_export_delta(Canvas, Format, PngOpts)
+//   -> {:ok, [%{x, y, width, height, data}]} | {:error, reason}
+//
+//   Format  :: :png | :qoi
+//   PngOpts :: keyword list of Canvas.to_png/2 (ignored for QOI)
+//
+// Encodes each dirty rectangle as its own image and clears the dirty region.
+// Returns an empty list when nothing was drawn since the last call.
+ERL_NIF_TERM canvas_export_delta(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 3)
+    return enif_make_badarg(env);
+
+  auto canvas = NifResource<Canvas>::get(env, argv[0]);
+  if(canvas == nullptr)
+    return make_result_error(env, "canvas_export_delta_invalid_canvas");
+
+  char format[8];
+  if(!enif_get_atom(env, argv[1], format, sizeof(format), ERL_NIF_UTF8) ||
+     (strcmp(format, "png") != 0 && strcmp(format, "qoi") != 0))
+    return make_result_error(env, "canvas_export_delta_invalid_format");
+  const bool png = strcmp(format, "png") == 0;
+
+  PngOptions opts;
+  if(!parse_png_options(env, argv[2], &opts))
+    return make_result_error(env, "canvas_export_delta_invalid_options");
+
+  CanvasLock lock(canvas, CanvasLock::kRead);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
+  canvas->ctx.flush(BL_CONTEXT_FLUSH_SYNC);
+
+  BLImageData data{};
+  if(canvas->img.get_data(&data) != BL_SUCCESS)
+    return make_result_error(env, "canvas_export_delta_failed");
+
+  BLBoxI boxes[DirtyRegion::kMaxRects];
+  size_t n = canvas->dirty.rects(data.size.w, data.size.h, boxes);
+
+  ERL_NIF_TERM list = enif_make_list(env, 0);
+  while(n-- > 0) {
+    const BLBoxI& box = boxes[n];
+    const int w = box.x1 - box.x0;
+    const int h = box.y1 - box.y0;
+    const uint8_t* pixels = static_cast<const uint8_t*>(data.pixel_data) +
+                            intptr_t(box.y0) * data.stride + intptr_t(box.x0) * 4;
+    const BLFormat pixel_format = BLFormat(data.format);
+
+    ERL_NIF_TERM bin;
+    bool ok = encode_to_binary(env, size_t(w) * size_t(h), &bin, [&](const PngSink& sink) {
+      if(png) {
+        PngWriter writer(w, h, opts, sink);
+        BLResult r = writer.begin();
+        if(r == BL_SUCCESS)
+          r = writer.write_rows(pixels, data.stride, h, pixel_format);
+        return r == BL_SUCCESS ? writer.finish() : r;
+      }
+      QoiWriter writer(w, h, sink);
+      BLResult r = writer.begin();
+      if(r == BL_SUCCESS)
+        r = writer.write_rows(pixels, data.stride, h, pixel_format);
+      return r == BL_SUCCESS ? writer.finish() : r;
+    });
+    if(!ok)
+      return make_result_error(env, "canvas_export_delta_failed");
+
+    ERL_NIF_TERM map = make_rect_map(env, box);
+    enif_make_map_put(env, map, enif_make_atom(env, "data"), bin, &map);
+    list = enif_make_list_cell(env, map, list);
+  }
+
+  canvas->dirty.clear();
+  return make_result_ok(env, list);
+}
@@ -1,17 +1,161 @@
 #pragma once
+#include "dirty.h"
+#include "../images/surface_pool.h"
+
 #include <blend2d/blend2d.h>
 #include <cstring>
 #include <erl_nif.h>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
+
+struct PngOptions;
+
+// An offscreen group opened by Canvas.begin_layer/3. While it is open, the
+// canvas context draws into `surface`; the context it replaced waits in
+// `parent` until end_layer composites the group back.
+struct CanvasLayer {
+  PooledSurface surface;
+  BLContext parent;
+  BLRectI bounds; // canvas pixels covered by the surface
+};
 
 struct Canvas {
   BLImage img;
+  // Size of `img`, fixed at creation; read without the lock, as `img`
+  // itself may be replaced by attach() meanwhile.
+  BLSizeI size{};
   BLContext ctx;
+  // Options the context was created with, reused by Canvas.clone/1.
+  BLContextCreateInfo create_info{};
+  // Serializes NIF calls on this canvas; BLContext is not thread-safe and
+  // any process holding the reference may call in from any scheduler.
+  std::mutex mutex;
+  // Pixels drawn since the last Canvas.export_delta/2.
+  DirtyRegion dirty;
+  // Open layers, innermost last.
+  std::vector<CanvasLayer> layers;
+  // Set once clip_to_rect narrowed the context outside any saved state; a
+  // context begun anew could not take that clip over.
+  bool clipped = false;
+  // Set while the context is ended because a pixel view shares `img`, with
+  // the state a new context takes over (see detach/attach).
+  bool detached = false;
+  BLMatrix2D detached_meta;
+  BLMatrix2D detached_user;
+  BLFillRule detached_fill_rule = BL_FILL_RULE_NON_ZERO;
+
+  // Ends the context, so `img` is never written again and may be shared
+  // with a pixel view. Refused (false) while layers, saved states or a
+  // clip are in place, which a new context could not take over.
+  bool detach()
+  {
+    if(detached)
+      return true;
+    if(!layers.empty() || clipped || ctx.saved_state_count() != 0)
+      return false;
+
+    detached_meta = ctx.meta_transform();
+    detached_user = ctx.user_transform();
+    detached_fill_rule = ctx.fill_rule();
+    ctx.end();
+    detached = true;
+    return true;
+  }
+
+  // Begins the context again after detach(). While a pixel view still
+  // shares the buffer, make_mutable() gives `img` a copy to draw on;
+  // otherwise drawing goes on in the same buffer.
+  bool attach()
+  {
+    if(!detached)
+      return true;
+    BLImageData data;
+    if(img.make_mutable(&data) != BL_SUCCESS || ctx.begin(img, &create_info) != BL_SUCCESS)
+      return false;
+
+    ctx.set_transform(detached_meta);
+    ctx.user_to_meta();
+    ctx.set_transform(detached_user);
+    ctx.set_fill_rule(detached_fill_rule);
+    detached = false;
+    return true;
+  }
 
   void destroy()
   {
     ctx.end();
     ctx.reset();
+    for(auto it = layers.rbegin(); it != layers.rend(); ++it)
+      it->parent.end();
+    layers.clear();
     img.reset();
   }
 };
+
+// Scoped exclusive access to a canvas for the duration of a NIF call.
+//
+// The uncontended path is a single try_lock. When another process holds the
+// canvas, dirty schedulers simply wait (they exist to block), while normal
+// schedulers retry briefly and then give up, since they must not be held for
+// the length of e.g. a PNG encode. Callers return {:error, :canvas_busy}
+// when the lock was not acquired.
+//
+// A kDraw lock also begins the context again if a pixel view ended it
+// (Canvas::attach). Calls that only read `img` take a kRead lock, which
+// leaves a detached canvas alone; they must not touch `ctx` beyond flush().
+// Should the context fail to begin, drawing on it reports its own errors.
+class CanvasLock {
+public:
+  enum Access { kDraw, kRead };
+
+  explicit CanvasLock(Canvas* canvas, Access access = kDraw) noexcept : canvas_(canvas)
+  {
+    locked_ = acquire();
+    if(locked_ && access == kDraw)
+      canvas_->attach();
+  }
+
+  ~CanvasLock()
+  {
+    if(locked_)
+      canvas_->mutex.unlock();
+  }
+
+  CanvasLock(const CanvasLock&) = delete;
+  CanvasLock& operator=(const CanvasLock&) = delete;
+
+  explicit operator bool() const noexcept
+  {
+    return locked_;
+  }
+
+private:
+  static constexpr int kNormalSchedulerRetries = 64;
+
+  bool acquire() noexcept
+  {
+    if(canvas_->mutex.try_lock())
+      return true;
+
+    if(enif_thread_type() != ERL_NIF_THR_NORMAL_SCHEDULER) {
+      canvas_->mutex.lock();
+      return true;
+    }
+
+    for(int i = 0; i < kNormalSchedulerRetries; i++) {
+      std::this_thread::yield();
+      if(canvas_->mutex.try_lock())
+        return true;
+    }
+    return false;
+  }
+
+  Canvas* canvas_;
+  bool locked_ = false;
+};
+
+// Parses the keyword list of Canvas.to_png/2 into encoder options. Shared by
+// every NIF that writes PNG.
+bool parse_png_options(ErlNifEnv* env, ERL_NIF_TERM list, PngOptions* opts);
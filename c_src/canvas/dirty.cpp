@@ -0,0 +1,275 @@
+#include "dirty.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+  // Device boxes beyond this are clamped, which keeps the int conversions
+  // defined; anything that large covers the canvas anyway.
+  constexpr double kLimit = 1e9;
+
+  int64_t area(const BLBoxI& b)
+  {
+    return int64_t(b.x1 - b.x0) * int64_t(b.y1 - b.y0);
+  }
+
+  BLBoxI unite(const BLBoxI& a, const BLBoxI& b)
+  {
+    return BLBoxI(std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1),
+                  std::max(a.y1, b.y1));
+  }
+
+  bool overlaps(const BLBoxI& a, const BLBoxI& b)
+  {
+    return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1;
+  }
+
+  // Composition operators that also change pixels outside the drawn shape.
+  bool is_unbounded(BLCompOp op)
+  {
+    return op == BL_COMP_OP_SRC_IN || op == BL_COMP_OP_SRC_OUT || op == BL_COMP_OP_DST_IN ||
+           op == BL_COMP_OP_DST_ATOP;
+  }
+
+  // How far the current stroke can reach beyond the geometry, in user units.
+  double stroke_extent(const BLStrokeOptions& so)
+  {
+    double reach = 1.4142135623730951; // square caps at 45 degrees
+    if(so.join == BL_STROKE_JOIN_MITER_CLIP || so.join == BL_STROKE_JOIN_MITER_BEVEL ||
+       so.join == BL_STROKE_JOIN_MITER_ROUND)
+      reach = std::max(reach, so.miter_limit);
+    return std::abs(so.width) * 0.5 * reach;
+  }
+
+  BLBox points_bounds(const BLPoint* p, size_t n)
+  {
+    if(n == 0)
+      return BLBox(0, 0, 0, 0);
+    BLBox b(p[0].x, p[0].y, p[0].x, p[0].y);
+    for(size_t i = 1; i < n; i++) {
+      b.x0 = std::min(b.x0, p[i].x);
+      b.y0 = std::min(b.y0, p[i].y);
+      b.x1 = std::max(b.x1, p[i].x);
+      b.y1 = std::max(b.y1, p[i].y);
+    }
+    return b;
+  }
+
+  BLBox normalized(double x0, double y0, double x1, double y1)
+  {
+    return BLBox(std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1));
+  }
+} // namespace
+
+BLBox transform_bounds(const BLMatrix2D& m, const BLBox& box)
+{
+  const double xs[2] = {box.x0, box.x1};
+  const double ys[2] = {box.y0, box.y1};
+
+  double x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+  for(double x : xs) {
+    for(double y : ys) {
+      const double dx = x * m.m00 + y * m.m10 + m.m20;
+      const double dy = x * m.m01 + y * m.m11 + m.m21;
+      x0 = std::min(x0, dx);
+      y0 = std::min(y0, dy);
+      x1 = std::max(x1, dx);
+      y1 = std::max(y1, dy);
+    }
+  }
+  return BLBox(x0, y0, x1, y1);
+}
+
+bool device_bounds(const BLContext& ctx, const BLBox& box, BLBox* out)
+{
+  if(is_unbounded(ctx.comp_op()))
+    return false;
+
+  const double pad = stroke_extent(ctx.stroke_options());
+  if(!std::isfinite(box.x0 + box.y0 + box.x1 + box.y1 + pad))
+    return false;
+
+  *out = transform_bounds(ctx.final_transform(),
+                          BLBox(box.x0 - pad, box.y0 - pad, box.x1 + pad, box.y1 + pad));
+  return std::isfinite(out->x0) && std::isfinite(out->y0) && std::isfinite(out->x1) &&
+         std::isfinite(out->y1);
+}
+
+void DirtyRegion::add(const BLContext& ctx, const BLBox& box)
+{
+  if(all_ || paused_)
+    return;
+
+  BLBox b;
+  if(!device_bounds(ctx, box, &b)) {
+    all_ = true;
+    return;
+  }
+
+  // One extra pixel on each side for antialiasing.
+  auto clamp = [](double v) { return int(std::max(-kLimit, std::min(kLimit, v))); };
+  add_device(BLBoxI(clamp(std::floor(b.x0) - 1.0), clamp(std::floor(b.y0) - 1.0),
+                    clamp(std::ceil(b.x1) + 1.0), clamp(std::ceil(b.y1) + 1.0)));
+}
+
+void DirtyRegion::add_device(BLBoxI box)
+{
+  // Absorb every rectangle the new box touches; repeat, since the grown box
+  // may now reach rectangles it did not before.
+  bool merged = true;
+  while(merged) {
+    merged = false;
+    for(size_t i = 0; i < count_; i++) {
+      if(overlaps(rects_[i], box)) {
+        box = unite(box, rects_[i]);
+        rects_[i] = rects_[--count_];
+        merged = true;
+        break;
+      }
+    }
+  }
+
+  if(count_ < kMaxRects) {
+    rects_[count_++] = box;
+    return;
+  }
+
+  // Full: merge into the rectangle whose union grows the least.
+  size_t best = 0;
+  int64_t best_growth = INT64_MAX;
+  for(size_t i = 0; i < count_; i++) {
+    int64_t growth = area(unite(rects_[i], box)) - area(rects_[i]);
+    if(growth < best_growth) {
+      best_growth = growth;
+      best = i;
+    }
+  }
+  box = unite(rects_[best], box);
+  rects_[best] = rects_[--count_];
+  add_device(box);
+}
+
+size_t DirtyRegion::rects(int width, int height, BLBoxI* out) const
+{
+  if(width <= 0 || height <= 0)
+    return 0;
+
+  if(all_) {
+    out[0] = BLBoxI(0, 0, width, height);
+    return 1;
+  }
+
+  size_t n = 0;
+  for(size_t i = 0; i < count_; i++) {
+    BLBoxI b(std::max(rects_[i].x0, 0), std::max(rects_[i].y0, 0),
+             std::min(rects_[i].x1, width), std::min(rects_[i].y1, height));
+    if(b.x0 < b.x1 && b.y0 < b.y1)
+      out[n++] = b;
+  }
+  return n;
+}
+
+BLBox shape_bounds(const BLBox& box)
+{
+  return normalized(box.x0, box.y0, box.x1, box.y1);
+}
+
+BLBox shape_bounds(const BLRect& rect)
+{
+  return normalized(rect.x, rect.y, rect.x + rect.w, rect.y + rect.h);
+}
+
+BLBox shape_bounds(const BLLine& line)
+{
+  return normalized(line.x0, line.y0, line.x1, line.y1);
+}
+
+BLBox shape_bounds(const BLCircle& circle)
+{
+  const double r = std::abs(circle.r);
+  return BLBox(circle.cx - r, circle.cy - r, circle.cx + r, circle.cy + r);
+}
+
+BLBox shape_bounds(const BLEllipse& ellipse)
+{
+  const double rx = std::abs(ellipse.rx), ry = std::abs(ellipse.ry);
+  return BLBox(ellipse.cx - rx, ellipse.cy - ry, ellipse.cx + rx, ellipse.cy + ry);
+}
+
+BLBox shape_bounds(const BLRoundRect& round_rect)
+{
+  return normalized(round_rect.x, round_rect.y, round_rect.x + round_rect.w,
+                    round_rect.y + round_rect.h);
+}
+
+// The whole ellipse; arcs, chords and pies never leave it.
+BLBox shape_bounds(const BLArc& arc)
+{
+  const double rx = std::abs(arc.rx), ry = std::abs(arc.ry);
+  return BLBox(arc.cx - rx, arc.cy - ry, arc.cx + rx, arc.cy + ry);
+}
+
+BLBox shape_bounds(const BLTriangle& triangle)
+{
+  const BLPoint p[3] = {BLPoint(triangle.x0, triangle.y0), BLPoint(triangle.x1, triangle.y1),
+                        BLPoint(triangle.x2, triangle.y2)};
+  return points_bounds(p, 3);
+}
+
+BLBox shape_bounds(const BLArrayView<BLPoint>& points)
+{
+  return points_bounds(points.data, points.size);
+}
+
+BLBox shape_bounds(const BLArrayView<BLRect>& rects)
+{
+  if(rects.size == 0)
+    return BLBox(0, 0, 0, 0);
+  BLBox b = shape_bounds(rects.data[0]);
+  for(size_t i = 1; i < rects.size; i++) {
+    BLBox r = shape_bounds(rects.data[i]);
+    b = BLBox(std::min(b.x0, r.x0), std::min(b.y0, r.y0), std::max(b.x1, r.x1),
+              std::max(b.y1, r.y1));
+  }
+  return b;
+}
+
+BLBox shape_bounds(const BLArrayView<BLBox>& boxes)
+{
+  if(boxes.size == 0)
+    return BLBox(0, 0, 0, 0);
+  BLBox b = shape_bounds(boxes.data[0]);
+  for(size_t i = 1; i < boxes.size; i++) {
+    BLBox r = shape_bounds(boxes.data[i]);
+    b = BLBox(std::min(b.x0, r.x0), std::min(b.y0, r.y0), std::max(b.x1, r.x1),
+              std::max(b.y1, r.y1));
+  }
+  return b;
+}
+
+bool text_bounds(const BLFont& font, const BLPoint& origin, const BLStringView& text, BLBox* out)
+{
+  BLGlyphBuffer gb;
+  BLTextMetrics tm;
+  if(gb.set_utf8_text(text.data, text.size) != BL_SUCCESS || font.shape(gb) != BL_SUCCESS ||
+     font.get_text_metrics(gb, tm) != BL_SUCCESS)
+    return false;
+
+  *out = BLBox(origin.x + tm.bounding_box.x0, origin.y + tm.bounding_box.y0,
+               origin.x + tm.bounding_box.x1, origin.y + tm.bounding_box.y1);
+  return true;
+}
+
+bool glyph_run_bounds(const BLFont& font, const BLPoint& origin, const BLGlyphRun& run, BLBox* out)
+{
+  if(run.size == 0) {
+    *out = BLBox(origin.x, origin.y, origin.x, origin.y);
+    return true;
+  }
+
+  BLPath outlines;
+  BLMatrix2D m = BLMatrix2D::make_translation(origin.x, origin.y);
+  return font.get_glyph_run_outlines(run, &m, outlines) == BL_SUCCESS &&
+         outlines.get_bounding_box(out) == BL_SUCCESS;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <blend2d/blend2d.h>
+#include <cstddef>
+
+// ----------------------------------------------------------------------------
+// Dirty region tracking
+// ----------------------------------------------------------------------------
+// Records the device-space pixels touched by draw calls as a few rectangles,
+// so an animation frame can export only what changed (Canvas.export_delta/2).
+//
+// Bounds are conservative. A shape's user-space box is padded by the extent
+// of the context's current stroke options, mapped through the final
+// transform and widened by a pixel for antialiasing. Operations that can
+// touch pixels outside their shape (unbounded composition operators, clears
+// and whole-canvas fills) mark the whole canvas.
+
+class DirtyRegion {
+public:
+  // Disjoint boxes kept before nearby ones are merged into their union.
+  static constexpr size_t kMaxRects = 4;
+
+  // Adds `box`, given in the user space of `ctx`, as drawn with the
+  // context's current transform, stroke options and composition operator.
+  // A box with non-finite coordinates marks the whole canvas.
+  void add(const BLContext& ctx, const BLBox& box);
+
+  void add_all() noexcept
+  {
+    if(!paused_)
+      all_ = true;
+  }
+
+  // While paused, add() and add_all() record nothing. The canvas pauses
+  // tracking while a layer is open: drawing then lands on the layer's
+  // surface, and is recorded once, as the layer's box, when the outermost
+  // layer is composited onto the canvas.
+  void set_paused(bool paused) noexcept
+  {
+    paused_ = paused;
+  }
+
+  void clear() noexcept
+  {
+    count_ = 0;
+    all_ = false;
+  }
+
+  // Writes the dirty rectangles clipped to a `width` x `height` canvas to
+  // `out` (room for kMaxRects) and returns how many there are.
+  size_t rects(int width, int height, BLBoxI* out) const;
+
+private:
+  void add_device(BLBoxI box);
+
+  BLBoxI rects_[kMaxRects];
+  size_t count_ = 0;
+  bool all_ = false;
+  bool paused_ = false;
+};
+
+// Device-space box that `box`, given in the user space of `ctx`, covers when
+// drawn with the context's current transform and stroke options, before
+// antialiasing. Returns false when the extent is unbounded: non-finite
+// coordinates or a composition operator that reaches outside the shape.
+bool device_bounds(const BLContext& ctx, const BLBox& box, BLBox* out);
+
+// Axis-aligned bounds of `box` mapped through `m`.
+BLBox transform_bounds(const BLMatrix2D& m, const BLBox& box);
+
+// User-space bounds of the geometry a draw call covers, for DirtyRegion::add.
+BLBox shape_bounds(const BLBox& box);
+BLBox shape_bounds(const BLRect& rect);
+BLBox shape_bounds(const BLLine& line);
+BLBox shape_bounds(const BLCircle& circle);
+BLBox shape_bounds(const BLEllipse& ellipse);
+BLBox shape_bounds(const BLRoundRect& round_rect);
+BLBox shape_bounds(const BLArc& arc);
+BLBox shape_bounds(const BLTriangle& triangle);
+BLBox shape_bounds(const BLArrayView<BLPoint>& points);
+BLBox shape_bounds(const BLArrayView<BLRect>& rects);
+BLBox shape_bounds(const BLArrayView<BLBox>& boxes);
+
+// Bounds of `text` / `run` drawn with `font` at `origin`. Return false when
+// the bounds could not be determined.
+bool text_bounds(const BLFont& font, const BLPoint& origin, const BLStringView& text, BLBox* out);
+bool glyph_run_bounds(const BLFont& font, const BLPoint& origin, const BLGlyphRun& run, BLBox* out);
@@ -0,0 +1,208 @@
+#include "display_list.h"
+#include "canvas.h"
+#include "dirty.h"
+#include "../nif/nif_resource.h"
+#include "../nif/nif_util.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+ERL_NIF_TERM make_op_error(ErlNifEnv* env, const char* reason, size_t offset)
+{
+  return enif_make_tuple2(
+      env,
+      enif_make_atom(env, "error"),
+      enif_make_tuple2(env, enif_make_atom(env, reason), enif_make_ulong(env, offset)));
+}
+
+// Reads a tuple of `n` floats, or leaves `out` alone for nil.
+bool get_doubles_or_nil(ErlNifEnv* env, ERL_NIF_TERM term, double* out, int n, bool* given)
+{
+  *given = false;
+  if(enif_is_identical(term, enif_make_atom(env, "nil")))
+    return true;
+
+  int arity;
+  const ERL_NIF_TERM* items;
+  if(!enif_get_tuple(env, term, &arity, &items) || arity != n)
+    return false;
+  for(int i = 0; i < n; i++) {
+    if(!enif_get_double(env, items[i], &out[i]) || !std::isfinite(out[i]))
+      return false;
+  }
+  *given = true;
+  return true;
+}
+
+} // namespace
+
+// display_list_new(ops, refs) -> {:ok, list} | {:error, reason}
+//
+//   ops, refs :: a command buffer, as for canvas_exec (see exec.h)
+//
+// Copies the buffer, takes its own references to the resources and indexes
+// the bounds of every draw op. Malformed ops fail like canvas_exec, with
+// {:error, {reason, byte_offset}}.
+ERL_NIF_TERM display_list_new(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 2)
+    return enif_make_badarg(env);
+
+  ErlNifBinary ops;
+  if(!enif_inspect_iolist_as_binary(env, argv[0], &ops))
+    return make_result_error(env, "display_list_new_invalid_ops");
+
+  std::vector<ExecRef> refs;
+  if(!exec_resolve_refs(env, argv[1], &refs))
+    return make_result_error(env, "display_list_new_invalid_refs");
+
+  auto list = NifResource<DisplayList>::alloc();
+  if(list == nullptr)
+    return make_result_error(env, "display_list_new_alloc_failed");
+
+  list->ops.assign(ops.data, ops.data + ops.size);
+  list->paths.reserve(refs.size());
+  for(ExecRef& ref : refs) {
+    if(ref.path) {
+      list->paths.push_back(*ref.path);
+      ref.path = &list->paths.back();
+      continue;
+    }
+    void* res = ref.color ? static_cast<void*>(ref.color)
+                : ref.gradient ? static_cast<void*>(ref.gradient)
+                : ref.pattern ? static_cast<void*>(ref.pattern)
+                              : static_cast<void*>(ref.font);
+    enif_keep_resource(res);
+    list->kept.push_back(res);
+  }
+  list->refs = std::move(refs);
+
+  size_t offset = 0;
+  BLResult r = exec_index(list->ops.data(), list->ops.size(), list->refs, &list->items, &offset);
+  if(r != BL_SUCCESS) {
+    enif_release_resource(list);
+    if(r == EXEC_ERROR_INVALID_OP)
+      return make_op_error(env, "display_list_new_invalid_op", offset);
+    if(r == EXEC_ERROR_INVALID_FONT)
+      return make_op_error(env, "display_list_new_invalid_font", offset);
+    return make_result_error(env, "display_list_new_failed");
+  }
+
+  if(!list->items.empty()) {
+    BLBox& b = list->bounds;
+    b = list->items.front().bounds;
+    for(const ExecItem& item : list->items) {
+      b.x0 = std::min(b.x0, item.bounds.x0);
+      b.y0 = std::min(b.y0, item.bounds.y0);
+      b.x1 = std::max(b.x1, item.bounds.x1);
+      b.y1 = std::max(b.y1, item.bounds.y1);
+    }
+  }
+
+  return make_result_ok(env, NifResource<DisplayList>::make(env, list));
+}
+
+// display_list_bounds(list) -> {:ok, {x0, y0, x1, y1}} | {:error, reason}
+//
+// Box covered by the list's draw ops in its own space, padded for strokes.
+// An empty list covers {0, 0, 0, 0}.
+ERL_NIF_TERM display_list_bounds(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 1)
+    return enif_make_badarg(env);
+
+  auto list = NifResource<DisplayList>::get(env, argv[0]);
+  if(list == nullptr)
+    return make_result_error(env, "display_list_bounds_invalid_list");
+
+  const BLBox& b = list->bounds;
+  if(!std::isfinite(b.x0) || !std::isfinite(b.y0) || !std::isfinite(b.x1) || !std::isfinite(b.y1))
+    return make_result_error(env, "display_list_bounds_unbounded");
+
+  return make_result_ok(env,
+                        enif_make_tuple4(env,
+                                         enif_make_double(env, b.x0),
+                                         enif_make_double(env, b.y0),
+                                         enif_make_double(env, b.x1),
+                                         enif_make_double(env, b.y1)));
+}
+
+// display_list_replay(canvas, list, transform, clip) -> :ok | {:error, reason}
+//
+//   transform :: {m00, m01, m10, m11, m20, m21} | nil, applied on top of the
+//                canvas' user transform
+//   clip      :: {x, y, w, h} | nil, in the canvas' user space
+//
+// Draws the list as canvas_exec would draw its buffer, except that the
+// transform is folded into the meta transform first, so transforms set
+// inside the list stay relative to it. Draw ops whose bounds miss the clip
+// (and the canvas) are skipped.
+ERL_NIF_TERM display_list_replay(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 4)
+    return enif_make_badarg(env);
+
+  auto canvas = NifResource<Canvas>::get(env, argv[0]);
+  if(canvas == nullptr)
+    return make_result_error(env, "display_list_replay_invalid_canvas");
+
+  auto list = NifResource<DisplayList>::get(env, argv[1]);
+  if(list == nullptr)
+    return make_result_error(env, "display_list_replay_invalid_list");
+
+  double m[6], c[4];
+  bool has_transform, has_clip;
+  if(!get_doubles_or_nil(env, argv[2], m, 6, &has_transform))
+    return make_result_error(env, "display_list_replay_invalid_transform");
+  if(!get_doubles_or_nil(env, argv[3], c, 4, &has_clip) || (has_clip && (c[2] < 0 || c[3] < 0)))
+    return make_result_error(env, "display_list_replay_invalid_clip");
+
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
+  BLContext& ctx = canvas->ctx;
+
+  // Device pixels of the current target: the canvas or the open layer.
+  BLBox clip;
+  if(canvas->layers.empty()) {
+    BLSizeI sz = canvas->img.size();
+    clip = BLBox(0, 0, sz.w, sz.h);
+  }
+  else {
+    const BLRectI& b = canvas->layers.back().bounds;
+    clip = BLBox(0, 0, b.w, b.h);
+  }
+
+  ctx.save();
+  if(has_clip) {
+    const BLRect rect(c[0], c[1], c[2], c[3]);
+    ctx.clip_to_rect(rect);
+    const BLBox d = transform_bounds(
+        ctx.final_transform(), BLBox(rect.x, rect.y, rect.x + rect.w, rect.y + rect.h));
+    clip = BLBox(std::max(clip.x0, d.x0),
+                 std::max(clip.y0, d.y0),
+                 std::min(clip.x1, d.x1),
+                 std::min(clip.y1, d.y1));
+  }
+  if(has_transform)
+    ctx.apply_transform(BLMatrix2D(m[0], m[1], m[2], m[3], m[4], m[5]));
+  ctx.user_to_meta();
+
+  ExecCull cull{&list->items, ctx.final_transform(), clip};
+  size_t offset = 0;
+  BLResult r = exec_ops(
+      ctx, list->ops.data(), list->ops.size(), list->refs, &offset, &canvas->dirty, &cull);
+  ctx.restore();
+
+  if(r != BL_SUCCESS) {
+    const char* reason = r == EXEC_ERROR_INVALID_OP     ? "display_list_replay_invalid_op"
+                         : r == EXEC_ERROR_INVALID_FONT ? "display_list_replay_invalid_font"
+                                                        : "display_list_replay_failed";
+    return make_op_error(env, reason, offset);
+  }
+
+  return enif_make_atom(env, "ok");
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "exec.h"
+
+#include <blend2d/blend2d.h>
+#include <cstdint>
+#include <erl_nif.h>
+#include <vector>
+
+// A command buffer recorded once and replayed natively into any canvas
+// (Blendend.DisplayList). Ops are indexed on creation, so a replay skips the
+// draw ops that fall outside the clip without decoding them. Paths are
+// copied and the other resources kept alive, so the list stays valid and
+// its bounds stay true whatever happens to them later. Lists are immutable
+// and may be replayed from several processes at once.
+struct DisplayList {
+  std::vector<uint8_t> ops;
+  std::vector<ExecRef> refs;
+  std::vector<ExecItem> items;
+  std::vector<Path> paths;  // snapshots the path refs point into
+  std::vector<void*> kept;  // resources held for the other refs
+  BLBox bounds{0, 0, 0, 0}; // union of the item bounds, may be infinite
+
+  void destroy()
+  {
+    for(void* res : kept)
+      enif_release_resource(res);
+    kept.clear();
+    refs.clear();
+    paths.clear();
+  }
+};
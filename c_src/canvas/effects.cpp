@@ -22,14 +22,6 @@ namespace {
     double resolution = 1.0;
   };
 
-  struct BlurImageScratch {
-    BLImage img;
-    int w = 0;
-    int h = 0;
-  };
-
-  thread_local BlurImageScratch blur_image_scratch;
-
   bool parse_blur_opts(
       ErlNifEnv* env, const ERL_NIF_TERM argv[], int argc, int opts_index, BlurOpts& out) {
     if(argc <= opts_index)
@@ -122,6 +114,10 @@ ERL_NIF_TERM canvas_blur_path(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[
     return make_result_error(env, "canvas_blur_path_invalid_args");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   if(sigma <= 0.0)
     return make_result_error(env, "canvas_blur_path_sigma_must_be_positive");
 
@@ -197,26 +193,21 @@ ERL_NIF_TERM canvas_blur_path(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[
   const int w = static_cast<int>(std::ceil(std::max(1.0, width_d * scale)));
   const int h = static_cast<int>(std::ceil(std::max(1.0, height_d * scale)));
 
-  BlurImageScratch& scratch = blur_image_scratch;
-  BLResult r = BL_SUCCESS;
-  // Reuse a thread-local scratch image sized for the current blur.
-  if(scratch.w != w || scratch.h != h || scratch.w <= 0 || scratch.h <= 0) {
-    scratch.img.reset();
-    r = scratch.img.create(w, h, BL_FORMAT_PRGB32);
-    if(r != BL_SUCCESS) {
-      return make_result_error(env, "canvas_blur_path_alloc_failed");
-    }
-    scratch.w = w;
-    scratch.h = h;
+  // The patch is rendered into a pooled surface, shared with layers.
+  PooledSurface scratch(BL_FORMAT_PRGB32, w, h);
+  if(!scratch.valid()) {
+    return make_result_error(env, "canvas_blur_path_alloc_failed");
   }
 
   BLContextCreateInfo ci{};
   BLContext tmp_ctx;
-  r = tmp_ctx.begin(scratch.img, &ci);
+  BLResult r = tmp_ctx.begin(scratch.image(), &ci);
   if(r != BL_SUCCESS) {
     return make_result_error(env, "canvas_blur_path_ctx_failed");
   }
 
+  // Pooled surfaces may be larger than the patch and hold old contents.
+  tmp_ctx.clip_to_rect(BLRectI(0, 0, w, h));
   tmp_ctx.clear_all();
   tmp_ctx.save();
   // Center the path in the padded scratch image and apply optional offset/scale.
@@ -235,7 +226,7 @@ ERL_NIF_TERM canvas_blur_path(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[
 
   // Blur the rasterized patch; sigma is scaled with the raster scale.
   const double sigma_scaled = sigma * scale;
-  r = blur_image_inplace(scratch.img, sigma_scaled, w, h);
+  r = blur_image_inplace(scratch.image(), sigma_scaled, w, h);
   if(r != BL_SUCCESS) {
     return make_result_error(env, "canvas_blur_path_blur_failed");
   }
@@ -249,8 +240,11 @@ ERL_NIF_TERM canvas_blur_path(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[
     canvas->ctx.set_comp_op(style.comp_op);
   const int dst_w = static_cast<int>(std::ceil(std::max(1.0, width_d)));
   const int dst_h = static_cast<int>(std::ceil(std::max(1.0, height_d)));
-  r = canvas->ctx.blit_image(BLRectI(dst_x, dst_y, dst_w, dst_h), scratch.img);
+  r = canvas->ctx.blit_image(BLRectI(dst_x, dst_y, dst_w, dst_h), scratch.image(), BLRectI(0, 0, w, h));
+  canvas->dirty.add(canvas->ctx, BLBox(dst_x, dst_y, dst_x + dst_w, dst_y + dst_h));
   canvas->ctx.restore();
+  // The surface goes back to the pool on return.
+  canvas->ctx.flush(BL_CONTEXT_FLUSH_SYNC);
 
   if(r != BL_SUCCESS) {
     return make_result_error(env, "canvas_blur_path_blit_failed");
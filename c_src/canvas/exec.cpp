@@ -0,0 +1,597 @@
+#include "exec.h"
+#include "canvas.h"
+#include "../nif/nif_resource.h"
+#include "../nif/nif_util.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Wire positions of the atoms accepted by parse_style (see Blendend.Draw.Batch).
+const BLStrokeCap kCaps[] = {BL_STROKE_CAP_BUTT,
+                             BL_STROKE_CAP_ROUND,
+                             BL_STROKE_CAP_SQUARE,
+                             BL_STROKE_CAP_ROUND_REV,
+                             BL_STROKE_CAP_TRIANGLE,
+                             BL_STROKE_CAP_TRIANGLE_REV};
+
+const BLStrokeJoin kJoins[] = {BL_STROKE_JOIN_MITER_CLIP,
+                               BL_STROKE_JOIN_ROUND,
+                               BL_STROKE_JOIN_BEVEL,
+                               BL_STROKE_JOIN_MITER_BEVEL,
+                               BL_STROKE_JOIN_MITER_ROUND};
+
+const BLCompOp kCompOps[] = {BL_COMP_OP_SRC_OVER,   BL_COMP_OP_SRC_COPY,    BL_COMP_OP_SRC_IN,
+                             BL_COMP_OP_SRC_OUT,    BL_COMP_OP_SRC_ATOP,    BL_COMP_OP_DST_OVER,
+                             BL_COMP_OP_DST_COPY,   BL_COMP_OP_DST_IN,      BL_COMP_OP_DST_OUT,
+                             BL_COMP_OP_DST_ATOP,   BL_COMP_OP_DIFFERENCE,  BL_COMP_OP_MULTIPLY,
+                             BL_COMP_OP_SCREEN,     BL_COMP_OP_OVERLAY,     BL_COMP_OP_XOR,
+                             BL_COMP_OP_CLEAR,      BL_COMP_OP_PLUS,        BL_COMP_OP_MINUS,
+                             BL_COMP_OP_MODULATE,   BL_COMP_OP_DARKEN,      BL_COMP_OP_LIGHTEN,
+                             BL_COMP_OP_COLOR_DODGE, BL_COMP_OP_COLOR_BURN, BL_COMP_OP_LINEAR_BURN,
+                             BL_COMP_OP_PIN_LIGHT,  BL_COMP_OP_HARD_LIGHT,  BL_COMP_OP_SOFT_LIGHT,
+                             BL_COMP_OP_EXCLUSION};
+
+template <typename T, size_t N>
+constexpr size_t table_size(const T (&)[N])
+{
+  return N;
+}
+
+// Bounds-checked cursor over the op binary; binaries carry no alignment
+// guarantee, so every read goes through memcpy.
+struct OpReader {
+  const uint8_t* p;
+  const uint8_t* end;
+
+  template <typename T>
+  bool read(T* out)
+  {
+    if(size_t(end - p) < sizeof(T))
+      return false;
+    std::memcpy(out, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+  }
+
+  bool read_doubles(double* out, int n)
+  {
+    if(size_t(end - p) < sizeof(double) * size_t(n))
+      return false;
+    std::memcpy(out, p, sizeof(double) * size_t(n));
+    p += sizeof(double) * size_t(n);
+    return true;
+  }
+
+  bool read_bytes(size_t n, const uint8_t** out)
+  {
+    if(size_t(end - p) < n)
+      return false;
+    *out = p;
+    p += n;
+    return true;
+  }
+};
+
+// Puts the style back to what a plain draw call starts from.
+void reset_style(BLContext& ctx)
+{
+  static const Style defaults;
+
+  ctx.set_comp_op(BL_COMP_OP_SRC_OVER);
+  ctx.set_global_alpha(1.0);
+  ctx.set_fill_style(BLRgba32(0xFF000000u));
+  ctx.set_stroke_style(BLRgba32(0xFF000000u));
+  ctx.set_stroke_alpha(1.0);
+  ctx.set_stroke_options(defaults.stroke_opts);
+}
+
+bool assign_brush(const ExecRef& ref, Color** color, Gradient** gradient, Pattern** pattern)
+{
+  *color = ref.color;
+  *gradient = ref.gradient;
+  *pattern = ref.pattern;
+  return ref.color || ref.gradient || ref.pattern;
+}
+
+bool read_style(OpReader& in, const std::vector<ExecRef>& refs, Style* style)
+{
+  uint8_t flags;
+  if(!in.read(&flags))
+    return false;
+
+  if(flags & EXEC_STYLE_FILL) {
+    uint32_t idx;
+    if(!in.read(&idx) || idx >= refs.size())
+      return false;
+    if(!assign_brush(refs[idx], &style->color, &style->gradient, &style->pattern))
+      return false;
+  }
+
+  if(flags & EXEC_STYLE_STROKE) {
+    uint32_t idx;
+    if(!in.read(&idx) || idx >= refs.size())
+      return false;
+    if(!assign_brush(
+           refs[idx], &style->stroke_color, &style->stroke_gradient, &style->stroke_pattern))
+      return false;
+  }
+
+  if(flags & EXEC_STYLE_STROKE_OPTS) {
+    uint8_t start_cap, end_cap, join;
+    if(!in.read(&style->stroke_opts.width) || !in.read(&style->stroke_opts.miter_limit) ||
+       !in.read(&start_cap) || !in.read(&end_cap) || !in.read(&join))
+      return false;
+    if(start_cap >= table_size(kCaps) || end_cap >= table_size(kCaps) ||
+       join >= table_size(kJoins))
+      return false;
+    style->stroke_opts.start_cap = uint8_t(kCaps[start_cap]);
+    style->stroke_opts.end_cap = uint8_t(kCaps[end_cap]);
+    style->stroke_opts.join = uint8_t(kJoins[join]);
+    style->has_stroke_opts = true;
+  }
+
+  if(flags & EXEC_STYLE_ALPHA) {
+    if(!in.read(&style->alpha))
+      return false;
+  }
+
+  if(flags & EXEC_STYLE_STROKE_ALPHA) {
+    if(!in.read(&style->stroke_alpha))
+      return false;
+    style->stroke_alpha_set = true;
+  }
+
+  if(flags & EXEC_STYLE_COMP_OP) {
+    uint8_t op;
+    if(!in.read(&op) || op >= table_size(kCompOps))
+      return false;
+    style->comp_op = kCompOps[op];
+    style->has_comp_op = true;
+  }
+
+  return true;
+}
+
+bool read_points(OpReader& in, std::vector<BLPoint>* out)
+{
+  uint32_t n;
+  const uint8_t* bytes;
+  if(!in.read(&n) || !in.read_bytes(size_t(n) * sizeof(BLPoint), &bytes))
+    return false;
+
+  out->resize(n);
+  if(n)
+    std::memcpy(out->data(), bytes, size_t(n) * sizeof(BLPoint));
+  return true;
+}
+
+// Decodes and draws one FILL_*/STROKE_* op and, if `bounds` is given, stores
+// the shape's user-space bounds there (non-finite when unknown). Returns
+// EXEC_ERROR_INVALID_OP for malformed payloads, EXEC_ERROR_INVALID_FONT for
+// text in a font without a face, otherwise the result of the Blend2D call.
+BLResult exec_shape(BLContext& ctx,
+                    OpReader& in,
+                    bool fill,
+                    uint8_t shape,
+                    const std::vector<ExecRef>& refs,
+                    std::vector<BLPoint>& points,
+                    BLBox* bounds)
+{
+  double a[6];
+
+  switch(shape) {
+  case EXEC_SHAPE_RECT: {
+    if(!in.read_doubles(a, 4))
+      return EXEC_ERROR_INVALID_OP;
+    const BLRect g(a[0], a[1], a[2], a[3]);
+    if(bounds)
+      *bounds = shape_bounds(g);
+    return fill ? ctx.fill_rect(g) : ctx.stroke_rect(g);
+  }
+
+  case EXEC_SHAPE_BOX: {
+    if(!in.read_doubles(a, 4))
+      return EXEC_ERROR_INVALID_OP;
+    const BLBox g(a[0], a[1], a[2], a[3]);
+    if(bounds)
+      *bounds = shape_bounds(g);
+    return fill ? ctx.fill_box(g) : ctx.stroke_box(g);
+  }
+
+  case EXEC_SHAPE_CIRCLE: {
+    if(!in.read_doubles(a, 3))
+      return EXEC_ERROR_INVALID_OP;
+    const BLCircle g(a[0], a[1], a[2]);
+    if(bounds)
+      *bounds = shape_bounds(g);
+    return fill ? ctx.fill_circle(g) : ctx.stroke_circle(g);
+  }
+
+  case EXEC_SHAPE_ELLIPSE: {
+    if(!in.read_doubles(a, 4))
+      return EXEC_ERROR_INVALID_OP;
+    const BLEllipse g(a[0], a[1], a[2], a[3]);
+    if(bounds)
+      *bounds = shape_bounds(g);
+    return fill ? ctx.fill_ellipse(g) : ctx.stroke_ellipse(g);
+  }
+
+  case EXEC_SHAPE_ROUND_RECT: {
+    if(!in.read_doubles(a, 6))
+      return EXEC_ERROR_INVALID_OP;
+    const BLRoundRect g(a[0], a[1], a[2], a[3], a[4], a[5]);
+    if(bounds)
+      *bounds = shape_bounds(g);
+    return fill ? ctx.fill_round_rect(g) : ctx.stroke_round_rect(g);
+  }
+
+  case EXEC_SHAPE_TRIANGLE: {
+    if(!in.read_doubles(a, 6))
+      return EXEC_ERROR_INVALID_OP;
+    const BLTriangle g(a[0], a[1], a[2], a[3], a[4], a[5]);
+    if(bounds)
+      *bounds = shape_bounds(g);
+    return fill ? ctx.fill_triangle(g) : ctx.stroke_triangle(g);
+  }
+
+  case EXEC_SHAPE_CHORD: {
+    if(!in.read_doubles(a, 6))
+      return EXEC_ERROR_INVALID_OP;
+    const BLArc g(a[0], a[1], a[2], a[3], a[4], a[5]);
+    if(bounds)
+      *bounds = shape_bounds(g);
+    return fill ? ctx.fill_chord(g) : ctx.stroke_chord(g);
+  }
+
+  case EXEC_SHAPE_PIE: {
+    if(!in.read_doubles(a, 6))
+      return EXEC_ERROR_INVALID_OP;
+    const BLArc g(a[0], a[1], a[2], a[3], a[4], a[5]);
+    if(bounds)
+      *bounds = shape_bounds(g);
+    return fill ? ctx.fill_pie(g) : ctx.stroke_pie(g);
+  }
+
+  case EXEC_SHAPE_LINE: {
+    if(fill || !in.read_doubles(a, 4))
+      return EXEC_ERROR_INVALID_OP;
+    const BLLine g(a[0], a[1], a[2], a[3]);
+    if(bounds)
+      *bounds = shape_bounds(g);
+    return ctx.stroke_line(g);
+  }
+
+  case EXEC_SHAPE_ARC: {
+    if(fill || !in.read_doubles(a, 6))
+      return EXEC_ERROR_INVALID_OP;
+    const BLArc g(a[0], a[1], a[2], a[3], a[4], a[5]);
+    if(bounds)
+      *bounds = shape_bounds(g);
+    return ctx.stroke_arc(g);
+  }
+
+  case EXEC_SHAPE_POLYGON:
+  case EXEC_SHAPE_POLYLINE: {
+    if((fill && shape == EXEC_SHAPE_POLYLINE) || !read_points(in, &points))
+      return EXEC_ERROR_INVALID_OP;
+    BLArrayView<BLPoint> view;
+    view.reset(points.data(), points.size());
+    if(bounds)
+      *bounds = shape_bounds(view);
+    if(fill)
+      return ctx.fill_polygon(view);
+    return shape == EXEC_SHAPE_POLYGON ? ctx.stroke_polygon(view) : ctx.stroke_polyline(view);
+  }
+
+  case EXEC_SHAPE_PATH: {
+    uint32_t idx;
+    if(!in.read(&idx) || idx >= refs.size() || !refs[idx].path)
+      return EXEC_ERROR_INVALID_OP;
+    const BLPath& path = refs[idx].path->value;
+    if(bounds && path.get_bounding_box(bounds) != BL_SUCCESS)
+      *bounds = BLBox(-INFINITY, -INFINITY, INFINITY, INFINITY);
+    return fill ? ctx.fill_path(path) : ctx.stroke_path(path);
+  }
+
+  case EXEC_SHAPE_TEXT: {
+    uint32_t idx, len;
+    const uint8_t* text;
+    if(!in.read(&idx) || idx >= refs.size() || !refs[idx].font || !in.read_doubles(a, 2) ||
+       !in.read(&len) || !in.read_bytes(len, &text))
+      return EXEC_ERROR_INVALID_OP;
+
+    BLStringView view{reinterpret_cast<const char*>(text), len};
+    const BLFont& font = refs[idx].font->value;
+    if(!font.is_valid())
+      return EXEC_ERROR_INVALID_FONT;
+    if(bounds && !text_bounds(font, BLPoint(a[0], a[1]), view, bounds))
+      *bounds = BLBox(-INFINITY, -INFINITY, INFINITY, INFINITY);
+    return fill ? ctx.fill_utf8_text(BLPoint(a[0], a[1]), font, view)
+                : ctx.stroke_utf8_text(BLPoint(a[0], a[1]), font, view);
+  }
+
+  default:
+    return EXEC_ERROR_INVALID_OP;
+  }
+}
+
+} // namespace
+
+bool exec_resolve_refs(ErlNifEnv* env, ERL_NIF_TERM tuple, std::vector<ExecRef>* out)
+{
+  int arity;
+  const ERL_NIF_TERM* items;
+  if(!enif_get_tuple(env, tuple, &arity, &items))
+    return false;
+
+  out->resize(size_t(arity));
+  for(int i = 0; i < arity; i++) {
+    ExecRef& ref = (*out)[size_t(i)];
+    if((ref.color = NifResource<Color>::get(env, items[i])))
+      continue;
+    if((ref.gradient = NifResource<Gradient>::get(env, items[i])))
+      continue;
+    if((ref.pattern = NifResource<Pattern>::get(env, items[i])))
+      continue;
+    if((ref.path = NifResource<Path>::get(env, items[i])))
+      continue;
+    if((ref.font = NifResource<Font>::get(env, items[i])))
+      continue;
+    return false;
+  }
+
+  return true;
+}
+
+namespace {
+
+// Whether a culled replay has to draw `item`. One device pixel of slack
+// covers antialiasing.
+bool item_visible(const ExecCull& cull, const ExecItem& item)
+{
+  const BLBox& b = item.bounds;
+  if(!std::isfinite(b.x0) || !std::isfinite(b.y0) || !std::isfinite(b.x1) || !std::isfinite(b.y1))
+    return true;
+
+  const BLBox d = transform_bounds(cull.transform, b);
+  return d.x0 - 1.0 < cull.clip.x1 && cull.clip.x0 < d.x1 + 1.0 && d.y0 - 1.0 < cull.clip.y1 &&
+         cull.clip.y0 < d.y1 + 1.0;
+}
+
+BLResult exec_run(BLContext& ctx,
+                  const uint8_t* data,
+                  size_t size,
+                  const std::vector<ExecRef>& refs,
+                  size_t* error_offset,
+                  DirtyRegion* dirty,
+                  const ExecCull* cull,
+                  std::vector<ExecItem>* index)
+{
+  thread_local std::vector<BLPoint> points;
+  size_t item = 0;
+
+  OpReader in{data, data + size};
+  BLResult result = BL_SUCCESS;
+  int depth = 0;
+
+  ctx.save();
+
+  while(in.p < in.end) {
+    const uint8_t* op_start = in.p;
+    uint8_t op = *in.p++;
+    double a[6];
+    bool ok = true;
+
+    switch(op) {
+    case EXEC_OP_SAVE:
+      result = ctx.save();
+      depth++;
+      break;
+
+    case EXEC_OP_RESTORE:
+      if(depth == 0) {
+        ok = false;
+        break;
+      }
+      result = ctx.restore();
+      depth--;
+      break;
+
+    case EXEC_OP_TRANSLATE:
+      ok = in.read_doubles(a, 2);
+      if(ok)
+        result = ctx.translate(a[0], a[1]);
+      break;
+
+    case EXEC_OP_SCALE:
+      ok = in.read_doubles(a, 2);
+      if(ok)
+        result = ctx.scale(a[0], a[1]);
+      break;
+
+    case EXEC_OP_ROTATE:
+      ok = in.read_doubles(a, 1);
+      if(ok)
+        result = ctx.rotate(a[0]);
+      break;
+
+    case EXEC_OP_ROTATE_AT:
+      ok = in.read_doubles(a, 3);
+      if(ok)
+        result = ctx.rotate(a[0], a[1], a[2]);
+      break;
+
+    case EXEC_OP_SKEW:
+      ok = in.read_doubles(a, 2);
+      if(ok)
+        result = ctx.skew(a[0], a[1]);
+      break;
+
+    case EXEC_OP_TRANSFORM:
+    case EXEC_OP_SET_TRANSFORM:
+      ok = in.read_doubles(a, 6);
+      if(ok) {
+        BLMatrix2D m(a[0], a[1], a[2], a[3], a[4], a[5]);
+        result = op == EXEC_OP_TRANSFORM ? ctx.apply_transform(m) : ctx.set_transform(m);
+      }
+      break;
+
+    case EXEC_OP_RESET_TRANSFORM:
+      result = ctx.reset_transform();
+      break;
+
+    case EXEC_OP_STYLE: {
+      Style style;
+      ok = read_style(in, refs, &style);
+      if(ok) {
+        reset_style(ctx);
+        style.apply(&ctx);
+      }
+      break;
+    }
+
+    default:
+      if(op & (EXEC_OP_FILL | EXEC_OP_STROKE)) {
+        bool fill = (op & EXEC_OP_FILL) != 0;
+        bool stroke = (op & EXEC_OP_STROKE) != 0;
+        if(fill == stroke) {
+          ok = false;
+          break;
+        }
+        if(cull) {
+          const std::vector<ExecItem>& items = *cull->items;
+          if(item >= items.size() || items[item].begin != size_t(op_start - data)) {
+            ok = false;
+            break;
+          }
+          if(!item_visible(*cull, items[item])) {
+            in.p = data + items[item++].end;
+            break;
+          }
+          item++;
+        }
+
+        BLBox bounds;
+        result = exec_shape(ctx,
+                            in,
+                            fill,
+                            uint8_t(op & 0x3F),
+                            refs,
+                            points,
+                            dirty || index ? &bounds : nullptr);
+        if(dirty && result == BL_SUCCESS)
+          dirty->add(ctx, bounds);
+        if(index && result == BL_SUCCESS) {
+          BLBox device;
+          if(!device_bounds(ctx, bounds, &device))
+            device = BLBox(-INFINITY, -INFINITY, INFINITY, INFINITY);
+          index->push_back(
+              ExecItem{uint32_t(op_start - data), uint32_t(in.p - data), device});
+        }
+      }
+      else {
+        ok = false;
+      }
+      break;
+    }
+
+    if(!ok)
+      result = EXEC_ERROR_INVALID_OP;
+
+    if(result != BL_SUCCESS) {
+      *error_offset = size_t(op_start - data);
+      break;
+    }
+  }
+
+  while(depth-- > 0)
+    ctx.restore();
+  ctx.restore();
+
+  return result;
+}
+
+} // namespace
+
+BLResult exec_ops(BLContext& ctx,
+                  const uint8_t* data,
+                  size_t size,
+                  const std::vector<ExecRef>& refs,
+                  size_t* error_offset,
+                  DirtyRegion* dirty,
+                  const ExecCull* cull)
+{
+  return exec_run(ctx, data, size, refs, error_offset, dirty, cull, nullptr);
+}
+
+BLResult exec_index(const uint8_t* data,
+                    size_t size,
+                    const std::vector<ExecRef>& refs,
+                    std::vector<ExecItem>* out,
+                    size_t* error_offset)
+{
+  if(size > UINT32_MAX) {
+    *error_offset = 0;
+    return EXEC_ERROR_INVALID_OP;
+  }
+
+  // A context on a scratch pixel tracks transforms and styles; the empty
+  // clip turns every draw call into a no-op.
+  BLImage img(1, 1, BL_FORMAT_PRGB32);
+  BLContext ctx;
+  if(ctx.begin(img) != BL_SUCCESS)
+    return BL_ERROR_OUT_OF_MEMORY;
+  ctx.clip_to_rect(BLRectI(0, 0, 0, 0));
+
+  out->clear();
+  BLResult r = exec_run(ctx, data, size, refs, error_offset, nullptr, nullptr, out);
+  ctx.end();
+  return r;
+}
+
+// Canvas.exec(canvas, ops)
+// Canvas.exec(canvas, ops, refs)
+//
+// ops  :: iodata, see exec.h for the encoding (built by Blendend.Draw.Batch)
+// refs :: tuple of resources referenced by index from the ops
+//
+// Returns :ok, or {:error, {reason, byte_offset}} for the first op that
+// could not be decoded (canvas_exec_invalid_op), names a font without a face
+// (canvas_exec_invalid_font) or failed to draw (canvas_exec_failed).
+ERL_NIF_TERM canvas_exec(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc < 2 || argc > 3)
+    return enif_make_badarg(env);
+
+  auto canvas = NifResource<Canvas>::get(env, argv[0]);
+  if(canvas == nullptr)
+    return make_result_error(env, "canvas_exec_invalid_canvas");
+
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
+  ErlNifBinary ops;
+  if(!enif_inspect_iolist_as_binary(env, argv[1], &ops))
+    return make_result_error(env, "canvas_exec_invalid_ops");
+
+  std::vector<ExecRef> refs;
+  if(argc == 3 && !exec_resolve_refs(env, argv[2], &refs))
+    return make_result_error(env, "canvas_exec_invalid_refs");
+
+  size_t offset = 0;
+  BLResult r = exec_ops(canvas->ctx, ops.data, ops.size, refs, &offset, &canvas->dirty);
+  if(r != BL_SUCCESS) {
+    const char* reason = r == EXEC_ERROR_INVALID_OP     ? "canvas_exec_invalid_op"
+                         : r == EXEC_ERROR_INVALID_FONT ? "canvas_exec_invalid_font"
+                                                        : "canvas_exec_failed";
+    return enif_make_tuple2(
+        env,
+        enif_make_atom(env, "error"),
+        enif_make_tuple2(env, enif_make_atom(env, reason), enif_make_ulong(env, offset)));
+  }
+
+  return enif_make_atom(env, "ok");
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include "../geometries/path.h"
+#include "../styles/styles.h"
+#include "../text/font.h"
+#include "dirty.h"
+
+#include <blend2d/blend2d.h>
+#include <cstddef>
+#include <cstdint>
+#include <erl_nif.h>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// Command buffer ops
+// ----------------------------------------------------------------------------
+// A command buffer is a flat binary of ops. Every op starts with one opcode
+// byte followed by its payload; numbers are native-endian f64, counts and
+// reference indices native-endian u32. Resources (colors, gradients, patterns,
+// paths, fonts) are not serialized; ops refer to them by index into a refs
+// tuple passed next to the binary.
+//
+//   SAVE / RESTORE / RESET_TRANSFORM            -> no payload
+//   TRANSLATE, SCALE, SKEW                      -> f64 a, f64 b
+//   ROTATE                                      -> f64 angle
+//   ROTATE_AT                                   -> f64 angle, f64 cx, f64 cy
+//   TRANSFORM, SET_TRANSFORM                    -> 6 x f64 (m00 m01 m10 m11 m20 m21)
+//   STYLE                                       -> u8 flags, then per flag (in bit order):
+//       STYLE_FILL         u32 ref
+//       STYLE_STROKE       u32 ref
+//       STYLE_STROKE_OPTS  f64 width, f64 miter_limit, u8 start_cap, u8 end_cap, u8 join
+//       STYLE_ALPHA        f64
+//       STYLE_STROKE_ALPHA f64
+//       STYLE_COMP_OP      u8
+//   FILL_* / STROKE_* (opcode = mode | shape)   -> shape payload:
+//       RECT, BOX, ELLIPSE, LINE                4 x f64
+//       CIRCLE                                  3 x f64
+//       ROUND_RECT, TRIANGLE, CHORD, PIE, ARC   6 x f64
+//       POLYGON, POLYLINE                       u32 n, n x (f64 x, f64 y)
+//       PATH                                    u32 ref
+//       TEXT                                    u32 font ref, f64 x, f64 y, u32 len, len bytes
+//
+// STYLE replaces the whole draw style: everything not listed falls back to
+// the defaults a plain draw call would see. Caps, joins and comp ops are
+// encoded by their position in the tables in exec.cpp.
+
+enum ExecOp : uint8_t {
+  EXEC_OP_SAVE = 0x01,
+  EXEC_OP_RESTORE = 0x02,
+  EXEC_OP_TRANSLATE = 0x10,
+  EXEC_OP_SCALE = 0x11,
+  EXEC_OP_ROTATE = 0x12,
+  EXEC_OP_ROTATE_AT = 0x13,
+  EXEC_OP_SKEW = 0x14,
+  EXEC_OP_TRANSFORM = 0x15,
+  EXEC_OP_SET_TRANSFORM = 0x16,
+  EXEC_OP_RESET_TRANSFORM = 0x17,
+  EXEC_OP_STYLE = 0x20,
+  EXEC_OP_FILL = 0x40,
+  EXEC_OP_STROKE = 0x80
+};
+
+enum ExecShape : uint8_t {
+  EXEC_SHAPE_RECT = 1,
+  EXEC_SHAPE_BOX = 2,
+  EXEC_SHAPE_CIRCLE = 3,
+  EXEC_SHAPE_ELLIPSE = 4,
+  EXEC_SHAPE_ROUND_RECT = 5,
+  EXEC_SHAPE_TRIANGLE = 6,
+  EXEC_SHAPE_CHORD = 7,
+  EXEC_SHAPE_PIE = 8,
+  EXEC_SHAPE_LINE = 9,
+  EXEC_SHAPE_ARC = 10,
+  EXEC_SHAPE_POLYGON = 11,
+  EXEC_SHAPE_POLYLINE = 12,
+  EXEC_SHAPE_PATH = 13,
+  EXEC_SHAPE_TEXT = 14
+};
+
+enum ExecStyleFlag : uint8_t {
+  EXEC_STYLE_FILL = 0x01,
+  EXEC_STYLE_STROKE = 0x02,
+  EXEC_STYLE_STROKE_OPTS = 0x04,
+  EXEC_STYLE_ALPHA = 0x08,
+  EXEC_STYLE_STROKE_ALPHA = 0x10,
+  EXEC_STYLE_COMP_OP = 0x20
+};
+
+// Results of exec_ops and exec_index besides Blend2D's own: an op that could
+// not be decoded, and a text op whose font holds no face. Both lie outside
+// the range of Blend2D's error codes, so a failed draw call is never
+// mistaken for a malformed buffer.
+enum ExecError : BLResult {
+  EXEC_ERROR_INVALID_OP = 0x7F000001u,
+  EXEC_ERROR_INVALID_FONT = 0x7F000002u
+};
+
+// A refs tuple element resolved once per replay. Exactly one pointer is set.
+struct ExecRef {
+  Color* color = nullptr;
+  Gradient* gradient = nullptr;
+  Pattern* pattern = nullptr;
+  Path* path = nullptr;
+  Font* font = nullptr;
+};
+
+// Resolves every element of a refs tuple. Returns false if the term is not a
+// tuple or one of its elements is not a supported resource.
+bool exec_resolve_refs(ErlNifEnv* env, ERL_NIF_TERM tuple, std::vector<ExecRef>* out);
+
+// A draw op located by exec_index: its byte range in the buffer and the box
+// it covers in the buffer's own space (the user space the replay starts
+// from), padded for strokes but not for antialiasing. Ops whose extent is
+// unbounded get infinite bounds.
+struct ExecItem {
+  uint32_t begin;
+  uint32_t end;
+  BLBox bounds;
+};
+
+// Makes exec_ops skip the draw ops whose indexed bounds, mapped through
+// `transform`, miss the device-space `clip`. `items` must come from
+// exec_index over the same buffer.
+struct ExecCull {
+  const std::vector<ExecItem>* items;
+  BLMatrix2D transform;
+  BLBox clip;
+};
+
+// Replays `size` bytes of ops onto `ctx`. The context state is saved before
+// the first op and restored afterwards, so nothing leaks past the call.
+// On malformed input returns EXEC_ERROR_INVALID_OP, and for a text op with an
+// invalid font EXEC_ERROR_INVALID_FONT; on those and on a failed Blend2D call
+// the offset of the failing op is stored in `error_offset`. When `dirty` is given, the bounds of
+// every drawn shape are added to it.
+BLResult exec_ops(BLContext& ctx,
+                  const uint8_t* data,
+                  size_t size,
+                  const std::vector<ExecRef>& refs,
+                  size_t* error_offset,
+                  DirtyRegion* dirty = nullptr,
+                  const ExecCull* cull = nullptr);
+
+// Decodes `size` bytes of ops without drawing anything and stores an
+// ExecItem for every draw op in `out`. Fails like exec_ops on malformed
+// input.
+BLResult exec_index(const uint8_t* data,
+                    size_t size,
+                    const std::vector<ExecRef>& refs,
+                    std::vector<ExecItem>* out,
+                    size_t* error_offset);
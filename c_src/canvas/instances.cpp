@@ -0,0 +1,285 @@
+#include "canvas.h"
+#include "dirty.h"
+#include "../geometries/path.h"
+#include "../nif/nif_array.h"
+#include "../nif/nif_resource.h"
+#include "../nif/nif_util.h"
+#include "../styles/styles.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Instanced fills (Canvas.fill_instances/4).
+//
+// One shape is filled at many positions in a single call, the style set up
+// once. Consecutive instances of the same color are merged into one path
+// and filled together when the fill is an opaque solid color, composed
+// source-over without global alpha and with the non-zero fill rule. Their
+// union is then painted once: visually equivalent to drawing one by one,
+// but anti-aliased edges where instances overlap are blended once rather
+// than once per instance, so those pixels may differ slightly.
+
+namespace {
+
+enum InstanceShape { INSTANCE_CIRCLE, INSTANCE_RECT, INSTANCE_PATH };
+
+// Instances merged into one path before it is filled.
+constexpr size_t kBatchInstances = 4096;
+
+struct Instances {
+  InstanceShape shape;
+  double w = 0.0, h = 0.0; // circle radius in w, rect size
+  const BLPath* path = nullptr;
+  BLBox path_box{};
+
+  BLArrayView<BLPoint> positions;
+  const uint8_t* scales = nullptr;    // f64 per instance, or none
+  const uint8_t* rotations = nullptr; // f64 radians per instance, or none
+  const uint8_t* colors = nullptr;    // RGBA bytes per instance, or none
+};
+
+double load_f64(const uint8_t* p, size_t i)
+{
+  double v;
+  std::memcpy(&v, p + i * sizeof(double), sizeof(double));
+  return v;
+}
+
+bool get_shape(ErlNifEnv* env, ERL_NIF_TERM term, Instances* out)
+{
+  if(auto path = NifResource<Path>::get(env, term)) {
+    out->shape = INSTANCE_PATH;
+    out->path = &path->value;
+    return true;
+  }
+
+  int arity;
+  const ERL_NIF_TERM* items;
+  char tag[8];
+  if(!enif_get_tuple(env, term, &arity, &items) || arity < 2 ||
+     !enif_get_atom(env, items[0], tag, sizeof(tag), ERL_NIF_UTF8))
+    return false;
+
+  if(strcmp(tag, "circle") == 0 && arity == 2) {
+    out->shape = INSTANCE_CIRCLE;
+    return enif_get_double(env, items[1], &out->w) && out->w >= 0.0;
+  }
+  if(strcmp(tag, "rect") == 0 && arity == 3) {
+    out->shape = INSTANCE_RECT;
+    return enif_get_double(env, items[1], &out->w) && enif_get_double(env, items[2], &out->h) &&
+           out->w >= 0.0 && out->h >= 0.0;
+  }
+  return false;
+}
+
+// A binary with `stride` bytes per instance, or nil.
+bool get_per_instance(
+    ErlNifEnv* env, ERL_NIF_TERM term, size_t n, size_t stride, const uint8_t** out)
+{
+  *out = nullptr;
+  if(enif_is_identical(term, enif_make_atom(env, "nil")))
+    return true;
+
+  ErlNifBinary bin;
+  if(!enif_inspect_binary(env, term, &bin) || bin.size != n * stride)
+    return false;
+  *out = bin.data;
+  return true;
+}
+
+// Corners of a w x h rect centered on `p` and rotated by `angle`, in the
+// order add_rect makes them.
+void rect_corners(const BLPoint& p, double hw, double hh, double angle, BLPoint* out)
+{
+  const double c = std::cos(angle), s = std::sin(angle);
+  const double xs[4] = {-hw, hw, hw, -hw};
+  const double ys[4] = {-hh, -hh, hh, hh};
+  for(int k = 0; k < 4; k++)
+    out[k].reset(p.x + xs[k] * c - ys[k] * s, p.y + xs[k] * s + ys[k] * c);
+}
+
+void add_bounds(BLBox* acc, const BLBox& box)
+{
+  acc->x0 = std::min(acc->x0, box.x0);
+  acc->y0 = std::min(acc->y0, box.y0);
+  acc->x1 = std::max(acc->x1, box.x1);
+  acc->y1 = std::max(acc->y1, box.y1);
+}
+
+BLResult fill_instances(BLContext& ctx, const Instances& in, bool can_merge, BLBox* bounds)
+{
+  const size_t n = in.positions.size;
+  const BLMatrix2D base = ctx.user_transform();
+
+  BLPath batch;
+  size_t batched = 0;
+  auto flush = [&]() -> BLResult {
+    if(batched == 0)
+      return BL_SUCCESS;
+    batched = 0;
+    BLResult r = ctx.fill_path(batch);
+    batch.clear();
+    return r;
+  };
+
+  uint32_t color = 0;
+  bool has_color = false;
+  for(size_t i = 0; i < n; i++) {
+    const BLPoint& p = in.positions.data[i];
+    const double scale = in.scales ? load_f64(in.scales, i) : 1.0;
+    const double angle = in.rotations ? load_f64(in.rotations, i) : 0.0;
+    if(!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(scale) ||
+       !std::isfinite(angle))
+      continue;
+
+    if(in.colors) {
+      const uint8_t* c = in.colors + i * 4;
+      const uint32_t rgba = BLRgba32(c[0], c[1], c[2], c[3]).value;
+      if(!has_color || rgba != color) {
+        if(BLResult r = flush())
+          return r;
+        color = rgba;
+        has_color = true;
+        ctx.set_fill_style(BLRgba32(rgba));
+      }
+    }
+    const bool merge = can_merge && (!in.colors || (color >> 24) == 0xFFu);
+
+    BLResult r = BL_SUCCESS;
+    switch(in.shape) {
+    case INSTANCE_CIRCLE: {
+      const BLCircle circle(p.x, p.y, in.w * std::abs(scale));
+      r = merge ? batch.add_circle(circle) : ctx.fill_circle(circle);
+      add_bounds(bounds, shape_bounds(circle));
+      break;
+    }
+
+    case INSTANCE_RECT: {
+      const double hw = in.w * std::abs(scale) * 0.5, hh = in.h * std::abs(scale) * 0.5;
+      if(angle == 0.0) {
+        const BLRect rect(p.x - hw, p.y - hh, hw * 2.0, hh * 2.0);
+        r = merge ? batch.add_rect(rect) : ctx.fill_rect(rect);
+        add_bounds(bounds, shape_bounds(rect));
+        break;
+      }
+      BLPoint corners[4];
+      rect_corners(p, hw, hh, angle, corners);
+      BLArrayView<BLPoint> view;
+      view.reset(corners, 4);
+      r = merge ? batch.add_polygon(view, BL_GEOMETRY_DIRECTION_CW) : ctx.fill_polygon(view);
+      add_bounds(bounds, shape_bounds(view));
+      break;
+    }
+
+    case INSTANCE_PATH: {
+      // Paths may carry their own winding, which merging could cancel out,
+      // so each one is filled on its own.
+      BLMatrix2D local = BLMatrix2D::make_translation(p.x, p.y);
+      local.rotate(angle);
+      local.scale(scale, scale);
+      BLMatrix2D m = base;
+      m.transform(local);
+      ctx.set_transform(m);
+      r = ctx.fill_path(*in.path);
+      add_bounds(bounds, transform_bounds(local, in.path_box));
+      break;
+    }
+    }
+    if(r != BL_SUCCESS)
+      return r;
+
+    if(merge && ++batched >= kBatchInstances) {
+      if(BLResult fr = flush())
+        return fr;
+    }
+  }
+
+  if(in.shape == INSTANCE_PATH)
+    ctx.set_transform(base);
+  return flush();
+}
+
+} // namespace
+
+// canvas_fill_instances(canvas, shape, positions, scales, rotations, colors, opts)
+//   -> :ok | {:error, reason}
+//
+//   shape     :: {:circle, r} | {:rect, w, h} | Path, drawn centered (circle,
+//                rect) or with its origin at each position (path)
+//   positions :: [{x, y}] | packed f64 | {:f32, binary}
+//   scales    :: binary of native-endian f64 per instance | nil
+//   rotations :: binary of native-endian f64 radians per instance | nil;
+//                circles ignore it
+//   colors    :: binary of 4 bytes (r, g, b, a) per instance | nil; when
+//                given it replaces the fill of `opts`
+//   opts      :: style options or a compiled style, applied once
+//
+// Instances with a non-finite position, scale or rotation are skipped.
+ERL_NIF_TERM canvas_fill_instances(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 7)
+    return enif_make_badarg(env);
+
+  auto canvas = NifResource<Canvas>::get(env, argv[0]);
+  if(canvas == nullptr)
+    return make_result_error(env, "canvas_fill_instances_invalid_canvas");
+
+  Instances in;
+  if(!get_shape(env, argv[1], &in))
+    return make_result_error(env, "canvas_fill_instances_invalid_shape");
+
+  ArrayArg<BLPoint> positions;
+  if(!get_array_arg(env, argv[2], &positions))
+    return make_result_error(env, "canvas_fill_instances_invalid_positions");
+  in.positions = positions.view;
+
+  const size_t n = in.positions.size;
+  if(!get_per_instance(env, argv[3], n, sizeof(double), &in.scales))
+    return make_result_error(env, "canvas_fill_instances_invalid_scales");
+  if(!get_per_instance(env, argv[4], n, sizeof(double), &in.rotations))
+    return make_result_error(env, "canvas_fill_instances_invalid_rotations");
+  if(!get_per_instance(env, argv[5], n, 4, &in.colors))
+    return make_result_error(env, "canvas_fill_instances_invalid_colors");
+
+  // The path is copied (a reference bump) so other processes may keep
+  // editing theirs meanwhile.
+  BLPath path;
+  if(in.shape == INSTANCE_PATH) {
+    path = *in.path;
+    in.path = &path;
+    // An empty path covers nothing, wherever it is placed.
+    if(path.is_empty())
+      return enif_make_atom(env, "ok");
+    if(path.get_bounding_box(&in.path_box) != BL_SUCCESS)
+      return make_result_error(env, "canvas_fill_instances_invalid_shape");
+  }
+
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
+  BLContext& ctx = canvas->ctx;
+  Style style;
+  parse_style(env, argv, argc, 6, &style);
+  ctx.save();
+  style.apply(&ctx);
+
+  // Merging is only allowed where the union of the instances looks the same
+  // as the instances painted over each other; see the comment at the top.
+  const bool opaque_fill = in.colors || (style.color && !style.gradient && !style.pattern &&
+                                         style.color->value.a() == 0xFFu);
+  const bool can_merge = opaque_fill && ctx.comp_op() == BL_COMP_OP_SRC_OVER &&
+                         ctx.global_alpha() == 1.0 && ctx.fill_rule() == BL_FILL_RULE_NON_ZERO;
+
+  BLBox bounds(INFINITY, INFINITY, -INFINITY, -INFINITY);
+  BLResult r = fill_instances(ctx, in, can_merge, &bounds);
+  if(bounds.x0 <= bounds.x1)
+    canvas->dirty.add(ctx, bounds);
+  ctx.restore();
+
+  if(r != BL_SUCCESS)
+    return make_result_error(env, "canvas_fill_instances_failed");
+
+  return enif_make_atom(env, "ok");
+}
@@ -0,0 +1,161 @@
+#include "canvas.h"
+#include "../nif/nif_resource.h"
+#include "../nif/nif_util.h"
+#include "../styles/styles.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+  // Far beyond any sensible nesting; catches begin_layer calls that are
+  // never ended.
+  constexpr size_t kMaxLayers = 32;
+} // namespace
+
+// canvas_begin_layer(Canvas, X, Y, W, H, Format) -> :ok | {:error, reason}
+//
+//   X, Y, W, H :: integers, the canvas pixels the layer covers
+//   Format     :: :prgb32 | :a8 (coverage only, composited as a mask)
+//
+// Redirects all drawing on the canvas into a transparent offscreen surface
+// from the pool until canvas_end_layer. The layer inherits the transform and
+// fill rule, so shapes land where they would on the canvas; anything outside
+// the bounds is clipped.
+ERL_NIF_TERM canvas_begin_layer(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 6)
+    return enif_make_badarg(env);
+
+  auto canvas = NifResource<Canvas>::get(env, argv[0]);
+  if(canvas == nullptr)
+    return make_result_error(env, "canvas_begin_layer_invalid_canvas");
+
+  int x, y, w, h;
+  if(!enif_get_int(env, argv[1], &x) || !enif_get_int(env, argv[2], &y) ||
+     !enif_get_int(env, argv[3], &w) || !enif_get_int(env, argv[4], &h) || w <= 0 || h <= 0)
+    return make_result_error(env, "canvas_begin_layer_invalid_bounds");
+
+  char format[8];
+  if(!enif_get_atom(env, argv[5], format, sizeof(format), ERL_NIF_UTF8) ||
+     (strcmp(format, "prgb32") != 0 && strcmp(format, "a8") != 0))
+    return make_result_error(env, "canvas_begin_layer_invalid_format");
+
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
+  if(canvas->layers.size() >= kMaxLayers)
+    return make_result_error(env, "canvas_begin_layer_too_deep");
+
+  // Only the part on the canvas needs a surface. A layer entirely off the
+  // canvas still takes drawing, it just clips all of it.
+  BLSizeI sz = canvas->img.size();
+  const int x0 = std::clamp(x, 0, sz.w);
+  const int y0 = std::clamp(y, 0, sz.h);
+  const int x1 = int(std::clamp<int64_t>(int64_t(x) + w, x0, sz.w));
+  const int y1 = int(std::clamp<int64_t>(int64_t(y) + h, y0, sz.h));
+
+  CanvasLayer layer;
+  layer.bounds = BLRectI(x0, y0, x1 - x0, y1 - y0);
+  layer.surface = PooledSurface(strcmp(format, "a8") == 0 ? BL_FORMAT_A8 : BL_FORMAT_PRGB32,
+                                std::max(layer.bounds.w, 1), std::max(layer.bounds.h, 1));
+  if(!layer.surface.valid())
+    return make_result_error(env, "canvas_begin_layer_alloc_failed");
+
+  BLContext ctx;
+  if(ctx.begin(layer.surface.image()) != BL_SUCCESS)
+    return make_result_error(env, "canvas_begin_layer_failed");
+
+  // Pooled surfaces are larger than asked for and hold old contents.
+  ctx.clip_to_rect(BLRectI(0, 0, layer.bounds.w, layer.bounds.h));
+  ctx.clear_all();
+
+  // The current context maps user space onto its own surface (the canvas
+  // or the enclosing layer); shift that onto this layer's surface.
+  int parent_x = 0, parent_y = 0;
+  if(!canvas->layers.empty()) {
+    parent_x = canvas->layers.back().bounds.x;
+    parent_y = canvas->layers.back().bounds.y;
+  }
+  ctx.translate(double(parent_x - layer.bounds.x), double(parent_y - layer.bounds.y));
+  ctx.apply_transform(canvas->ctx.meta_transform());
+  ctx.user_to_meta();
+  ctx.set_transform(canvas->ctx.user_transform());
+  ctx.set_fill_rule(canvas->ctx.fill_rule());
+
+  // Exports only flush the innermost context, so whatever is still queued
+  // below the layer is rendered now.
+  canvas->ctx.flush(BL_CONTEXT_FLUSH_SYNC);
+
+  layer.parent = std::move(canvas->ctx);
+  canvas->ctx = std::move(ctx);
+  canvas->layers.push_back(std::move(layer));
+  canvas->dirty.set_paused(true);
+
+  return enif_make_atom(env, "ok");
+}
+
+// canvas_end_layer(Canvas [, Opts]) -> :ok | {:error, reason}
+//
+//   Opts :: style options for compositing: alpha (group opacity), comp_op
+//           and, for :a8 layers, the fill the mask is painted with
+//
+// Closes the innermost layer and composites it onto what was drawn below,
+// then returns its surface to the pool.
+ERL_NIF_TERM canvas_end_layer(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc < 1 || argc > 2)
+    return enif_make_badarg(env);
+
+  auto canvas = NifResource<Canvas>::get(env, argv[0]);
+  if(canvas == nullptr)
+    return make_result_error(env, "canvas_end_layer_invalid_canvas");
+
+  Style style{};
+  if(!parse_style(env, argv, argc, 1, &style))
+    return make_result_error(env, "canvas_end_layer_invalid_opts");
+
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
+  if(canvas->layers.empty())
+    return make_result_error(env, "canvas_end_layer_no_layer");
+
+  CanvasLayer layer = std::move(canvas->layers.back());
+  canvas->layers.pop_back();
+  canvas->dirty.set_paused(!canvas->layers.empty());
+  canvas->ctx.end();
+  canvas->ctx = std::move(layer.parent);
+
+  const BLRectI& b = layer.bounds;
+  if(b.w == 0 || b.h == 0)
+    return enif_make_atom(env, "ok");
+
+  BLContext& ctx = canvas->ctx;
+  const BLImage& surface = layer.surface.image();
+  const BLRectI area(0, 0, b.w, b.h);
+
+  // With the user transform reset, coordinates are canvas pixels again,
+  // mapped onto the enclosing layer by its meta transform.
+  ctx.save();
+  ctx.reset_transform();
+  style.apply(&ctx);
+
+  const BLPointI origin(b.x, b.y);
+  BLResult r = surface.format() == BL_FORMAT_A8 ? ctx.fill_mask(origin, surface, area)
+                                                : ctx.blit_image(origin, surface, area);
+  // Drawing inside layers is tracked once it reaches the canvas; dirty is
+  // still paused while this lands on an enclosing layer.
+  canvas->dirty.add(ctx, BLBox(b.x, b.y, b.x + b.w, b.y + b.h));
+  ctx.restore();
+
+  // The surface goes back to the pool on return; a multi-threaded context
+  // must not still be reading it then.
+  ctx.flush(BL_CONTEXT_FLUSH_SYNC);
+
+  if(r != BL_SUCCESS)
+    return make_result_error(env, "canvas_end_layer_failed");
+
+  return enif_make_atom(env, "ok");
+}
@@ -0,0 +1,183 @@
+#include "canvas.h"
+#include "exec.h"
+#include "../images/file_sink.h"
+#include "../images/png_encoder.h"
+#include "../nif/nif_util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace {
+
+// Without an explicit tile height, bands are sized to roughly this many bytes.
+constexpr size_t kDefaultBandBytes = 16 * 1024 * 1024;
+
+enum TiledFormat { TILED_PNG, TILED_RAW };
+
+ERL_NIF_TERM make_op_error(ErlNifEnv* env, const char* reason, size_t offset)
+{
+  return enif_make_tuple2(
+      env,
+      enif_make_atom(env, "error"),
+      enif_make_tuple2(env, enif_make_atom(env, reason), enif_make_ulong(env, offset)));
+}
+
+// Parses {format, tile_height, threads}. A tile height of 0 picks one from
+// kDefaultBandBytes.
+bool parse_tiled_options(ErlNifEnv* env,
+                         const ERL_NIF_TERM argv[],
+                         int width,
+                         TiledFormat* format,
+                         int* band_height,
+                         BLContextCreateInfo* ci)
+{
+  char name[8];
+  if(!enif_get_atom(env, argv[0], name, sizeof(name), ERL_NIF_UTF8))
+    return false;
+  if(strcmp(name, "png") == 0)
+    *format = TILED_PNG;
+  else if(strcmp(name, "raw") == 0)
+    *format = TILED_RAW;
+  else
+    return false;
+
+  unsigned rows, threads;
+  if(!enif_get_uint(env, argv[1], &rows) || !enif_get_uint(env, argv[2], &threads))
+    return false;
+
+  if(rows == 0)
+    rows = unsigned(std::max<size_t>(1, kDefaultBandBytes / (size_t(width) * 4)));
+  *band_height = int(std::min<unsigned>(rows, 1u << 16));
+
+  ci->thread_count = threads;
+  if(threads > 0)
+    ci->flags |= BL_CONTEXT_CREATE_FLAG_FALLBACK_TO_SYNC;
+  return true;
+}
+
+} // namespace
+
+// tiled_render(path, width, height, ops, refs, format, tile_height, threads, png_opts)
+//
+//   path        :: binary, file to create (truncated if it exists)
+//   ops, refs   :: a command buffer, as for canvas_exec (see exec.h)
+//   format      :: :png | :raw (PRGB32 rows, width * 4 bytes each, no header)
+//   tile_height :: rows rendered per band, 0 for automatic
+//   threads     :: worker threads of the band's rendering context
+//   png_opts    :: keyword list of Canvas.to_png/2
+//
+// Renders a width x height scene without ever holding it in memory. The
+// image is cut into full-width bands; for each band the ops are replayed
+// into one reused band image, shifted up by the band's offset, and the
+// finished rows are streamed to the file before the next band starts. The
+// ops are indexed once up front, so each band skips the draw ops whose
+// bounds miss it instead of decoding and clipping every one. Peak memory is
+// one band plus the encoder.
+//
+// Returns :ok, {:error, reason} or, like canvas_exec, {:error, {reason,
+// byte_offset}} for an op that could not be decoded or drawn. On failure the
+// partially written file is removed.
+ERL_NIF_TERM tiled_render(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 9)
+    return enif_make_badarg(env);
+
+  ErlNifBinary path_bin;
+  if(!enif_inspect_binary(env, argv[0], &path_bin) || path_bin.size == 0 ||
+     memchr(path_bin.data, 0, path_bin.size) != nullptr)
+    return make_result_error(env, "tiled_render_invalid_path");
+  std::string path(reinterpret_cast<const char*>(path_bin.data), path_bin.size);
+
+  int width, height;
+  if(!enif_get_int(env, argv[1], &width) || !enif_get_int(env, argv[2], &height) || width <= 0 ||
+     height <= 0)
+    return make_result_error(env, "tiled_render_invalid_size");
+
+  ErlNifBinary ops;
+  if(!enif_inspect_iolist_as_binary(env, argv[3], &ops))
+    return make_result_error(env, "tiled_render_invalid_ops");
+
+  std::vector<ExecRef> refs;
+  if(!exec_resolve_refs(env, argv[4], &refs))
+    return make_result_error(env, "tiled_render_invalid_refs");
+
+  TiledFormat format;
+  int band_height;
+  BLContextCreateInfo ci{};
+  PngOptions png_opts;
+  if(!parse_tiled_options(env, argv + 5, width, &format, &band_height, &ci) ||
+     !parse_png_options(env, argv[8], &png_opts))
+    return make_result_error(env, "tiled_render_invalid_options");
+
+  band_height = std::min(band_height, height);
+
+  std::vector<ExecItem> items;
+  size_t offset = 0;
+  BLResult r = exec_index(ops.data, ops.size, refs, &items, &offset);
+  if(r == EXEC_ERROR_INVALID_OP)
+    return make_op_error(env, "tiled_render_invalid_op", offset);
+  if(r == EXEC_ERROR_INVALID_FONT)
+    return make_op_error(env, "tiled_render_invalid_font", offset);
+  if(r != BL_SUCCESS)
+    return make_result_error(env, "tiled_render_failed");
+
+  BLImage band;
+  if(band.create(width, band_height, BL_FORMAT_PRGB32) != BL_SUCCESS)
+    return make_result_error(env, "tiled_render_alloc_failed");
+
+  // Dropped without close() on every error path, which removes the file.
+  FileSink file;
+  if(!file.open(path))
+    return make_result_error(env, "tiled_render_open_failed");
+
+  PngWriter png(width, height, png_opts, [&file](const uint8_t* data, size_t size) {
+    return file.write(data, size);
+  });
+  if(format == TILED_PNG && png.begin() != BL_SUCCESS)
+    return make_result_error(env, "tiled_render_write_failed");
+
+  BLContext ctx;
+  for(int y0 = 0; y0 < height; y0 += band_height) {
+    const int rows = std::min(band_height, height - y0);
+
+    if(ctx.begin(band, ci) != BL_SUCCESS)
+      return make_result_error(env, "tiled_render_failed");
+    ctx.clear_all();
+    // Folding the offset into the meta transform keeps it in place when the
+    // ops reset or replace the user transform.
+    ctx.translate(0.0, -double(y0));
+    ctx.user_to_meta();
+
+    ExecCull cull{&items, ctx.final_transform(), BLBox(0.0, 0.0, double(width), double(rows))};
+    r = exec_ops(ctx, ops.data, ops.size, refs, &offset, nullptr, &cull);
+    ctx.end();
+    if(r != BL_SUCCESS) {
+      const char* reason = r == EXEC_ERROR_INVALID_OP     ? "tiled_render_invalid_op"
+                           : r == EXEC_ERROR_INVALID_FONT ? "tiled_render_invalid_font"
+                                                          : "tiled_render_failed";
+      return make_op_error(env, reason, offset);
+    }
+
+    BLImageData data{};
+    band.get_data(&data);
+    const uint8_t* pixels = static_cast<const uint8_t*>(data.pixel_data);
+
+    bool written = true;
+    if(format == TILED_PNG) {
+      written = png.write_rows(pixels, data.stride, rows, BL_FORMAT_PRGB32) == BL_SUCCESS;
+    }
+    else {
+      const size_t row_bytes = size_t(width) * 4;
+      for(int y = 0; y < rows && written; y++)
+        written = file.write(pixels + intptr_t(y) * data.stride, row_bytes);
+    }
+    if(!written)
+      return make_result_error(env, "tiled_render_write_failed");
+  }
+
+  if((format == TILED_PNG && png.finish() != BL_SUCCESS) || !file.close(false))
+    return make_result_error(env, "tiled_render_write_failed");
+
+  return enif_make_atom(env, "ok");
+}
@@ -1,5 +1,6 @@
 #include "path.h"
 #include "../canvas/canvas.h"
+#include "../nif/nif_array.h"
 #include "../nif/nif_resource.h"
 #include "../nif/nif_util.h"
 #include "../styles/styles.h"
@@ -400,34 +401,6 @@ static bool parse_geometry_extras(
   return true;
 }
 
-static std::vector<BLPoint> parse_point_list(ErlNifEnv* env, ERL_NIF_TERM list) {
-  std::vector<BLPoint> out;
-  unsigned int len;
-  if(!enif_get_list_length(env, list, &len)) {
-    return out;
-  }
-
-  out.reserve(len);
-
-  ERL_NIF_TERM head, tail = list;
-  for(unsigned int i = 0; i < len; i++) {
-    if(!enif_get_list_cell(env, tail, &head, &tail)) {
-      break;
-    }
-
-    const ERL_NIF_TERM* tuple;
-    int arity;
-    double x, y;
-    if(!enif_get_tuple(env, head, &arity, &tuple) || arity != 2 ||
-       !enif_get_double(env, tuple[0], &x) || !enif_get_double(env, tuple[1], &y)) {
-      break;
-    }
-
-    out.emplace_back(x, y);
-  }
-
-  return out;
-}
 // -----------------------------------------------------------------------------
 // 4) path_vertex_count(path) → integer
 // -----------------------------------------------------------------------------
@@ -499,6 +472,15 @@ ERL_NIF_TERM path_shrink(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
   return enif_make_atom(env, "ok");
 }
 
+// Records the path's bounds, as drawn with the current context state, in
+// the canvas' dirty region.
+static void mark_path_dirty(Canvas* canvas, const BLPath& path)
+{
+  BLBox bounds;
+  if(path.get_bounding_box(&bounds) == BL_SUCCESS)
+    canvas->dirty.add(canvas->ctx, bounds);
+}
+
 ERL_NIF_TERM canvas_fill_path(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
 
   if(argc < 2) {
@@ -510,18 +492,23 @@ ERL_NIF_TERM canvas_fill_path(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[
     return make_result_error(env, "fill_path_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   auto path = NifResource<Path>::get(env, argv[1]);
   if(path == nullptr) {
     return make_result_error(env, "fill_path_invalid_path");
   }
 
   // optional style in argv[2], like the rest of your code
-  if(argc == 3 && enif_is_list(env, argv[2])) {
+  if(argc == 3 && is_style_arg(env, argv[2])) {
     Style style;
     parse_style(env, argv, argc, 2, &style);
     canvas->ctx.save();
     style.apply(&canvas->ctx);
     BLResult r = canvas->ctx.fill_path(path->value);
+    mark_path_dirty(canvas, path->value);
     canvas->ctx.restore();
 
     if(r != BL_SUCCESS)
@@ -531,6 +518,7 @@ ERL_NIF_TERM canvas_fill_path(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[
   }
   else {
     BLResult r = canvas->ctx.fill_path(path->value);
+    mark_path_dirty(canvas, path->value);
     if(r != BL_SUCCESS)
       return make_result_error(env, "fill_path_failed");
     return enif_make_atom(env, "ok");
@@ -548,13 +536,17 @@ ERL_NIF_TERM canvas_stroke_path(ErlNifEnv* env, int argc, const ERL_NIF_TERM arg
     return make_result_error(env, "stroke_path_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   auto path = NifResource<Path>::get(env, argv[1]);
   if(path == nullptr) {
     return make_result_error(env, "stroke_path_invalid_path");
   }
 
   // with style
-  if(argc == 3 && enif_is_list(env, argv[2])) {
+  if(argc == 3 && is_style_arg(env, argv[2])) {
     Style style;
     // your existing helper
     parse_style(env, argv, argc, 2, &style);
@@ -563,6 +555,7 @@ ERL_NIF_TERM canvas_stroke_path(ErlNifEnv* env, int argc, const ERL_NIF_TERM arg
     style.apply(&canvas->ctx);
 
     BLResult r = canvas->ctx.stroke_path(path->value);
+    mark_path_dirty(canvas, path->value);
 
     canvas->ctx.restore();
 
@@ -574,6 +567,7 @@ ERL_NIF_TERM canvas_stroke_path(ErlNifEnv* env, int argc, const ERL_NIF_TERM arg
   else {
     // no style → just stroke with whatever is currently set on the context
     BLResult r = canvas->ctx.stroke_path(path->value);
+    mark_path_dirty(canvas, path->value);
     if(r != BL_SUCCESS)
       return make_result_error(env, "stroke_path_failed");
     return enif_make_atom(env, "ok");
@@ -1066,18 +1060,19 @@ ERL_NIF_TERM path_add_polyline(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv
     return make_result_error(env, "path_add_polyline_invalid_path");
   }
 
-  auto points = parse_point_list(env, argv[1]);
+  ArrayArg<BLPoint> points;
+  if(!get_array_arg(env, argv[1], &points)) {
+    return make_result_error(env, "path_add_polyline_invalid_points");
+  }
 
   GeometryExtras extras;
   if(!parse_geometry_extras(env, argc, argv, 2, &extras)) {
     return make_result_error(env, "path_add_polyline_invalid_extras");
   }
 
-  BLArrayView<BLPoint> view;
-  view.reset(points.data(), points.size());
-
-  BLResult rc = extras.matrix ? path->value.add_polyline(view, extras.matrix->value, extras.dir)
-                              : path->value.add_polyline(view, extras.dir);
+  BLResult rc = extras.matrix
+                    ? path->value.add_polyline(points.view, extras.matrix->value, extras.dir)
+                    : path->value.add_polyline(points.view, extras.dir);
 
   if(rc != BL_SUCCESS)
     return make_result_error(env, "path_add_polyline_failed");
@@ -1095,18 +1090,19 @@ ERL_NIF_TERM path_add_polygon(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[
     return make_result_error(env, "path_add_polygon_invalid_path");
   }
 
-  auto points = parse_point_list(env, argv[1]);
+  ArrayArg<BLPoint> points;
+  if(!get_array_arg(env, argv[1], &points)) {
+    return make_result_error(env, "path_add_polygon_invalid_points");
+  }
 
   GeometryExtras extras;
   if(!parse_geometry_extras(env, argc, argv, 2, &extras)) {
     return make_result_error(env, "path_add_polygon_invalid_extras");
   }
 
-  BLArrayView<BLPoint> view;
-  view.reset(points.data(), points.size());
-
-  BLResult rc = extras.matrix ? path->value.add_polygon(view, extras.matrix->value, extras.dir)
-                              : path->value.add_polygon(view, extras.dir);
+  BLResult rc = extras.matrix
+                    ? path->value.add_polygon(points.view, extras.matrix->value, extras.dir)
+                    : path->value.add_polygon(points.view, extras.dir);
 
   if(rc != BL_SUCCESS)
     return make_result_error(env, "path_add_polygon_failed");
@@ -1631,179 +1627,3 @@ ERL_NIF_TERM path_add_stroked_path(ErlNifEnv* env, int argc, const ERL_NIF_TERM
 
   return enif_make_atom(env, "ok");
 }
-
-// Path flatten
-static BL_INLINE BLPoint mix(const BLPoint& a, const BLPoint& b, double t) noexcept {
-  return BLPoint(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t);
-}
-
-static double quadFlatness(const BLPoint& p0, const BLPoint& p1, const BLPoint& p2) noexcept {
-  // distance of control point from line p0-p2
-  double ux = p2.x - p0.x;
-  double uy = p2.y - p0.y;
-  double vx = p1.x - p0.x;
-  double vy = p1.y - p0.y;
-
-  double area2 = std::abs(ux * vy - uy * vx);
-  double len = std::sqrt(ux * ux + uy * uy);
-  return len > 0.0 ? area2 / len : 0.0;
-}
-
-static double
-cubicFlatness(const BLPoint& p0, const BLPoint& p1, const BLPoint& p2, const BLPoint& p3) noexcept {
-  double ux = p3.x - p0.x;
-  double uy = p3.y - p0.y;
-  double len = std::sqrt(ux * ux + uy * uy);
-  if(len == 0.0)
-    return 0.0;
-
-  auto dist = [&](const BLPoint& p) {
-    double vx = p.x - p0.x;
-    double vy = p.y - p0.y;
-    double area2 = std::abs(ux * vy - uy * vx);
-    return area2 / len;
-  };
-
-  return std::max(dist(p1), dist(p2));
-}
-
-static void flattenQuadRecursive(
-    BLPath& dst, const BLPoint& p0, const BLPoint& p1, const BLPoint& p2, double tol) {
-  if(quadFlatness(p0, p1, p2) <= tol) {
-    dst.line_to(p2);
-    return;
-  }
-
-  BLPoint p01 = mix(p0, p1, 0.5);
-  BLPoint p12 = mix(p1, p2, 0.5);
-  BLPoint p012 = mix(p01, p12, 0.5);
-
-  flattenQuadRecursive(dst, p0, p01, p012, tol);
-  flattenQuadRecursive(dst, p012, p12, p2, tol);
-}
-
-static void flattenCubicRecursive(BLPath& dst,
-                                  const BLPoint& p0,
-                                  const BLPoint& p1,
-                                  const BLPoint& p2,
-                                  const BLPoint& p3,
-                                  double tol) {
-  if(cubicFlatness(p0, p1, p2, p3) <= tol) {
-    dst.line_to(p3);
-    return;
-  }
-
-  BLPoint p01 = mix(p0, p1, 0.5);
-  BLPoint p12 = mix(p1, p2, 0.5);
-  BLPoint p23 = mix(p2, p3, 0.5);
-
-  BLPoint p012 = mix(p01, p12, 0.5);
-  BLPoint p123 = mix(p12, p23, 0.5);
-  BLPoint p0123 = mix(p012, p123, 0.5);
-
-  flattenCubicRecursive(dst, p0, p01, p012, p0123, tol);
-  flattenCubicRecursive(dst, p0123, p123, p23, p3, tol);
-}
-
-static BLResult flattenPath(const BLPath& src, BLPath& dst, double tol) {
-  dst.clear();
-
-  size_t n = src.size();
-  const uint8_t* cmdData = src.command_data();
-  const BLPoint* vtxData = src.vertex_data();
-
-  BLPoint lastOn(0.0, 0.0);
-  BLPoint subStart(0.0, 0.0);
-  bool hasSub = false;
-
-  for(size_t i = 0; i < n; ++i) {
-    uint8_t cmd = cmdData[i];
-    const BLPoint& v = vtxData[i];
-
-    switch(cmd) {
-    case BL_PATH_CMD_MOVE: {
-      dst.move_to(v);
-      lastOn = v;
-      subStart = v;
-      hasSub = true;
-      break;
-    }
-
-    case BL_PATH_CMD_ON: {
-      dst.line_to(v);
-      lastOn = v;
-      break;
-    }
-
-    case BL_PATH_CMD_QUAD: {
-      if(i + 1 >= n || cmdData[i + 1] != BL_PATH_CMD_ON)
-        return BL_ERROR_INVALID_STATE;
-
-      const BLPoint& p1 = vtxData[i]; // control
-      const BLPoint& p2 = vtxData[i + 1]; // end
-
-      flattenQuadRecursive(dst, lastOn, p1, p2, tol);
-      lastOn = p2;
-      i += 1;
-      break;
-    }
-
-    case BL_PATH_CMD_CUBIC: {
-      if(i + 2 >= n || cmdData[i + 1] != BL_PATH_CMD_CUBIC || cmdData[i + 2] != BL_PATH_CMD_ON)
-        return BL_ERROR_INVALID_STATE;
-
-      const BLPoint& p1 = vtxData[i];
-      const BLPoint& p2 = vtxData[i + 1];
-      const BLPoint& p3 = vtxData[i + 2];
-
-      flattenCubicRecursive(dst, lastOn, p1, p2, p3, tol);
-      lastOn = p3;
-      i += 2;
-      break;
-    }
-
-    case BL_PATH_CMD_CLOSE: {
-      if(hasSub) {
-        dst.close();
-        lastOn = subStart;
-      }
-      break;
-    }
-
-    default: break;
-    }
-  }
-
-  return BL_SUCCESS;
-}
-
-ERL_NIF_TERM path_flatten(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
-  if(argc != 2)
-    return make_result_error(env, "bad_arity");
-
-  auto srcPath = NifResource<Path>::get(env, argv[0]);
-  if(srcPath == nullptr) {
-    return make_result_error(env, "path_flatten_bad_src_path");
-  }
-
-  double tolerance = 0.25; // default
-  {
-    if(!enif_get_double(env, argv[1], &tolerance)) {
-      return make_result_error(env, "path_flatten_invalid_tolerance");
-    }
-  }
-
-  // allocate new Path resource
-  auto dstPath = NifResource<Path>::alloc();
-  if(!dstPath) {
-    return make_result_error(env, "dst_path_alloc_failed");
-  }
-
-  BLResult res = flattenPath(srcPath->value, dstPath->value, tolerance);
-  if(res != BL_SUCCESS) {
-    return make_result_error(env, "flatten_failed");
-  }
-
-  ERL_NIF_TERM term = enif_make_resource(env, dstPath);
-  return make_result_ok(env, term);
-}
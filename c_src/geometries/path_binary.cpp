@@ -0,0 +1,155 @@
+#include "path.h"
+#include "../nif/nif_resource.h"
+#include "../nif/nif_util.h"
+
+#include <cstring>
+
+// Path serialization (Path.to_binary/1, Path.from_binary/1).
+//
+//   offset 0      "BLP1"
+//   offset 4      u32 n, the number of vertices
+//   offset 8      n command bytes (BLPathCmd values)
+//                 zero padding up to a multiple of 8
+//   then          n vertices, f64 x and f64 y each
+//
+// All numbers are little-endian. Commands and vertices are Blend2D's own
+// arrays, so on little-endian hosts both directions are plain copies.
+
+namespace {
+
+constexpr char kMagic[4] = {'B', 'L', 'P', '1'};
+constexpr size_t kHeaderSize = 8;
+
+constexpr bool kLittleEndian = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+size_t vertex_offset(size_t n)
+{
+  return (kHeaderSize + n + 7) & ~size_t(7);
+}
+
+void copy_f64_le(uint8_t* dst, const uint8_t* src, size_t count)
+{
+  if(kLittleEndian) {
+    std::memcpy(dst, src, count * 8);
+    return;
+  }
+  for(size_t i = 0; i < count; i++) {
+    for(size_t b = 0; b < 8; b++)
+      dst[i * 8 + b] = src[i * 8 + 7 - b];
+  }
+}
+
+// Whether `cmd` is a sequence Blend2D could have produced: figures start
+// with a move, and curves are their control points followed by an on-point
+// (a conic's control point carries its weight in an extra vertex).
+bool valid_commands(const uint8_t* cmd, size_t n)
+{
+  size_t i = 0;
+  while(i < n) {
+    switch(cmd[i]) {
+    case BL_PATH_CMD_MOVE:
+      i++;
+      break;
+    case BL_PATH_CMD_ON:
+    case BL_PATH_CMD_CLOSE:
+      if(i == 0)
+        return false;
+      i++;
+      break;
+    case BL_PATH_CMD_QUAD:
+      if(i == 0 || i + 1 >= n || cmd[i + 1] != BL_PATH_CMD_ON)
+        return false;
+      i += 2;
+      break;
+    case BL_PATH_CMD_CONIC:
+      if(i == 0 || i + 2 >= n || cmd[i + 1] != BL_PATH_CMD_WEIGHT || cmd[i + 2] != BL_PATH_CMD_ON)
+        return false;
+      i += 3;
+      break;
+    case BL_PATH_CMD_CUBIC:
+      if(i == 0 || i + 2 >= n || cmd[i + 1] != BL_PATH_CMD_CUBIC || cmd[i + 2] != BL_PATH_CMD_ON)
+        return false;
+      i += 3;
+      break;
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+// path_to_binary(path) -> {:ok, binary} | {:error, reason}
+ERL_NIF_TERM path_to_binary(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 1)
+    return enif_make_badarg(env);
+
+  auto path = NifResource<Path>::get(env, argv[0]);
+  if(path == nullptr)
+    return make_result_error(env, "path_to_binary_invalid_path");
+
+  const BLPath& p = path->value;
+  const size_t n = p.size();
+  if(n > UINT32_MAX)
+    return make_result_error(env, "path_to_binary_too_large");
+
+  const size_t vertices = vertex_offset(n);
+  ERL_NIF_TERM term;
+  uint8_t* out = enif_make_new_binary(env, vertices + n * sizeof(BLPoint), &term);
+  if(out == nullptr)
+    return make_result_error(env, "path_to_binary_alloc_failed");
+
+  std::memcpy(out, kMagic, 4);
+  for(int b = 0; b < 4; b++)
+    out[4 + b] = uint8_t(uint32_t(n) >> (8 * b));
+  if(n) {
+    std::memcpy(out + kHeaderSize, p.command_data(), n);
+    std::memset(out + kHeaderSize + n, 0, vertices - kHeaderSize - n);
+    copy_f64_le(out + vertices, reinterpret_cast<const uint8_t*>(p.vertex_data()), n * 2);
+  }
+
+  return make_result_ok(env, term);
+}
+
+// path_from_binary(binary) -> {:ok, path} | {:error, reason}
+ERL_NIF_TERM path_from_binary(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 1)
+    return enif_make_badarg(env);
+
+  ErlNifBinary bin;
+  if(!enif_inspect_binary(env, argv[0], &bin) || bin.size < kHeaderSize ||
+     std::memcmp(bin.data, kMagic, 4) != 0)
+    return make_result_error(env, "path_from_binary_invalid_binary");
+
+  size_t n = 0;
+  for(int b = 0; b < 4; b++)
+    n |= size_t(bin.data[4 + b]) << (8 * b);
+
+  const size_t vertices = vertex_offset(n);
+  if(bin.size != vertices + n * sizeof(BLPoint))
+    return make_result_error(env, "path_from_binary_invalid_binary");
+
+  const uint8_t* cmd = bin.data + kHeaderSize;
+  if(!valid_commands(cmd, n))
+    return make_result_error(env, "path_from_binary_invalid_commands");
+
+  auto path = NifResource<Path>::alloc();
+  if(path == nullptr)
+    return make_result_error(env, "path_from_binary_alloc_failed");
+
+  if(n) {
+    uint8_t* cmd_out;
+    BLPoint* vtx_out;
+    if(path->value.modify_op(BL_MODIFY_OP_ASSIGN_FIT, n, &cmd_out, &vtx_out) != BL_SUCCESS) {
+      enif_release_resource(path);
+      return make_result_error(env, "path_from_binary_alloc_failed");
+    }
+    std::memcpy(cmd_out, cmd, n);
+    copy_f64_le(reinterpret_cast<uint8_t*>(vtx_out), bin.data + vertices, n * 2);
+  }
+
+  return make_result_ok(env, NifResource<Path>::make(env, path));
+}
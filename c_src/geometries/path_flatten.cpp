@@ -0,0 +1,340 @@
+#include "path.h"
+#include "../nif/nif_resource.h"
+#include "../nif/parallel.h"
+#include "../nif/nif_util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Curve flattening (Path.flatten/3).
+//
+// Flattening runs in two passes. The first walks the source commands once
+// and decides, per segment, how many vertices it turns into: one for moves,
+// lines and closes, and for curves the subdivision count given by Wang's
+// formula. Prefix sums of those counts give every segment its place in the
+// output, so the destination is sized exactly once and the second pass
+// writes vertices straight into it, splitting the segments across threads
+// when the output is large. Curves are evaluated at evenly spaced parameters
+// by forward differencing, which needs only additions per vertex.
+
+namespace {
+
+// A curve is never split into more lines than this, whatever the tolerance.
+constexpr uint32_t kMaxCurveSegments = 1 << 16;
+
+// Output vertices written per thread at the least.
+constexpr size_t kMinChunk = 1 << 15;
+
+struct FlattenSeg {
+  uint32_t src;  // index of the segment's first command
+  uint32_t from; // index of the vertex the segment starts at
+  size_t out;    // index of its first output vertex
+};
+
+// Lines needed so a curve with control polygon second differences of at
+// most `dd` stays within `tol` of its chords (Wang's formula):
+//   n = ceil(sqrt(d * (d - 1) / 8 * dd / tol)) for degree d.
+uint32_t wang_count(double factor, double dd, double tol)
+{
+  double n = std::ceil(std::sqrt(factor * dd / tol));
+  if(!(n >= 1.0))
+    return 1;
+  return n < kMaxCurveSegments ? uint32_t(n) : kMaxCurveSegments;
+}
+
+double second_diff(const BLPoint& a, const BLPoint& b, const BLPoint& c)
+{
+  return std::hypot(a.x - 2.0 * b.x + c.x, a.y - 2.0 * b.y + c.y);
+}
+
+uint32_t quad_count(const BLPoint& p0, const BLPoint& p1, const BLPoint& p2, double tol)
+{
+  return wang_count(0.25, second_diff(p0, p1, p2), tol);
+}
+
+// Conics are bounded by the quad on the same control points, scaled by the
+// weight: a weight above one pulls the curve towards the control point and
+// tightens it, a weight below one flattens it.
+uint32_t conic_count(const BLPoint& p0, const BLPoint& p1, const BLPoint& p2, double w, double tol)
+{
+  return wang_count(0.25 * std::max(w, 1.0), second_diff(p0, p1, p2), tol);
+}
+
+uint32_t cubic_count(
+    const BLPoint& p0, const BLPoint& p1, const BLPoint& p2, const BLPoint& p3, double tol)
+{
+  return wang_count(0.75, std::max(second_diff(p0, p1, p2), second_diff(p1, p2, p3)), tol);
+}
+
+// Writes `n` vertices of the quad p0..p2 at t = 1/n, 2/n, ..., 1.
+void emit_quad(const BLPoint& p0, const BLPoint& p1, const BLPoint& p2, uint32_t n, BLPoint* out)
+{
+  const double h = 1.0 / n;
+  const double ax = p0.x - 2.0 * p1.x + p2.x, ay = p0.y - 2.0 * p1.y + p2.y;
+  const double bx = 2.0 * (p1.x - p0.x), by = 2.0 * (p1.y - p0.y);
+
+  double x = p0.x, y = p0.y;
+  double dx = (ax * h + bx) * h, dy = (ay * h + by) * h;
+  const double ddx = 2.0 * ax * h * h, ddy = 2.0 * ay * h * h;
+
+  for(uint32_t i = 0; i + 1 < n; i++) {
+    x += dx;
+    y += dy;
+    dx += ddx;
+    dy += ddy;
+    out[i].reset(x, y);
+  }
+  out[n - 1] = p2;
+}
+
+// As emit_quad, for the rational quad p0..p2 with weight `w` on p1: the
+// weighted numerator and the denominator are both quadratics, stepped side
+// by side and divided per vertex.
+void emit_conic(
+    const BLPoint& p0, const BLPoint& p1, const BLPoint& p2, double w, uint32_t n, BLPoint* out)
+{
+  const double h = 1.0 / n;
+  const double ax = p0.x - 2.0 * w * p1.x + p2.x, ay = p0.y - 2.0 * w * p1.y + p2.y;
+  const double aw = 2.0 - 2.0 * w;
+  const double bx = 2.0 * (w * p1.x - p0.x), by = 2.0 * (w * p1.y - p0.y);
+  const double bw = 2.0 * (w - 1.0);
+
+  double x = p0.x, y = p0.y, d = 1.0;
+  double dx = (ax * h + bx) * h, dy = (ay * h + by) * h, dd = (aw * h + bw) * h;
+  const double ddx = 2.0 * ax * h * h, ddy = 2.0 * ay * h * h, ddd = 2.0 * aw * h * h;
+
+  for(uint32_t i = 0; i + 1 < n; i++) {
+    x += dx;
+    y += dy;
+    d += dd;
+    dx += ddx;
+    dy += ddy;
+    dd += ddd;
+    out[i].reset(x / d, y / d);
+  }
+  out[n - 1] = p2;
+}
+
+// Writes `n` vertices of the cubic p0..p3 at t = 1/n, 2/n, ..., 1.
+void emit_cubic(const BLPoint& p0,
+                const BLPoint& p1,
+                const BLPoint& p2,
+                const BLPoint& p3,
+                uint32_t n,
+                BLPoint* out)
+{
+  const double h = 1.0 / n;
+  const double h2 = h * h, h3 = h2 * h;
+  const double ax = p3.x - p0.x + 3.0 * (p1.x - p2.x), ay = p3.y - p0.y + 3.0 * (p1.y - p2.y);
+  const double bx = 3.0 * (p0.x - 2.0 * p1.x + p2.x), by = 3.0 * (p0.y - 2.0 * p1.y + p2.y);
+  const double cx = 3.0 * (p1.x - p0.x), cy = 3.0 * (p1.y - p0.y);
+
+  double x = p0.x, y = p0.y;
+  double dx = ax * h3 + bx * h2 + cx * h, dy = ay * h3 + by * h2 + cy * h;
+  double ddx = 6.0 * ax * h3 + 2.0 * bx * h2, ddy = 6.0 * ay * h3 + 2.0 * by * h2;
+  const double dddx = 6.0 * ax * h3, dddy = 6.0 * ay * h3;
+
+  for(uint32_t i = 0; i + 1 < n; i++) {
+    x += dx;
+    y += dy;
+    dx += ddx;
+    dy += ddy;
+    ddx += dddx;
+    ddy += dddy;
+    out[i].reset(x, y);
+  }
+  out[n - 1] = p3;
+}
+
+// First pass: fills `segs` (plus an end marker whose `out` is the total)
+// or returns false on a command sequence that is not a valid path.
+bool plan_flatten(const BLPath& src, double tol, std::vector<FlattenSeg>& segs)
+{
+  const size_t n = src.size();
+  const uint8_t* cmd = src.command_data();
+  const BLPoint* vtx = src.vertex_data();
+  if(n >= UINT32_MAX)
+    return false;
+
+  segs.clear();
+  segs.reserve(n + 1);
+
+  size_t out = 0;
+  uint32_t last = 0;  // current point
+  uint32_t start = 0; // start of the current figure
+  bool has_point = false;
+
+  size_t i = 0;
+  while(i < n) {
+    const uint32_t at = uint32_t(i);
+    const uint32_t from = last;
+    uint32_t count = 1;
+
+    switch(cmd[i]) {
+    case BL_PATH_CMD_MOVE:
+      start = last = at;
+      has_point = true;
+      i++;
+      break;
+
+    case BL_PATH_CMD_ON:
+      if(!has_point)
+        return false;
+      last = at;
+      i++;
+      break;
+
+    case BL_PATH_CMD_CLOSE:
+      if(!has_point)
+        return false;
+      last = start;
+      i++;
+      break;
+
+    case BL_PATH_CMD_QUAD:
+      if(!has_point || i + 1 >= n || cmd[i + 1] != BL_PATH_CMD_ON)
+        return false;
+      count = quad_count(vtx[last], vtx[i], vtx[i + 1], tol);
+      last = at + 1;
+      i += 2;
+      break;
+
+    case BL_PATH_CMD_CONIC:
+      if(!has_point || i + 2 >= n || cmd[i + 1] != BL_PATH_CMD_WEIGHT ||
+         cmd[i + 2] != BL_PATH_CMD_ON)
+        return false;
+      count = conic_count(vtx[last], vtx[i], vtx[i + 2], vtx[i + 1].x, tol);
+      last = at + 2;
+      i += 3;
+      break;
+
+    case BL_PATH_CMD_CUBIC:
+      if(!has_point || i + 2 >= n || cmd[i + 1] != BL_PATH_CMD_CUBIC ||
+         cmd[i + 2] != BL_PATH_CMD_ON)
+        return false;
+      count = cubic_count(vtx[last], vtx[i], vtx[i + 1], vtx[i + 2], tol);
+      last = at + 2;
+      i += 3;
+      break;
+
+    default:
+      return false;
+    }
+
+    segs.push_back({at, from, out});
+    out += count;
+  }
+
+  segs.push_back({uint32_t(n), 0, out});
+  return true;
+}
+
+struct FlattenJob {
+  const uint8_t* cmd;
+  const BLPoint* vtx;
+  const FlattenSeg* segs;
+  uint8_t* cmd_out;
+  BLPoint* vtx_out;
+};
+
+// Second pass over segs[begin, end).
+void emit_segments(const FlattenJob& job, size_t begin, size_t end)
+{
+  const uint8_t* cmd = job.cmd;
+  const BLPoint* vtx = job.vtx;
+
+  for(size_t s = begin; s < end; s++) {
+    const FlattenSeg& seg = job.segs[s];
+    const uint32_t i = seg.src;
+    const uint32_t n = uint32_t(job.segs[s + 1].out - seg.out);
+    uint8_t* cmd_out = job.cmd_out + seg.out;
+    BLPoint* vtx_out = job.vtx_out + seg.out;
+
+    switch(cmd[i]) {
+    case BL_PATH_CMD_QUAD:
+      emit_quad(vtx[seg.from], vtx[i], vtx[i + 1], n, vtx_out);
+      break;
+    case BL_PATH_CMD_CONIC:
+      emit_conic(vtx[seg.from], vtx[i], vtx[i + 2], vtx[i + 1].x, n, vtx_out);
+      break;
+    case BL_PATH_CMD_CUBIC:
+      emit_cubic(vtx[seg.from], vtx[i], vtx[i + 1], vtx[i + 2], n, vtx_out);
+      break;
+    default:
+      cmd_out[0] = cmd[i];
+      vtx_out[0] = vtx[i];
+      continue;
+    }
+    std::fill_n(cmd_out, n, uint8_t(BL_PATH_CMD_ON));
+  }
+}
+
+} // namespace
+
+// path_flatten(path, tolerance, threads) -> {:ok, new_path} | {:error, reason}
+//
+//   tolerance :: largest distance allowed between a curve and its lines
+//   threads   :: how many threads may share the work, the caller's included
+//
+// Returns a path of moves, lines and closes only.
+ERL_NIF_TERM path_flatten(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 3)
+    return enif_make_badarg(env);
+
+  auto src = NifResource<Path>::get(env, argv[0]);
+  if(src == nullptr)
+    return make_result_error(env, "path_flatten_bad_src_path");
+
+  double tolerance;
+  if(!enif_get_double(env, argv[1], &tolerance) || !(tolerance > 0.0) || !std::isfinite(tolerance))
+    return make_result_error(env, "path_flatten_invalid_tolerance");
+
+  unsigned threads;
+  if(!enif_get_uint(env, argv[2], &threads))
+    return make_result_error(env, "path_flatten_invalid_threads");
+
+  // The path is copied (a reference bump) so other processes may keep
+  // editing theirs meanwhile.
+  const BLPath shape = src->value;
+  std::vector<FlattenSeg> segs;
+  if(!plan_flatten(shape, tolerance, segs))
+    return make_result_error(env, "flatten_failed");
+
+  auto dst = NifResource<Path>::alloc();
+  if(dst == nullptr)
+    return make_result_error(env, "dst_path_alloc_failed");
+
+  const size_t total = segs.back().out;
+  if(total) {
+    uint8_t* cmd_out;
+    BLPoint* vtx_out;
+    if(dst->value.modify_op(BL_MODIFY_OP_ASSIGN_FIT, total, &cmd_out, &vtx_out) != BL_SUCCESS) {
+      enif_release_resource(dst);
+      return make_result_error(env, "dst_path_alloc_failed");
+    }
+
+    FlattenJob job{shape.command_data(), shape.vertex_data(), segs.data(), cmd_out, vtx_out};
+    const size_t n = segs.size() - 1;
+    const size_t count =
+        std::max<size_t>(1, std::min<size_t>(std::max(threads, 1u), total / kMinChunk));
+
+    // Chunks end where the output passes an even share of the total, so
+    // every thread writes about as many vertices.
+    auto bound = [&](size_t k) {
+      if(k == count)
+        return n;
+      const size_t target = total * k / count;
+      return size_t(std::lower_bound(segs.begin(), segs.end() - 1, target,
+                                     [](const FlattenSeg& seg, size_t out) {
+                                       return seg.out < out;
+                                     }) -
+                    segs.begin());
+    };
+
+    parallel_for(count, [&](size_t k) { emit_segments(job, bound(k), bound(k + 1)); });
+  }
+
+  return make_result_ok(env, NifResource<Path>::make(env, dst));
+}
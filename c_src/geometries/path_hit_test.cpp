@@ -0,0 +1,226 @@
+#include "path.h"
+#include "../nif/nif_resource.h"
+#include "../nif/parallel.h"
+#include "../nif/nif_util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Batch point-in-path classification (Path.hit_test_many/3).
+
+namespace {
+
+enum HitCode : uint8_t { HIT_OUT = 0, HIT_IN = 1, HIT_PART = 2 };
+
+// Cells of the classification grid.
+enum CellState : uint8_t { CELL_OUT = 0, CELL_IN = 1, CELL_EDGE = 2 };
+
+// Below this many points every point is hit-tested exactly; building the
+// grid would cost more than it saves.
+constexpr size_t kGridMinPoints = 1 << 16;
+constexpr size_t kGridMaxCells = 1 << 20;
+
+// Points handled per thread at the least.
+constexpr size_t kMinChunk = 1 << 14;
+
+uint8_t hit_code(BLHitTest ht)
+{
+  return ht == BL_HIT_TEST_IN ? HIT_IN : ht == BL_HIT_TEST_PART ? HIT_PART : HIT_OUT;
+}
+
+// `path` with every figure closed, as fills (and hit tests) see it.
+BLPath closed_figures(const BLPath& path)
+{
+  BLPath out;
+  const uint8_t* cmd = path.command_data();
+  const size_t n = path.size();
+
+  size_t start = 0;
+  for(size_t i = 1; i <= n; i++) {
+    if(i < n && cmd[i] != BL_PATH_CMD_MOVE)
+      continue;
+    out.add_path(path, BLRange{start, i});
+    if(cmd[i - 1] != BL_PATH_CMD_CLOSE)
+      out.close();
+    start = i;
+  }
+  return out;
+}
+
+// Rasterizes the path onto a coarse grid over its bounding box once, so most
+// points are classified by a table lookup. A cell is only trusted when the
+// path's outline, stroked two cells wide, leaves it untouched: then the whole
+// cell lies on one side of the boundary and its fill coverage says which.
+// Points in the other cells are hit-tested exactly.
+class HitGrid {
+public:
+  bool build(const BLPath& path, const BLBox& box, BLFillRule rule, size_t points)
+  {
+    const double bw = std::max(box.x1 - box.x0, 1e-9);
+    const double bh = std::max(box.y1 - box.y0, 1e-9);
+    const double cells = double(std::min(points, kGridMaxCells));
+    w_ = std::clamp(int(std::ceil(std::sqrt(cells * bw / bh))), 1, 4096);
+    h_ = std::clamp(int(std::ceil(cells / w_)), 1, 4096);
+    sx_ = w_ / bw;
+    sy_ = h_ / bh;
+    x0_ = box.x0;
+    y0_ = box.y0;
+
+    BLImage fill, edge;
+    if(fill.create(w_, h_, BL_FORMAT_A8) != BL_SUCCESS ||
+       edge.create(w_, h_, BL_FORMAT_A8) != BL_SUCCESS)
+      return false;
+
+    const BLMatrix2D m(sx_, 0.0, 0.0, sy_, -x0_ * sx_, -y0_ * sy_);
+    const BLRgba32 opaque(0xFFFFFFFFu);
+
+    BLContext ctx;
+    if(ctx.begin(fill) != BL_SUCCESS)
+      return false;
+    ctx.clear_all();
+    ctx.set_transform(m);
+    ctx.set_fill_rule(rule);
+    ctx.set_fill_style(opaque);
+    ctx.fill_path(path);
+    ctx.end();
+
+    if(ctx.begin(edge) != BL_SUCCESS)
+      return false;
+    ctx.clear_all();
+    ctx.set_transform(m);
+    ctx.set_stroke_style(opaque);
+    ctx.set_stroke_width(2.0 / std::min(sx_, sy_));
+    ctx.set_stroke_join(BL_STROKE_JOIN_ROUND);
+    ctx.set_stroke_caps(BL_STROKE_CAP_ROUND);
+    ctx.stroke_path(closed_figures(path));
+    ctx.end();
+
+    BLImageData f{}, e{};
+    fill.get_data(&f);
+    edge.get_data(&e);
+    cells_.resize(size_t(w_) * size_t(h_));
+    for(int y = 0; y < h_; y++) {
+      const uint8_t* fr = static_cast<const uint8_t*>(f.pixel_data) + intptr_t(y) * f.stride;
+      const uint8_t* er = static_cast<const uint8_t*>(e.pixel_data) + intptr_t(y) * e.stride;
+      uint8_t* out = cells_.data() + size_t(y) * size_t(w_);
+      for(int x = 0; x < w_; x++)
+        out[x] = er[x] ? CELL_EDGE : fr[x] >= 128 ? CELL_IN : CELL_OUT;
+    }
+    return true;
+  }
+
+  // Only called for points inside the bounding box.
+  CellState at(double x, double y) const
+  {
+    const int cx = std::min(int((x - x0_) * sx_), w_ - 1);
+    const int cy = std::min(int((y - y0_) * sy_), h_ - 1);
+    return CellState(cells_[size_t(cy) * size_t(w_) + size_t(cx)]);
+  }
+
+private:
+  std::vector<uint8_t> cells_;
+  int w_ = 0, h_ = 0;
+  double x0_ = 0, y0_ = 0, sx_ = 1, sy_ = 1;
+};
+
+struct HitJob {
+  const BLPath* path;
+  BLBox box;
+  BLFillRule rule;
+  const HitGrid* grid; // nullptr to hit-test every point
+  const uint8_t* points;
+  uint8_t* out;
+};
+
+void classify(const HitJob& job, size_t begin, size_t end)
+{
+  for(size_t i = begin; i < end; i++) {
+    double p[2];
+    std::memcpy(p, job.points + i * sizeof(p), sizeof(p));
+    const double x = p[0], y = p[1];
+
+    // Also rejects NaNs.
+    if(!(x >= job.box.x0 && x <= job.box.x1 && y >= job.box.y0 && y <= job.box.y1)) {
+      job.out[i] = HIT_OUT;
+      continue;
+    }
+
+    if(job.grid) {
+      CellState cell = job.grid->at(x, y);
+      if(cell != CELL_EDGE) {
+        job.out[i] = cell == CELL_IN ? HIT_IN : HIT_OUT;
+        continue;
+      }
+    }
+
+    job.out[i] = hit_code(job.path->hit_test(BLPoint(x, y), job.rule));
+  }
+}
+
+} // namespace
+
+// path_hit_test_many(path, points, fill_rule, threads) -> {:ok, codes} | {:error, reason}
+//
+//   points  :: binary of native-endian f64 (x, y) pairs
+//   threads :: how many threads may share the work, the caller's included
+//
+// Returns one byte per point: 0 outside, 1 inside, 2 on the boundary (as
+// :out, :in and :part of path_hit_test). Non-finite points are outside.
+ERL_NIF_TERM path_hit_test_many(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 4)
+    return enif_make_badarg(env);
+
+  auto path = NifResource<Path>::get(env, argv[0]);
+  if(path == nullptr)
+    return make_result_error(env, "path_hit_test_many_invalid_path");
+
+  ErlNifBinary points;
+  if(!enif_inspect_iolist_as_binary(env, argv[1], &points) || points.size % 16 != 0)
+    return make_result_error(env, "path_hit_test_many_invalid_points");
+
+  char rule_atom[16];
+  BLFillRule rule;
+  if(!enif_get_atom(env, argv[2], rule_atom, sizeof(rule_atom), ERL_NIF_UTF8))
+    return make_result_error(env, "path_hit_test_many_invalid_fill_rule");
+  if(strcmp(rule_atom, "non_zero") == 0 || strcmp(rule_atom, "nonzero") == 0)
+    rule = BL_FILL_RULE_NON_ZERO;
+  else if(strcmp(rule_atom, "even_odd") == 0 || strcmp(rule_atom, "evenodd") == 0)
+    rule = BL_FILL_RULE_EVEN_ODD;
+  else
+    return make_result_error(env, "path_hit_test_many_invalid_fill_rule");
+
+  unsigned threads;
+  if(!enif_get_uint(env, argv[3], &threads))
+    return make_result_error(env, "path_hit_test_many_invalid_threads");
+
+  const size_t n = points.size / 16;
+  ERL_NIF_TERM codes;
+  uint8_t* out = enif_make_new_binary(env, n, &codes);
+  if(out == nullptr && n > 0)
+    return make_result_error(env, "path_hit_test_many_alloc_failed");
+
+  // The path is copied (a reference bump) so other processes may keep
+  // editing theirs meanwhile.
+  const BLPath shape = path->value;
+  BLBox box;
+  if(n == 0 || shape.get_bounding_box(&box) != BL_SUCCESS || !std::isfinite(box.x0) ||
+     !std::isfinite(box.y0) || !std::isfinite(box.x1) || !std::isfinite(box.y1)) {
+    if(n)
+      std::memset(out, HIT_OUT, n);
+    return make_result_ok(env, codes);
+  }
+
+  HitGrid grid;
+  const bool use_grid = n >= kGridMinPoints && grid.build(shape, box, rule, n);
+  HitJob job{&shape, box, rule, use_grid ? &grid : nullptr, points.data, out};
+
+  const size_t count =
+      std::max<size_t>(1, std::min<size_t>(std::max(threads, 1u), n / kMinChunk));
+
+  parallel_for(count, [&](size_t i) { classify(job, n * i / count, n * (i + 1) / count); });
+
+  return make_result_ok(env, codes);
+}
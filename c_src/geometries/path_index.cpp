@@ -0,0 +1,280 @@
+#include "path_index.h"
+#include "path.h"
+#include "../nif/nif_resource.h"
+#include "../nif/nif_util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Children per node. Wide nodes keep the tree shallow; a leaf's boxes are
+// scanned linearly, which is cheap next to one exact hit test.
+constexpr size_t kNodeSize = 16;
+
+bool intersects(const BLBox& a, const BLBox& b)
+{
+  return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1;
+}
+
+BLBox unite(const BLBox& a, const BLBox& b)
+{
+  return BLBox(
+      std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1));
+}
+
+// Orders `items` so that every run of kNodeSize is one STR tile: sorted into
+// vertical slices by x, then within each slice by y.
+template <typename T, typename BoxOf>
+void str_order(std::vector<T>& items, BoxOf box_of)
+{
+  const size_t pages = (items.size() + kNodeSize - 1) / kNodeSize;
+  const size_t per_slice = size_t(std::ceil(std::sqrt(double(pages)))) * kNodeSize;
+
+  std::sort(items.begin(), items.end(), [&](const T& a, const T& b) {
+    return box_of(a).x0 + box_of(a).x1 < box_of(b).x0 + box_of(b).x1;
+  });
+  for(size_t i = 0; i < items.size(); i += per_slice) {
+    auto last = items.begin() + std::min(items.size(), i + per_slice);
+    std::sort(items.begin() + i, last, [&](const T& a, const T& b) {
+      return box_of(a).y0 + box_of(a).y1 < box_of(b).y0 + box_of(b).y1;
+    });
+  }
+}
+
+bool get_fill_rule(ErlNifEnv* env, ERL_NIF_TERM term, BLFillRule* out)
+{
+  char name[16];
+  if(!enif_get_atom(env, term, name, sizeof(name), ERL_NIF_UTF8))
+    return false;
+  if(strcmp(name, "non_zero") == 0 || strcmp(name, "nonzero") == 0)
+    *out = BL_FILL_RULE_NON_ZERO;
+  else if(strcmp(name, "even_odd") == 0 || strcmp(name, "evenodd") == 0)
+    *out = BL_FILL_RULE_EVEN_ODD;
+  else
+    return false;
+  return true;
+}
+
+// Appends the [{id, path}] list `term` to `out`, numbering the entries from
+// `seq`. Empty paths have no bounds and are left out; they can never be hit.
+bool get_entries(ErlNifEnv* env, ERL_NIF_TERM term, uint32_t seq, std::vector<PathIndexEntry>* out)
+{
+  unsigned len;
+  if(!enif_get_list_length(env, term, &len))
+    return false;
+  out->reserve(out->size() + len);
+
+  ERL_NIF_TERM head, tail = term;
+  while(enif_get_list_cell(env, tail, &head, &tail)) {
+    int arity;
+    const ERL_NIF_TERM* items;
+    ErlNifSInt64 id;
+    Path* path;
+    if(!enif_get_tuple(env, head, &arity, &items) || arity != 2 ||
+       !enif_get_int64(env, items[0], &id) || !(path = NifResource<Path>::get(env, items[1])))
+      return false;
+
+    PathIndexEntry entry;
+    if(path->value.get_bounding_box(&entry.box) != BL_SUCCESS || !std::isfinite(entry.box.x0) ||
+       !std::isfinite(entry.box.y0) || !std::isfinite(entry.box.x1) ||
+       !std::isfinite(entry.box.y1))
+      continue;
+    entry.path = path->value;
+    entry.id = int64_t(id);
+    entry.seq = seq++;
+    out->push_back(std::move(entry));
+  }
+  return true;
+}
+
+// Builds the ids of `hits` in insertion order.
+ERL_NIF_TERM make_id_list(ErlNifEnv* env, std::vector<const PathIndexEntry*>& hits)
+{
+  std::sort(hits.begin(), hits.end(), [](const PathIndexEntry* a, const PathIndexEntry* b) {
+    return a->seq < b->seq;
+  });
+
+  ERL_NIF_TERM list = enif_make_list(env, 0);
+  for(size_t i = hits.size(); i-- > 0;)
+    list = enif_make_list_cell(env, enif_make_int64(env, hits[i]->id), list);
+  return list;
+}
+
+} // namespace
+
+PathIndexTree::PathIndexTree(std::vector<PathIndexEntry> entries) : entries_(std::move(entries))
+{
+  if(entries_.empty())
+    return;
+
+  str_order(entries_, [](const PathIndexEntry& e) -> const BLBox& { return e.box; });
+  for(size_t i = 0; i < entries_.size(); i += kNodeSize) {
+    const size_t count = std::min(kNodeSize, entries_.size() - i);
+    BLBox box = entries_[i].box;
+    for(size_t j = 1; j < count; j++)
+      box = unite(box, entries_[i + j].box);
+    nodes_.push_back(Node{box, uint32_t(i), uint32_t(count), true});
+  }
+
+  // Pack each level into parents until a single root is left. A level is
+  // reordered before its parents are made; its own children stay put.
+  size_t begin = 0;
+  while(nodes_.size() - begin > 1) {
+    const size_t end = nodes_.size();
+    std::vector<Node> level(nodes_.begin() + begin, nodes_.end());
+    str_order(level, [](const Node& n) -> const BLBox& { return n.box; });
+    std::copy(level.begin(), level.end(), nodes_.begin() + begin);
+
+    for(size_t i = begin; i < end; i += kNodeSize) {
+      const size_t count = std::min(kNodeSize, end - i);
+      BLBox box = nodes_[i].box;
+      for(size_t j = 1; j < count; j++)
+        box = unite(box, nodes_[i + j].box);
+      nodes_.push_back(Node{box, uint32_t(i), uint32_t(count), false});
+    }
+    begin = end;
+  }
+}
+
+void PathIndexTree::query(const BLBox& box, std::vector<const PathIndexEntry*>* out) const
+{
+  if(nodes_.empty() || !intersects(nodes_.back().box, box))
+    return;
+
+  std::vector<uint32_t> stack{uint32_t(nodes_.size() - 1)};
+  while(!stack.empty()) {
+    const Node& node = nodes_[stack.back()];
+    stack.pop_back();
+
+    for(uint32_t i = node.first; i < node.first + node.count; i++) {
+      if(node.leaf) {
+        if(intersects(entries_[i].box, box))
+          out->push_back(&entries_[i]);
+      }
+      else if(intersects(nodes_[i].box, box)) {
+        stack.push_back(i);
+      }
+    }
+  }
+}
+
+// path_index_new(entries) -> {:ok, index} | {:error, reason}
+//
+//   entries :: [{id :: integer, path}]
+ERL_NIF_TERM path_index_new(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 1)
+    return enif_make_badarg(env);
+
+  std::vector<PathIndexEntry> entries;
+  if(!get_entries(env, argv[0], 0, &entries))
+    return make_result_error(env, "path_index_new_invalid_entries");
+
+  auto index = NifResource<PathIndex>::alloc();
+  if(index == nullptr)
+    return make_result_error(env, "path_index_new_alloc_failed");
+
+  index->tree = std::make_shared<const PathIndexTree>(std::move(entries));
+  return make_result_ok(env, NifResource<PathIndex>::make(env, index));
+}
+
+// path_index_insert(index, entries) -> :ok | {:error, reason}
+//
+// Adds entries and repacks the whole tree. Queries running meanwhile keep
+// seeing the previous tree.
+ERL_NIF_TERM path_index_insert(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 2)
+    return enif_make_badarg(env);
+
+  auto index = NifResource<PathIndex>::get(env, argv[0]);
+  if(index == nullptr)
+    return make_result_error(env, "path_index_insert_invalid_index");
+
+  std::lock_guard<std::mutex> guard(index->write_mutex);
+  std::shared_ptr<const PathIndexTree> current = index->snapshot();
+
+  std::vector<PathIndexEntry> entries(current->entries());
+  if(!get_entries(env, argv[1], uint32_t(entries.size()), &entries))
+    return make_result_error(env, "path_index_insert_invalid_entries");
+
+  auto tree = std::make_shared<const PathIndexTree>(std::move(entries));
+  std::lock_guard<std::mutex> tree_guard(index->mutex);
+  index->tree = std::move(tree);
+  return enif_make_atom(env, "ok");
+}
+
+// path_index_size(index) -> {:ok, count} | {:error, reason}
+ERL_NIF_TERM path_index_size(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 1)
+    return enif_make_badarg(env);
+
+  auto index = NifResource<PathIndex>::get(env, argv[0]);
+  if(index == nullptr)
+    return make_result_error(env, "path_index_size_invalid_index");
+
+  return make_result_ok(env, enif_make_uint64(env, index->snapshot()->entries().size()));
+}
+
+// path_index_query_point(index, x, y, fill_rule) -> {:ok, [id]} | {:error, reason}
+//
+// Ids of the paths that contain (x, y) under `fill_rule`, boundary
+// included, in insertion order (the last one is drawn on top).
+ERL_NIF_TERM path_index_query_point(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 4)
+    return enif_make_badarg(env);
+
+  auto index = NifResource<PathIndex>::get(env, argv[0]);
+  if(index == nullptr)
+    return make_result_error(env, "path_index_query_point_invalid_index");
+
+  double x, y;
+  if(!enif_get_double(env, argv[1], &x) || !enif_get_double(env, argv[2], &y))
+    return make_result_error(env, "path_index_query_point_invalid_point");
+
+  BLFillRule rule;
+  if(!get_fill_rule(env, argv[3], &rule))
+    return make_result_error(env, "path_index_query_point_invalid_fill_rule");
+
+  std::shared_ptr<const PathIndexTree> tree = index->snapshot();
+  std::vector<const PathIndexEntry*> candidates;
+  tree->query(BLBox(x, y, x, y), &candidates);
+
+  std::vector<const PathIndexEntry*> hits;
+  for(const PathIndexEntry* e : candidates) {
+    BLHitTest ht = e->path.hit_test(BLPoint(x, y), rule);
+    if(ht == BL_HIT_TEST_IN || ht == BL_HIT_TEST_PART)
+      hits.push_back(e);
+  }
+
+  return make_result_ok(env, make_id_list(env, hits));
+}
+
+// path_index_query_rect(index, x, y, w, h) -> {:ok, [id]} | {:error, reason}
+//
+// Ids of the paths whose bounding boxes intersect the rectangle, in
+// insertion order.
+ERL_NIF_TERM path_index_query_rect(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 5)
+    return enif_make_badarg(env);
+
+  auto index = NifResource<PathIndex>::get(env, argv[0]);
+  if(index == nullptr)
+    return make_result_error(env, "path_index_query_rect_invalid_index");
+
+  double x, y, w, h;
+  if(!enif_get_double(env, argv[1], &x) || !enif_get_double(env, argv[2], &y) ||
+     !enif_get_double(env, argv[3], &w) || !enif_get_double(env, argv[4], &h) || w < 0 || h < 0)
+    return make_result_error(env, "path_index_query_rect_invalid_rect");
+
+  std::shared_ptr<const PathIndexTree> tree = index->snapshot();
+  std::vector<const PathIndexEntry*> hits;
+  tree->query(BLBox(x, y, x + w, y + h), &hits);
+
+  return make_result_ok(env, make_id_list(env, hits));
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <blend2d/blend2d.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// Path index
+// ----------------------------------------------------------------------------
+// An R-tree over the bounding boxes of many paths (Blendend.PathIndex), so a
+// point or rectangle query only looks at the few paths whose boxes match.
+// The tree is STR-packed (sort-tile-recursive) in one go whenever paths are
+// added, which gives full nodes and little overlap but makes inserting one
+// path at a time expensive; paths are meant to be added in bulk.
+
+struct PathIndexEntry {
+  BLPath path; // snapshot, later changes to the path resource do not apply
+  BLBox box;
+  int64_t id;
+  uint32_t seq; // insertion order, query results are returned in it
+};
+
+class PathIndexTree {
+public:
+  // Builds the tree over `entries`, which it takes over and reorders.
+  explicit PathIndexTree(std::vector<PathIndexEntry> entries);
+
+  const std::vector<PathIndexEntry>& entries() const noexcept
+  {
+    return entries_;
+  }
+
+  // Appends the entries whose boxes intersect `box` (edges included) to
+  // `out`, in no particular order.
+  void query(const BLBox& box, std::vector<const PathIndexEntry*>* out) const;
+
+private:
+  struct Node {
+    BLBox box;
+    uint32_t first; // entries_ index for leaves, nodes_ index otherwise
+    uint32_t count;
+    bool leaf;
+  };
+
+  std::vector<PathIndexEntry> entries_;
+  std::vector<Node> nodes_; // level by level from the leaves, root last
+};
+
+struct PathIndex {
+  // Serializes inserts; each one builds a new tree from the current one.
+  std::mutex write_mutex;
+
+  // Guards `tree` only. Queries take a reference and run unlocked, so they
+  // never wait for a rebuild.
+  std::mutex mutex;
+  std::shared_ptr<const PathIndexTree> tree;
+
+  std::shared_ptr<const PathIndexTree> snapshot()
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    return tree;
+  }
+
+  void destroy()
+  {
+    tree.reset();
+  }
+};
@@ -0,0 +1,275 @@
+#include "path.h"
+#include "matrix2d.h"
+#include "../nif/nif_resource.h"
+#include "../nif/nif_util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <vector>
+
+// Polyline simplification (Path.simplify/4).
+//
+// Every figure is cut into runs of straight lines: a run starts at a move
+// or at the end of a curve and goes on through the line_to vertices after
+// it. The first and last vertex of a run are kept, and so are curves and
+// closes; only the vertices inside a run may be dropped.
+
+namespace {
+
+enum SimplifyAlgorithm { SIMPLIFY_RDP, SIMPLIFY_VISVALINGAM };
+
+double segment_dist2(const BLPoint& p, const BLPoint& a, const BLPoint& b)
+{
+  const double vx = b.x - a.x, vy = b.y - a.y;
+  const double len2 = vx * vx + vy * vy;
+  double t = len2 > 0.0 ? ((p.x - a.x) * vx + (p.y - a.y) * vy) / len2 : 0.0;
+  t = std::clamp(t, 0.0, 1.0);
+  const double dx = p.x - a.x - t * vx, dy = p.y - a.y - t * vy;
+  return dx * dx + dy * dy;
+}
+
+double triangle_area(const BLPoint& a, const BLPoint& b, const BLPoint& c)
+{
+  return std::abs((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y)) * 0.5;
+}
+
+// Ramer-Douglas-Peucker over vtx[first, last], with an explicit stack:
+// keeps the vertex farthest from the chord while it is more than `tol`
+// away and splits there.
+void simplify_rdp(const BLPoint* vtx, size_t first, size_t last, double tol, uint8_t* keep)
+{
+  const double tol2 = tol * tol;
+  std::vector<std::pair<size_t, size_t>> stack;
+  stack.emplace_back(first, last);
+
+  while(!stack.empty()) {
+    const auto [a, b] = stack.back();
+    stack.pop_back();
+
+    double best = tol2;
+    size_t split = 0;
+    for(size_t i = a + 1; i < b; i++) {
+      const double d = segment_dist2(vtx[i], vtx[a], vtx[b]);
+      if(d > best) {
+        best = d;
+        split = i;
+      }
+    }
+    if(split == 0)
+      continue;
+
+    keep[split] = 1;
+    if(split - a > 1)
+      stack.emplace_back(a, split);
+    if(b - split > 1)
+      stack.emplace_back(split, b);
+  }
+}
+
+// Visvalingam-Whyatt over vtx[first, last]: drops the vertex spanning the
+// smallest triangle with its neighbours while that area is below tol².
+// An area never drops below the one of a vertex removed before it, so a
+// point is not lost just because its neighbours went first.
+void simplify_visvalingam(const BLPoint* vtx, size_t first, size_t last, double tol, uint8_t* keep)
+{
+  const size_t n = last - first + 1;
+  const double limit = tol * tol;
+
+  std::vector<size_t> prev(n), next(n);
+  std::vector<double> area(n, 0.0);
+  using Entry = std::pair<double, size_t>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+
+  for(size_t i = 1; i + 1 < n; i++) {
+    prev[i] = i - 1;
+    next[i] = i + 1;
+    area[i] = triangle_area(vtx[first + i - 1], vtx[first + i], vtx[first + i + 1]);
+    keep[first + i] = 1;
+    heap.emplace(area[i], i);
+  }
+
+  double floor = 0.0;
+  while(!heap.empty()) {
+    const auto [a, i] = heap.top();
+    if(a >= limit)
+      break;
+    heap.pop();
+    // Stale entry of a vertex already dropped or updated since.
+    if(!keep[first + i] || a != area[i])
+      continue;
+
+    floor = std::max(floor, a);
+    keep[first + i] = 0;
+    const size_t p = prev[i], q = next[i];
+    next[p] = q;
+    prev[q] = p;
+
+    for(size_t j : {p, q}) {
+      if(j == 0 || j == n - 1)
+        continue;
+      area[j] = std::max(floor,
+                         triangle_area(vtx[first + prev[j]], vtx[first + j], vtx[first + next[j]]));
+      heap.emplace(area[j], j);
+    }
+  }
+}
+
+// Marks the vertices of `path` to keep. Returns false on a command
+// sequence that is not a valid path.
+bool plan_simplify(
+    const BLPath& path, double tol, SimplifyAlgorithm algorithm, std::vector<uint8_t>& keep)
+{
+  const size_t n = path.size();
+  const uint8_t* cmd = path.command_data();
+  const BLPoint* vtx = path.vertex_data();
+
+  keep.assign(n, 1);
+
+  // Simplifies the run of lines that starts at vtx[anchor] and returns the
+  // index after it.
+  auto run = [&](size_t anchor) {
+    size_t last = anchor;
+    while(last + 1 < n && cmd[last + 1] == BL_PATH_CMD_ON)
+      last++;
+    if(last - anchor > 1) {
+      std::fill(keep.begin() + anchor + 1, keep.begin() + last, uint8_t(0));
+      if(algorithm == SIMPLIFY_RDP)
+        simplify_rdp(vtx, anchor, last, tol, keep.data());
+      else
+        simplify_visvalingam(vtx, anchor, last, tol, keep.data());
+    }
+    return last + 1;
+  };
+
+  size_t i = 0;
+  while(i < n) {
+    switch(cmd[i]) {
+    case BL_PATH_CMD_MOVE:
+      i = run(i);
+      break;
+
+    case BL_PATH_CMD_ON:
+    case BL_PATH_CMD_CLOSE:
+      // Only reached for lines right after a close. They start at the
+      // figure's move, which is not next to them, so the run is anchored at
+      // the first line's end point.
+      if(i == 0)
+        return false;
+      i = cmd[i] == BL_PATH_CMD_ON ? run(i) : i + 1;
+      break;
+
+    case BL_PATH_CMD_QUAD:
+      if(i == 0 || i + 1 >= n || cmd[i + 1] != BL_PATH_CMD_ON)
+        return false;
+      i = run(i + 1);
+      break;
+
+    case BL_PATH_CMD_CONIC:
+    case BL_PATH_CMD_CUBIC:
+      if(i == 0 || i + 2 >= n || cmd[i + 2] != BL_PATH_CMD_ON ||
+         cmd[i + 1] != (cmd[i] == BL_PATH_CMD_CONIC ? BL_PATH_CMD_WEIGHT : BL_PATH_CMD_CUBIC))
+        return false;
+      i = run(i + 2);
+      break;
+
+    default:
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Largest factor by which `m` stretches a distance.
+double max_scale(const BLMatrix2D& m)
+{
+  const double s = m.m00 * m.m00 + m.m01 * m.m01 + m.m10 * m.m10 + m.m11 * m.m11;
+  const double det = m.m00 * m.m11 - m.m01 * m.m10;
+  return std::sqrt((s + std::sqrt(std::max(0.0, s * s - 4.0 * det * det))) * 0.5);
+}
+
+} // namespace
+
+// path_simplify(path, tolerance, algorithm, matrix) -> {:ok, new_path} | {:error, reason}
+//
+//   algorithm :: :rdp | :visvalingam
+//   matrix    :: Matrix2D | nil
+//
+// :rdp keeps every vertex farther than `tolerance` from the simplified
+// line; :visvalingam drops vertices whose triangle with their neighbours
+// has an area below tolerance². With a matrix, `tolerance` is in device
+// pixels. For :rdp it is divided by the matrix' largest scale, so no vertex
+// moves more than that many pixels once transformed. For :visvalingam it is
+// divided by the square root of |det|, the factor by which the matrix scales
+// areas, so no dropped triangle covers more than tolerance² square pixels.
+ERL_NIF_TERM path_simplify(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 4)
+    return enif_make_badarg(env);
+
+  auto src = NifResource<Path>::get(env, argv[0]);
+  if(src == nullptr)
+    return make_result_error(env, "path_simplify_invalid_path");
+
+  double tolerance;
+  if(!enif_get_double(env, argv[1], &tolerance) || !(tolerance >= 0.0) || !std::isfinite(tolerance))
+    return make_result_error(env, "path_simplify_invalid_tolerance");
+
+  char atom[16];
+  SimplifyAlgorithm algorithm;
+  if(!enif_get_atom(env, argv[2], atom, sizeof(atom), ERL_NIF_UTF8))
+    return make_result_error(env, "path_simplify_invalid_algorithm");
+  if(std::strcmp(atom, "rdp") == 0)
+    algorithm = SIMPLIFY_RDP;
+  else if(std::strcmp(atom, "visvalingam") == 0)
+    algorithm = SIMPLIFY_VISVALINGAM;
+  else
+    return make_result_error(env, "path_simplify_invalid_algorithm");
+
+  if(!enif_is_identical(argv[3], enif_make_atom(env, "nil"))) {
+    auto matrix = NifResource<Matrix2D>::get(env, argv[3]);
+    if(matrix == nullptr)
+      return make_result_error(env, "path_simplify_invalid_matrix");
+    const BLMatrix2D& m = matrix->value;
+    const double scale = algorithm == SIMPLIFY_RDP
+                             ? max_scale(m)
+                             : std::sqrt(std::fabs(m.m00 * m.m11 - m.m01 * m.m10));
+    if(!(scale > 0.0) || !std::isfinite(scale))
+      return make_result_error(env, "path_simplify_invalid_matrix");
+    tolerance /= scale;
+  }
+
+  // The path is copied (a reference bump) so other processes may keep
+  // editing theirs meanwhile.
+  const BLPath shape = src->value;
+  std::vector<uint8_t> keep;
+  if(!plan_simplify(shape, tolerance, algorithm, keep))
+    return make_result_error(env, "path_simplify_invalid_commands");
+
+  auto dst = NifResource<Path>::alloc();
+  if(dst == nullptr)
+    return make_result_error(env, "path_simplify_alloc_failed");
+
+  const size_t total = size_t(std::count(keep.begin(), keep.end(), uint8_t(1)));
+  if(total) {
+    uint8_t* cmd_out;
+    BLPoint* vtx_out;
+    if(dst->value.modify_op(BL_MODIFY_OP_ASSIGN_FIT, total, &cmd_out, &vtx_out) != BL_SUCCESS) {
+      enif_release_resource(dst);
+      return make_result_error(env, "path_simplify_alloc_failed");
+    }
+
+    const uint8_t* cmd = shape.command_data();
+    const BLPoint* vtx = shape.vertex_data();
+    for(size_t i = 0, n = shape.size(); i < n; i++) {
+      if(keep[i]) {
+        *cmd_out++ = cmd[i];
+        *vtx_out++ = vtx[i];
+      }
+    }
+  }
+
+  return make_result_ok(env, NifResource<Path>::make(env, dst));
+}
@@ -0,0 +1,186 @@
+#include "../nif/nif_util.h"
+#include "../nif/parallel.h"
+
+#include <blend2d/blend2d.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <vector>
+
+// M4 decimation of time series (Plot.decimate_m4/4).
+//
+// Samples are bucketed into pixel columns by x. Per column only four are
+// kept: the first and the last one, and those with the smallest and the
+// largest y. A polyline through them, in sample order, rasterizes to the
+// same pixels as one through every sample, at no more than four vertices
+// per column however long the series is.
+
+namespace {
+
+// Samples handled per thread at the least.
+constexpr size_t kMinChunk = 1 << 18;
+
+constexpr uint64_t kNone = UINT64_MAX;
+
+struct M4Column {
+  uint64_t first = kNone;
+  uint64_t last = kNone;
+  uint64_t min = kNone;
+  uint64_t max = kNone;
+  double min_y = 0.0;
+  double max_y = 0.0;
+};
+
+struct M4Job {
+  const uint8_t* xs;
+  const uint8_t* ys;
+  double x0;
+  double scale; // columns per x unit
+  size_t width;
+};
+
+double load_f64(const uint8_t* p, size_t i)
+{
+  double v;
+  std::memcpy(&v, p + i * sizeof(double), sizeof(double));
+  return v;
+}
+
+// One pass over samples [begin, end) into `cols`.
+void m4_scan(const M4Job& job, size_t begin, size_t end, M4Column* cols)
+{
+  const double last_col = double(job.width - 1);
+
+  for(size_t i = begin; i < end; i++) {
+    const double x = load_f64(job.xs, i);
+    const double y = load_f64(job.ys, i);
+    const double c = (x - job.x0) * job.scale;
+    // Also skips NaN and out-of-range samples.
+    if(!(c >= 0.0 && c <= last_col + 1.0) || std::isnan(y))
+      continue;
+
+    M4Column& col = cols[size_t(std::min(c, last_col))];
+    if(col.first == kNone) {
+      col.first = col.last = col.min = col.max = i;
+      col.min_y = col.max_y = y;
+      continue;
+    }
+    col.last = i;
+    if(y < col.min_y) {
+      col.min_y = y;
+      col.min = i;
+    }
+    if(y > col.max_y) {
+      col.max_y = y;
+      col.max = i;
+    }
+  }
+}
+
+// Folds the columns of a later chunk into those of an earlier one.
+void m4_merge(M4Column* into, const M4Column* from, size_t width)
+{
+  for(size_t c = 0; c < width; c++) {
+    const M4Column& b = from[c];
+    M4Column& a = into[c];
+    if(b.first == kNone)
+      continue;
+    if(a.first == kNone) {
+      a = b;
+      continue;
+    }
+    a.last = b.last;
+    if(b.min_y < a.min_y) {
+      a.min_y = b.min_y;
+      a.min = b.min;
+    }
+    if(b.max_y > a.max_y) {
+      a.max_y = b.max_y;
+      a.max = b.max;
+    }
+  }
+}
+
+} // namespace
+
+// plot_decimate_m4(xs, ys, x_min, x_max, width, threads) -> {:ok, points} | {:error, reason}
+//
+//   xs, ys  :: binaries of native-endian f64, one value per sample
+//   width   :: number of pixel columns spanning [x_min, x_max], at most
+//              65536 (wider than any Blend2D image)
+//   threads :: how many threads may share the work, the caller's included
+//
+// Returns packed native-endian f64 (x, y) pairs, column by column and in
+// sample order within a column, at most four per column. Samples outside
+// the range or with a NaN are skipped.
+ERL_NIF_TERM plot_decimate_m4(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 6)
+    return enif_make_badarg(env);
+
+  ErlNifBinary xs, ys;
+  if(!enif_inspect_binary(env, argv[0], &xs) || xs.size % sizeof(double) != 0)
+    return make_result_error(env, "plot_decimate_m4_invalid_xs");
+  if(!enif_inspect_binary(env, argv[1], &ys) || ys.size != xs.size)
+    return make_result_error(env, "plot_decimate_m4_invalid_ys");
+
+  double x0, x1;
+  if(!enif_get_double(env, argv[2], &x0) || !enif_get_double(env, argv[3], &x1) ||
+     !std::isfinite(x0) || !std::isfinite(x1) || !(x1 > x0))
+    return make_result_error(env, "plot_decimate_m4_invalid_range");
+
+  unsigned width;
+  if(!enif_get_uint(env, argv[4], &width) || width == 0 || width > (1u << 16))
+    return make_result_error(env, "plot_decimate_m4_invalid_width");
+
+  unsigned threads;
+  if(!enif_get_uint(env, argv[5], &threads))
+    return make_result_error(env, "plot_decimate_m4_invalid_threads");
+
+  const size_t n = xs.size / sizeof(double);
+  const M4Job job{xs.data, ys.data, x0, width / (x1 - x0), width};
+
+  // Each chunk covers at least kMinChunk samples, so the per-chunk columns
+  // (at most 2 MiB each) never outweigh the input they summarize.
+  const size_t count =
+      std::max<size_t>(1, std::min<size_t>(std::max(threads, 1u), n / kMinChunk));
+
+  std::vector<uint64_t> keep;
+  try {
+    std::vector<std::vector<M4Column>> cols(count, std::vector<M4Column>(width));
+
+    parallel_for(count, [&](size_t i) {
+      m4_scan(job, n * i / count, n * (i + 1) / count, cols[i].data());
+    });
+    for(size_t i = 1; i < count; i++)
+      m4_merge(cols[0].data(), cols[i].data(), width);
+
+    keep.reserve(size_t(width) * 4);
+    for(const M4Column& col : cols[0]) {
+      if(col.first == kNone)
+        continue;
+      uint64_t idx[4] = {col.first, col.min, col.max, col.last};
+      std::sort(idx, idx + 4);
+      for(int k = 0; k < 4; k++) {
+        if(k == 0 || idx[k] != idx[k - 1])
+          keep.push_back(idx[k]);
+      }
+    }
+  }
+  catch(const std::bad_alloc&) {
+    return make_result_error(env, "plot_decimate_m4_alloc_failed");
+  }
+
+  ERL_NIF_TERM term;
+  auto* out = enif_make_new_binary(env, keep.size() * sizeof(BLPoint), &term);
+  if(out == nullptr && !keep.empty())
+    return make_result_error(env, "plot_decimate_m4_alloc_failed");
+
+  for(size_t k = 0; k < keep.size(); k++) {
+    const double p[2] = {load_f64(xs.data, keep[k]), load_f64(ys.data, keep[k])};
+    std::memcpy(out + k * sizeof(BLPoint), p, sizeof(p));
+  }
+
+  return make_result_ok(env, term);
+}
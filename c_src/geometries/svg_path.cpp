@@ -0,0 +1,342 @@
+#include "path.h"
+#include "../nif/nif_resource.h"
+#include "../nif/nif_util.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+// SVG path data (the `d` attribute) parser for Path.from_svg_d/1.
+//
+// Follows the grammar of SVG 1.1 / SVG 2, section "Path data": absolute and
+// relative commands, implicit repeats (extra coordinates after M/m are
+// line-tos), smooth curves reflecting the previous control point only after
+// a curve of the same kind, and arc flags written without separators.
+// Coordinates are kept as SVG defines them; nothing is normalized.
+
+namespace {
+
+constexpr double kRadiansPerDegree = 3.14159265358979323846 / 180.0;
+
+class SvgPathParser {
+public:
+  SvgPathParser(const uint8_t* data, size_t size) : begin_(data), p_(data), end_(data + size) {}
+
+  // Returns nullptr on success, otherwise the error reason; offset() is
+  // then where parsing stopped.
+  const char* parse(BLPath* path);
+
+  size_t offset() const noexcept
+  {
+    return size_t(p_ - begin_);
+  }
+
+private:
+  enum Last { LAST_OTHER, LAST_CUBIC, LAST_QUAD };
+
+  static bool is_space(uint8_t c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+  }
+
+  void skip_space()
+  {
+    while(p_ < end_ && is_space(*p_))
+      p_++;
+  }
+
+  // Whitespace with at most one comma in it.
+  void skip_separator()
+  {
+    skip_space();
+    if(p_ < end_ && *p_ == ',') {
+      p_++;
+      skip_space();
+    }
+  }
+
+  bool at_number() const
+  {
+    if(p_ >= end_)
+      return false;
+    const uint8_t c = *p_;
+    return (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+';
+  }
+
+  bool number(double* out);
+  bool flag(bool* out);
+  bool numbers(double* out, int n);
+  const char* command(BLPath* path, uint8_t cmd);
+
+  const uint8_t* begin_;
+  const uint8_t* p_;
+  const uint8_t* end_;
+
+  BLPoint cur_{0, 0};
+  BLPoint start_{0, 0};
+  BLPoint ctrl_{0, 0};
+  Last last_ = LAST_OTHER;
+  bool closed_ = false;
+};
+
+// Scans one number token: sign, digits, at most one '.', optional exponent.
+// "1.5.5" is two numbers and "-1-2" as well, as the grammar allows.
+bool SvgPathParser::number(double* out)
+{
+  const uint8_t* q = p_;
+  if(q < end_ && (*q == '+' || *q == '-'))
+    q++;
+
+  size_t digits = 0;
+  while(q < end_ && *q >= '0' && *q <= '9') {
+    q++;
+    digits++;
+  }
+  if(q < end_ && *q == '.') {
+    q++;
+    while(q < end_ && *q >= '0' && *q <= '9') {
+      q++;
+      digits++;
+    }
+  }
+  if(digits == 0)
+    return false;
+
+  if(q < end_ && (*q == 'e' || *q == 'E')) {
+    const uint8_t* e = q + 1;
+    if(e < end_ && (*e == '+' || *e == '-'))
+      e++;
+    if(e < end_ && *e >= '0' && *e <= '9') {
+      while(e < end_ && *e >= '0' && *e <= '9')
+        e++;
+      q = e;
+    }
+  }
+
+  char buf[64];
+  const size_t len = size_t(q - p_);
+  if(len >= sizeof(buf))
+    return false;
+  std::memcpy(buf, p_, len);
+  buf[len] = '\0';
+
+  *out = std::strtod(buf, nullptr);
+  if(!std::isfinite(*out))
+    return false;
+  p_ = q;
+  return true;
+}
+
+bool SvgPathParser::flag(bool* out)
+{
+  if(p_ >= end_ || (*p_ != '0' && *p_ != '1'))
+    return false;
+  *out = *p_++ == '1';
+  return true;
+}
+
+// Reads `n` numbers separated by whitespace and/or a comma.
+bool SvgPathParser::numbers(double* out, int n)
+{
+  for(int i = 0; i < n; i++) {
+    if(i > 0)
+      skip_separator();
+    if(!number(&out[i]))
+      return false;
+  }
+  return true;
+}
+
+// Draws one set of parameters of `cmd`, which is already consumed.
+const char* SvgPathParser::command(BLPath* path, uint8_t cmd)
+{
+  const bool rel = cmd >= 'a';
+  const BLPoint o = rel ? cur_ : BLPoint(0, 0);
+  double a[7];
+  BLResult r = BL_SUCCESS;
+
+  // SVG continues a closed subpath from its start point; Blend2D needs an
+  // explicit move there.
+  if(closed_ && (cmd | 0x20) != 'm' && (cmd | 0x20) != 'z') {
+    r = path->move_to(start_);
+    closed_ = false;
+  }
+
+  Last last = LAST_OTHER;
+  switch(cmd | 0x20) {
+  case 'm':
+    if(!numbers(a, 2))
+      return "path_from_svg_d_expected_number";
+    cur_ = start_ = BLPoint(o.x + a[0], o.y + a[1]);
+    r = path->move_to(cur_);
+    closed_ = false;
+    break;
+
+  case 'l':
+    if(!numbers(a, 2))
+      return "path_from_svg_d_expected_number";
+    cur_ = BLPoint(o.x + a[0], o.y + a[1]);
+    r = path->line_to(cur_);
+    break;
+
+  case 'h':
+    if(!numbers(a, 1))
+      return "path_from_svg_d_expected_number";
+    cur_.x = o.x + a[0];
+    r = path->line_to(cur_);
+    break;
+
+  case 'v':
+    if(!numbers(a, 1))
+      return "path_from_svg_d_expected_number";
+    cur_.y = o.y + a[0];
+    r = path->line_to(cur_);
+    break;
+
+  case 'c':
+    if(!numbers(a, 6))
+      return "path_from_svg_d_expected_number";
+    ctrl_ = BLPoint(o.x + a[2], o.y + a[3]);
+    r = path->cubic_to(BLPoint(o.x + a[0], o.y + a[1]), ctrl_, BLPoint(o.x + a[4], o.y + a[5]));
+    cur_ = BLPoint(o.x + a[4], o.y + a[5]);
+    last = LAST_CUBIC;
+    break;
+
+  case 's': {
+    if(!numbers(a, 4))
+      return "path_from_svg_d_expected_number";
+    const BLPoint c1 =
+        last_ == LAST_CUBIC ? BLPoint(2 * cur_.x - ctrl_.x, 2 * cur_.y - ctrl_.y) : cur_;
+    ctrl_ = BLPoint(o.x + a[0], o.y + a[1]);
+    cur_ = BLPoint(o.x + a[2], o.y + a[3]);
+    r = path->cubic_to(c1, ctrl_, cur_);
+    last = LAST_CUBIC;
+    break;
+  }
+
+  case 'q':
+    if(!numbers(a, 4))
+      return "path_from_svg_d_expected_number";
+    ctrl_ = BLPoint(o.x + a[0], o.y + a[1]);
+    cur_ = BLPoint(o.x + a[2], o.y + a[3]);
+    r = path->quad_to(ctrl_, cur_);
+    last = LAST_QUAD;
+    break;
+
+  case 't':
+    if(!numbers(a, 2))
+      return "path_from_svg_d_expected_number";
+    ctrl_ = last_ == LAST_QUAD ? BLPoint(2 * cur_.x - ctrl_.x, 2 * cur_.y - ctrl_.y) : cur_;
+    cur_ = BLPoint(o.x + a[0], o.y + a[1]);
+    r = path->quad_to(ctrl_, cur_);
+    last = LAST_QUAD;
+    break;
+
+  case 'a': {
+    bool large, sweep;
+    if(!numbers(a, 3))
+      return "path_from_svg_d_expected_number";
+    skip_separator();
+    if(!flag(&large))
+      return "path_from_svg_d_expected_flag";
+    skip_separator();
+    if(!flag(&sweep))
+      return "path_from_svg_d_expected_flag";
+    skip_separator();
+    if(!numbers(a + 3, 2))
+      return "path_from_svg_d_expected_number";
+
+    const BLPoint end(o.x + a[3], o.y + a[4]);
+    // Out-of-range parameters as in SVG's implementation notes: an arc to
+    // the current point is dropped, one with a zero radius is a line.
+    if(end.x == cur_.x && end.y == cur_.y)
+      break;
+    if(a[0] == 0 || a[1] == 0)
+      r = path->line_to(end);
+    else
+      r = path->elliptic_arc_to(
+          std::fabs(a[0]), std::fabs(a[1]), a[2] * kRadiansPerDegree, large, sweep, end.x, end.y);
+    cur_ = end;
+    break;
+  }
+
+  case 'z':
+    r = path->close();
+    cur_ = start_;
+    closed_ = true;
+    break;
+
+  default:
+    return "path_from_svg_d_unknown_command";
+  }
+
+  last_ = last;
+  return r == BL_SUCCESS ? nullptr : "path_from_svg_d_failed";
+}
+
+const char* SvgPathParser::parse(BLPath* path)
+{
+  skip_space();
+  if(p_ == end_)
+    return nullptr;
+  if(*p_ != 'M' && *p_ != 'm')
+    return "path_from_svg_d_expected_move";
+
+  uint8_t cmd = 0;
+  while(true) {
+    skip_space();
+    if(p_ == end_)
+      return nullptr;
+
+    const uint8_t c = *p_;
+    if((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) {
+      if(!std::strchr("MmLlHhVvCcSsQqTtAaZz", c))
+        return "path_from_svg_d_unknown_command";
+      cmd = c;
+      p_++;
+      skip_space();
+    }
+    else if(cmd == 0 || (cmd | 0x20) == 'z' || !at_number()) {
+      return "path_from_svg_d_unexpected_character";
+    }
+    else if(cmd == 'M' || cmd == 'm') {
+      // Coordinates after a move are implicit line-tos.
+      cmd = cmd == 'M' ? 'L' : 'l';
+    }
+
+    if(const char* err = command(path, cmd))
+      return err;
+    skip_separator();
+  }
+}
+
+} // namespace
+
+// path_from_svg_d(d) -> {:ok, path} | {:error, {reason, byte_offset}}
+//
+//   d :: binary, SVG path data
+ERL_NIF_TERM path_from_svg_d(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 1)
+    return enif_make_badarg(env);
+
+  ErlNifBinary d;
+  if(!enif_inspect_iolist_as_binary(env, argv[0], &d))
+    return make_result_error(env, "path_from_svg_d_invalid_data");
+
+  auto path = NifResource<Path>::alloc();
+  if(path == nullptr)
+    return make_result_error(env, "path_from_svg_d_alloc_failed");
+
+  SvgPathParser parser(d.data, d.size);
+  if(const char* reason = parser.parse(&path->value)) {
+    enif_release_resource(path);
+    return enif_make_tuple2(env,
+                            enif_make_atom(env, "error"),
+                            enif_make_tuple2(env,
+                                             enif_make_atom(env, reason),
+                                             enif_make_ulong(env, parser.offset())));
+  }
+
+  return make_result_ok(env, NifResource<Path>::make(env, path));
+}
@@ -0,0 +1,124 @@
+#include "anim.h"
+#include "../canvas/canvas.h"
+#include "../nif/nif_resource.h"
+#include "../nif/nif_util.h"
+
+#include <cmath>
+#include <cstring>
+#include <string>
+
+// anim_new(Path, Format, Fps, Plays, PngOpts) -> {:ok, Anim} | {:error, reason}
+//
+//   Format  :: :apng | :gif
+//   Fps     :: float > 0, frames per second
+//   Plays   :: non-negative integer, times played (0 loops forever)
+//   PngOpts :: keyword list of Canvas.to_png/2, for APNG frames
+//
+// Creates a temporary file next to Path right away; anim_finish renames it
+// over Path, which is left untouched until then. Nothing is written until
+// the first frame, which fixes the size of the animation.
+ERL_NIF_TERM anim_new(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 5)
+    return enif_make_badarg(env);
+
+  ErlNifBinary path_bin;
+  if(!enif_inspect_binary(env, argv[0], &path_bin) || path_bin.size == 0 ||
+     memchr(path_bin.data, 0, path_bin.size) != nullptr)
+    return make_result_error(env, "anim_new_invalid_path");
+  std::string path(reinterpret_cast<const char*>(path_bin.data), path_bin.size);
+
+  char format[8];
+  if(!enif_get_atom(env, argv[1], format, sizeof(format), ERL_NIF_UTF8) ||
+     (strcmp(format, "apng") != 0 && strcmp(format, "gif") != 0))
+    return make_result_error(env, "anim_new_invalid_format");
+
+  AnimOptions opts;
+  if(!enif_get_double(env, argv[2], &opts.fps) || !std::isfinite(opts.fps) || opts.fps <= 0.0 ||
+     !enif_get_uint(env, argv[3], &opts.plays) || !parse_png_options(env, argv[4], &opts.png))
+    return make_result_error(env, "anim_new_invalid_options");
+
+  auto file = std::make_unique<FileSink>();
+  if(!file->open(path))
+    return make_result_error(env, "anim_new_open_failed");
+
+  auto anim = NifResource<Anim>::alloc();
+  if(anim == nullptr)
+    return make_result_error(env, "anim_new_alloc_failed");
+
+  if(strcmp(format, "apng") == 0)
+    anim->writer = std::make_unique<ApngWriter>(file.get(), opts);
+  else
+    anim->writer = std::make_unique<GifWriter>(file.get(), opts);
+  anim->file = std::move(file);
+
+  return make_result_ok(env, NifResource<Anim>::make(env, anim));
+}
+
+// anim_add_frame(Anim, Canvas) -> :ok | {:error, reason}
+//
+// Encodes the current canvas contents as the next frame and appends it to
+// the file. After a failed write the animation is closed and its temporary
+// file removed.
+ERL_NIF_TERM anim_add_frame(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 2)
+    return enif_make_badarg(env);
+
+  auto anim = NifResource<Anim>::get(env, argv[0]);
+  if(anim == nullptr)
+    return make_result_error(env, "anim_add_frame_invalid_anim");
+
+  auto canvas = NifResource<Canvas>::get(env, argv[1]);
+  if(canvas == nullptr)
+    return make_result_error(env, "anim_add_frame_invalid_canvas");
+
+  std::lock_guard<std::mutex> guard(anim->mutex);
+  if(!anim->writer)
+    return make_result_error(env, "anim_closed");
+
+  CanvasLock lock(canvas, CanvasLock::kRead);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
+  AnimWriter& writer = *anim->writer;
+  BLSizeI size = canvas->img.size();
+  if(writer.frame_count() > 0 && (size.w != writer.width() || size.h != writer.height()))
+    return make_result_error(env, "anim_add_frame_size_mismatch");
+
+  canvas->ctx.flush(BL_CONTEXT_FLUSH_SYNC);
+  if(writer.add_frame(canvas->img) != BL_SUCCESS) {
+    anim->destroy();
+    return make_result_error(env, "anim_add_frame_failed");
+  }
+
+  return enif_make_atom(env, "ok");
+}
+
+// anim_finish(Anim) -> :ok | {:error, reason}
+//
+// Writes the trailer, closes the file and renames it over Path. The
+// animation cannot take frames afterwards. An animation without frames is
+// discarded with its temporary file.
+ERL_NIF_TERM anim_finish(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 1)
+    return enif_make_badarg(env);
+
+  auto anim = NifResource<Anim>::get(env, argv[0]);
+  if(anim == nullptr)
+    return make_result_error(env, "anim_finish_invalid_anim");
+
+  std::lock_guard<std::mutex> guard(anim->mutex);
+  if(!anim->writer)
+    return make_result_error(env, "anim_closed");
+
+  const char* error = nullptr;
+  if(anim->writer->frame_count() == 0)
+    error = "anim_finish_no_frames";
+  else if(anim->writer->finish() != BL_SUCCESS || !anim->file->close(false))
+    error = "anim_finish_failed";
+
+  anim->destroy();
+  return error ? make_result_error(env, error) : enif_make_atom(env, "ok");
+}
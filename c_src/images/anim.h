@@ -0,0 +1,22 @@
+#pragma once
+#include "anim_encoder.h"
+#include "file_sink.h"
+
+#include <memory>
+#include <mutex>
+
+// An animation being written by Blendend.Anim. Both members are dropped
+// once it is finished or a write fails; dropping an unfinished file
+// removes it.
+struct Anim {
+  // All anim NIFs run on dirty schedulers, so callers simply wait here.
+  std::mutex mutex;
+  std::unique_ptr<FileSink> file;
+  std::unique_ptr<AnimWriter> writer;
+
+  void destroy()
+  {
+    writer.reset();
+    file.reset();
+  }
+};
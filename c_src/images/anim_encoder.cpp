@@ -0,0 +1,656 @@
+#include "anim_encoder.h"
+#include "pixel_convert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+  constexpr int kGifMaxCodes = 4096;
+  constexpr int kGifHashSize = 8192;
+
+  void put_u32_be(uint8_t* p, uint32_t v)
+  {
+    p[0] = uint8_t(v >> 24);
+    p[1] = uint8_t(v >> 16);
+    p[2] = uint8_t(v >> 8);
+    p[3] = uint8_t(v);
+  }
+
+  void put_u16_be(uint8_t* p, uint16_t v)
+  {
+    p[0] = uint8_t(v >> 8);
+    p[1] = uint8_t(v);
+  }
+
+  void put_u16_le(uint8_t* p, uint16_t v)
+  {
+    p[0] = uint8_t(v);
+    p[1] = uint8_t(v >> 8);
+  }
+
+  const uint32_t* pixel_row(const BLImageData& img, int y)
+  {
+    return reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(img.pixel_data) +
+                                             intptr_t(y) * img.stride);
+  }
+
+  // GIF LZW with 8-bit symbols, packed LSB first into 255-byte sub-blocks.
+  // Follows the classic compress/GIF encoder: codes widen once the next free
+  // code no longer fits, and a full table is reset with a clear code.
+  class LzwEncoder {
+  public:
+    explicit LzwEncoder(std::vector<uint8_t>* out)
+        : out_(out), keys_(kGifHashSize), codes_(kGifHashSize)
+    {
+      reset_table();
+    }
+
+    void encode(const uint8_t* symbols, size_t count)
+    {
+      output(kClear);
+      if(count == 0) {
+        output(kEnd);
+        finish();
+        return;
+      }
+
+      int prefix = symbols[0];
+      for(size_t i = 1; i < count; i++) {
+        const int c = symbols[i];
+        const int32_t key = (prefix << 8) | c;
+
+        uint32_t slot = (uint32_t(key) * 2654435761u) >> 19;
+        while(keys_[slot] >= 0 && keys_[slot] != key)
+          slot = (slot + 1) & (kGifHashSize - 1);
+        if(keys_[slot] == key) {
+          prefix = codes_[slot];
+          continue;
+        }
+
+        output(prefix);
+        prefix = c;
+        if(next_ < kGifMaxCodes) {
+          keys_[slot] = key;
+          codes_[slot] = uint16_t(next_++);
+        }
+        else {
+          reset_table();
+          clear_pending_ = true;
+          output(kClear);
+        }
+      }
+
+      output(prefix);
+      output(kEnd);
+      finish();
+    }
+
+  private:
+    static constexpr int kClear = 256;
+    static constexpr int kEnd = 257;
+
+    void reset_table()
+    {
+      std::fill(keys_.begin(), keys_.end(), -1);
+      next_ = kEnd + 1;
+    }
+
+    void output(int code)
+    {
+      acc_ |= uint32_t(code) << nbits_;
+      nbits_ += bits_;
+      while(nbits_ >= 8) {
+        put(uint8_t(acc_));
+        acc_ >>= 8;
+        nbits_ -= 8;
+      }
+
+      if(clear_pending_) {
+        bits_ = 9;
+        clear_pending_ = false;
+      }
+      else if(next_ > (1 << bits_) - 1 && bits_ < 12) {
+        bits_++;
+      }
+    }
+
+    void put(uint8_t byte)
+    {
+      block_[block_size_++] = byte;
+      if(block_size_ == 255)
+        flush_block();
+    }
+
+    void flush_block()
+    {
+      if(block_size_ == 0)
+        return;
+      out_->push_back(uint8_t(block_size_));
+      out_->insert(out_->end(), block_, block_ + block_size_);
+      block_size_ = 0;
+    }
+
+    void finish()
+    {
+      if(nbits_ > 0)
+        put(uint8_t(acc_));
+      acc_ = 0;
+      nbits_ = 0;
+      flush_block();
+    }
+
+    std::vector<uint8_t>* out_;
+    std::vector<int32_t> keys_;
+    std::vector<uint16_t> codes_;
+    int next_ = 0;
+    int bits_ = 9;
+    bool clear_pending_ = false;
+    uint32_t acc_ = 0;
+    int nbits_ = 0;
+    uint8_t block_[255];
+    int block_size_ = 0;
+  };
+
+  // A median-cut box over a range of histogram bins.
+  struct CutBox {
+    size_t begin;
+    size_t end;
+    uint64_t pixels;
+    int shift; // channel with the widest range: 10 red, 5 green, 0 blue
+    int range;
+  };
+
+  void measure(const std::vector<uint16_t>& bins, const std::vector<uint32_t>& hist, CutBox* box)
+  {
+    int lo[3] = {31, 31, 31};
+    int hi[3] = {0, 0, 0};
+    box->pixels = 0;
+    for(size_t i = box->begin; i < box->end; i++) {
+      const uint16_t key = bins[i];
+      box->pixels += hist[key];
+      for(int c = 0; c < 3; c++) {
+        int v = (key >> (10 - 5 * c)) & 31;
+        lo[c] = std::min(lo[c], v);
+        hi[c] = std::max(hi[c], v);
+      }
+    }
+
+    box->range = -1;
+    for(int c = 0; c < 3; c++) {
+      if(hi[c] - lo[c] > box->range) {
+        box->range = hi[c] - lo[c];
+        box->shift = 10 - 5 * c;
+      }
+    }
+  }
+} // namespace
+
+AnimWriter::AnimWriter(FileSink* file, const AnimOptions& opts) : file_(file), opts_(opts) {}
+
+bool AnimWriter::diff_box(const BLImageData& img, BLBoxI* box) const
+{
+  int x0 = width_, x1 = 0, y0 = -1, y1 = 0;
+  const size_t row_bytes = size_t(width_) * 4;
+
+  for(int y = 0; y < height_; y++) {
+    const uint32_t* row = pixel_row(img, y);
+    const uint32_t* prev = prev_.data() + size_t(y) * width_;
+    if(memcmp(row, prev, row_bytes) == 0)
+      continue;
+
+    if(y0 < 0)
+      y0 = y;
+    y1 = y + 1;
+
+    int x = 0;
+    while(x < x0 && row[x] == prev[x])
+      x++;
+    x0 = std::min(x0, x);
+
+    x = width_ - 1;
+    while(x >= x1 && row[x] == prev[x])
+      x--;
+    x1 = std::max(x1, x + 1);
+  }
+
+  if(y0 < 0)
+    return false;
+  *box = BLBoxI(x0, y0, x1, y1);
+  return true;
+}
+
+BLResult AnimWriter::add_frame(const BLImage& img)
+{
+  if(failed_)
+    return BL_ERROR_INVALID_STATE;
+
+  BLImageData data{};
+  BLResult r = img.get_data(&data);
+  if(r != BL_SUCCESS)
+    return r;
+  if(data.format != BL_FORMAT_PRGB32 && data.format != BL_FORMAT_XRGB32)
+    return BL_ERROR_INVALID_VALUE;
+
+  BLBoxI box;
+  if(frames_ == 0) {
+    if(data.size.w <= 0 || data.size.h <= 0)
+      return BL_ERROR_INVALID_VALUE;
+    width_ = data.size.w;
+    height_ = data.size.h;
+    prev_.resize(size_t(width_) * height_);
+    box = BLBoxI(0, 0, width_, height_);
+
+    r = write_header();
+  }
+  else {
+    if(data.size.w != width_ || data.size.h != height_)
+      return BL_ERROR_INVALID_VALUE;
+
+    if(!diff_box(data, &box)) {
+      if(extend_frame(frame_ticks_ + 1)) {
+        frame_ticks_++;
+        ticks_++;
+        return BL_SUCCESS;
+      }
+      // The delay overflowed; repeat a single pixel as a new frame instead.
+      box = BLBoxI(0, 0, 1, 1);
+    }
+  }
+
+  if(r == BL_SUCCESS)
+    r = write_frame(data, box);
+  if(r != BL_SUCCESS) {
+    failed_ = true;
+    return r;
+  }
+
+  for(int y = box.y0; y < box.y1; y++)
+    memcpy(prev_.data() + size_t(y) * width_ + box.x0, pixel_row(data, y) + box.x0,
+           size_t(box.x1 - box.x0) * 4);
+
+  frames_++;
+  frame_ticks_ = 1;
+  ticks_++;
+  return BL_SUCCESS;
+}
+
+BLResult AnimWriter::finish()
+{
+  if(failed_ || frames_ == 0)
+    return BL_ERROR_INVALID_STATE;
+
+  BLResult r = write_trailer();
+  if(r != BL_SUCCESS)
+    failed_ = true;
+  return r;
+}
+
+// ----------------------------------------------------------------------------
+// APNG
+// ----------------------------------------------------------------------------
+
+ApngWriter::ApngWriter(FileSink* file, const AnimOptions& opts) : AnimWriter(file, opts)
+{
+  // Whole frame rates are exact as 1/fps, anything else is rounded to ms.
+  if(opts.fps == std::floor(opts.fps) && opts.fps <= 65535.0) {
+    delay_num_ = 1;
+    delay_den_ = uint16_t(opts.fps);
+  }
+  else {
+    delay_num_ = uint16_t(std::clamp(std::lround(1000.0 / opts.fps), 1l, 65535l));
+    delay_den_ = 1000;
+  }
+}
+
+BLResult ApngWriter::write_chunk(const char type[4], const uint8_t* data, size_t size)
+{
+  return png_write_chunk(
+      [this](const uint8_t* bytes, size_t n) { return sink(bytes, n); }, type, data, size);
+}
+
+bool ApngWriter::patch_chunk(uint64_t offset, const char type[4], const uint8_t* data, size_t size)
+{
+  std::vector<uint8_t> chunk;
+  png_write_chunk(
+      [&chunk](const uint8_t* bytes, size_t n) {
+        chunk.insert(chunk.end(), bytes, bytes + n);
+        return true;
+      },
+      type, data, size);
+  return file_->patch(offset, chunk.data(), chunk.size());
+}
+
+BLResult ApngWriter::write_header()
+{
+  BLResult r = png_write_header([this](const uint8_t* bytes, size_t n) { return sink(bytes, n); },
+                                width_, height_, opts_.png.opaque);
+  if(r != BL_SUCCESS)
+    return r;
+
+  // The frame count is patched in by write_trailer().
+  uint8_t actl[8];
+  put_u32_be(actl, 0);
+  put_u32_be(actl + 4, opts_.plays);
+  actl_offset_ = file_->position();
+  return write_chunk("acTL", actl, sizeof(actl));
+}
+
+BLResult ApngWriter::write_frame(const BLImageData& img, const BLBoxI& box)
+{
+  const int w = box.x1 - box.x0;
+  const int h = box.y1 - box.y0;
+
+  put_u32_be(fctl_, sequence_++);
+  put_u32_be(fctl_ + 4, uint32_t(w));
+  put_u32_be(fctl_ + 8, uint32_t(h));
+  put_u32_be(fctl_ + 12, uint32_t(box.x0));
+  put_u32_be(fctl_ + 16, uint32_t(box.y0));
+  put_u16_be(fctl_ + 20, delay_num_);
+  put_u16_be(fctl_ + 22, delay_den_);
+  fctl_[24] = 0; // APNG_DISPOSE_OP_NONE
+  fctl_[25] = 0; // APNG_BLEND_OP_SOURCE
+
+  fctl_offset_ = file_->position();
+  BLResult r = write_chunk("fcTL", fctl_, sizeof(fctl_));
+  if(r != BL_SUCCESS)
+    return r;
+
+  const uint8_t* pixels = static_cast<const uint8_t*>(img.pixel_data) +
+                          intptr_t(box.y0) * img.stride + intptr_t(box.x0) * 4;
+
+  // The first frame is the default image and goes into IDAT; later ones
+  // into fdAT, which carry a sequence number in front of the data.
+  const bool first = frames_ == 0;
+  return png_deflate_rows(
+      pixels, img.stride, w, h, BLFormat(img.format), opts_.png,
+      [this, first](const uint8_t* data, size_t size) {
+        if(first)
+          return write_chunk("IDAT", data, size) == BL_SUCCESS;
+
+        fdat_.resize(4 + size);
+        put_u32_be(fdat_.data(), sequence_++);
+        memcpy(fdat_.data() + 4, data, size);
+        return write_chunk("fdAT", fdat_.data(), fdat_.size()) == BL_SUCCESS;
+      });
+}
+
+bool ApngWriter::extend_frame(uint32_t ticks)
+{
+  const uint64_t num = uint64_t(delay_num_) * ticks;
+  if(num > 65535)
+    return false;
+
+  put_u16_be(fctl_ + 20, uint16_t(num));
+  return patch_chunk(fctl_offset_, "fcTL", fctl_, sizeof(fctl_));
+}
+
+BLResult ApngWriter::write_trailer()
+{
+  uint8_t actl[8];
+  put_u32_be(actl, frames_);
+  put_u32_be(actl + 4, opts_.plays);
+  if(!patch_chunk(actl_offset_, "acTL", actl, sizeof(actl)))
+    return BL_ERROR_INVALID_STATE;
+  return write_chunk("IEND", nullptr, 0);
+}
+
+// ----------------------------------------------------------------------------
+// GIF
+// ----------------------------------------------------------------------------
+
+GifWriter::GifWriter(FileSink* file, const AnimOptions& opts) : AnimWriter(file, opts)
+{
+  hist_.assign(1 << 15, 0);
+  sums_.assign(3 << 15, 0);
+  lut_.resize(1 << 15);
+}
+
+// Delays are in centiseconds. Frame boundaries are rounded from exact times
+// so the rounding does not drift; most viewers show delays below 2 as 10,
+// so shorter frames are stretched to 2 (50 fps at most).
+uint16_t GifWriter::delay(uint64_t start, uint32_t ticks) const
+{
+  const double scale = 100.0 / opts_.fps;
+  const double cs = std::round(double(start + ticks) * scale) - std::round(double(start) * scale);
+  return uint16_t(std::clamp(cs, 2.0, 65535.0));
+}
+
+BLResult GifWriter::write_header()
+{
+  if(width_ > 65535 || height_ > 65535)
+    return BL_ERROR_INVALID_VALUE;
+
+  uint8_t head[13] = {'G', 'I', 'F', '8', '9', 'a'};
+  put_u16_le(head + 6, uint16_t(width_));
+  put_u16_le(head + 8, uint16_t(height_));
+  head[10] = 0; // no global color table
+  head[11] = 0; // background index
+  head[12] = 0; // no aspect ratio
+  if(!sink(head, sizeof(head)))
+    return BL_ERROR_INVALID_STATE;
+
+  // The NETSCAPE2.0 extension counts repeats after the first play.
+  if(opts_.plays != 1) {
+    uint8_t loop[19] = {0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0',
+                        0x03, 0x01};
+    put_u16_le(loop + 16, uint16_t(opts_.plays == 0 ? 0 : std::min(opts_.plays - 1, 65535u)));
+    loop[18] = 0;
+    if(!sink(loop, sizeof(loop)))
+      return BL_ERROR_INVALID_STATE;
+  }
+  return BL_SUCCESS;
+}
+
+// Bounding box of the pixels in `box` that turn transparent in `img` where
+// the pending frame is opaque. GIF frames only draw over what is shown, so
+// those pixels can only be cleared by disposing of the pending frame.
+bool GifWriter::cleared_box(const BLImageData& img, const BLBoxI& box, BLBoxI* cleared) const
+{
+  int x0 = box.x1, x1 = box.x0, y0 = box.y1, y1 = box.y0;
+  for(int y = box.y0; y < box.y1; y++) {
+    const uint32_t* row = pixel_row(img, y);
+    const uint32_t* prev = prev_.data() + size_t(y) * width_;
+    for(int x = box.x0; x < box.x1; x++) {
+      if((row[x] >> 24) < 128 && (prev[x] >> 24) >= 128) {
+        x0 = std::min(x0, x);
+        x1 = std::max(x1, x + 1);
+        y0 = std::min(y0, y);
+        y1 = std::max(y1, y + 1);
+      }
+    }
+  }
+
+  if(x0 >= x1)
+    return false;
+  *cleared = BLBoxI(x0, y0, x1, y1);
+  return true;
+}
+
+int GifWriter::quantize(const BLImageData& img, const BLBoxI& box, uint8_t palette[768],
+                        int* transparent)
+{
+  const int w = box.x1 - box.x0;
+  const int h = box.y1 - box.y0;
+  const size_t count = size_t(w) * h;
+
+  rgba_.resize(count * 4);
+  for(int y = 0; y < h; y++)
+    unpremultiply_row(reinterpret_cast<const uint8_t*>(pixel_row(img, box.y0 + y) + box.x0),
+                      BLFormat(img.format), w, false, rgba_.data() + size_t(y) * w * 4);
+
+  // Histogram of the opaque pixels at 5 bits per channel.
+  bins_.clear();
+  bool has_transparent = false;
+  for(size_t i = 0; i < count; i++) {
+    const uint8_t* p = rgba_.data() + i * 4;
+    if(p[3] < 128) {
+      has_transparent = true;
+      continue;
+    }
+    const uint16_t key = uint16_t((p[0] >> 3) << 10 | (p[1] >> 3) << 5 | (p[2] >> 3));
+    if(hist_[key]++ == 0)
+      bins_.push_back(key);
+    sums_[key * 3] += p[0];
+    sums_[key * 3 + 1] += p[1];
+    sums_[key * 3 + 2] += p[2];
+  }
+
+  // Median cut: split the box with the most pixels times extent at the
+  // pixel median of its widest channel until the palette is full.
+  const size_t max_colors = has_transparent ? 255 : 256;
+  std::vector<CutBox> boxes;
+  if(!bins_.empty()) {
+    boxes.push_back({0, bins_.size(), 0, 0, 0});
+    measure(bins_, hist_, &boxes.back());
+  }
+
+  while(boxes.size() < max_colors) {
+    CutBox* best = nullptr;
+    for(auto& b : boxes) {
+      if(b.range > 0 && (!best || b.pixels * b.range > best->pixels * best->range))
+        best = &b;
+    }
+    if(!best)
+      break;
+
+    const int shift = best->shift;
+    std::sort(bins_.begin() + best->begin, bins_.begin() + best->end,
+              [shift](uint16_t a, uint16_t b) { return ((a >> shift) & 31) < ((b >> shift) & 31); });
+
+    uint64_t acc = 0;
+    size_t split = best->begin;
+    while(split < best->end - 1 && acc + hist_[bins_[split]] <= best->pixels / 2)
+      acc += hist_[bins_[split++]];
+    split = std::clamp(split, best->begin + 1, best->end - 1);
+
+    CutBox upper{split, best->end, 0, 0, 0};
+    best->end = split;
+    measure(bins_, hist_, best);
+    measure(bins_, hist_, &upper);
+    boxes.push_back(upper);
+  }
+
+  // Each box becomes the average of its pixels; its bins map to it.
+  for(size_t i = 0; i < boxes.size(); i++) {
+    uint64_t sum[3] = {0, 0, 0};
+    for(size_t j = boxes[i].begin; j < boxes[i].end; j++) {
+      const uint16_t key = bins_[j];
+      for(int c = 0; c < 3; c++)
+        sum[c] += sums_[key * 3 + c];
+      lut_[key] = uint8_t(i);
+    }
+    for(int c = 0; c < 3; c++)
+      palette[i * 3 + c] = uint8_t((sum[c] + boxes[i].pixels / 2) / boxes[i].pixels);
+  }
+
+  const int colors = int(boxes.size());
+  *transparent = has_transparent ? colors : -1;
+
+  indices_.resize(count);
+  for(size_t i = 0; i < count; i++) {
+    const uint8_t* p = rgba_.data() + i * 4;
+    indices_[i] = p[3] < 128
+                      ? uint8_t(colors)
+                      : lut_[(p[0] >> 3) << 10 | (p[1] >> 3) << 5 | (p[2] >> 3)];
+  }
+
+  for(uint16_t key : bins_) {
+    hist_[key] = 0;
+    sums_[key * 3] = sums_[key * 3 + 1] = sums_[key * 3 + 2] = 0;
+  }
+  return colors;
+}
+
+BLResult GifWriter::write_pending(const BLBoxI& box, bool dispose)
+{
+  // prev_ holds the pending frame until the next one is taken over.
+  BLImageData pending{};
+  pending.pixel_data = prev_.data();
+  pending.stride = intptr_t(width_) * 4;
+  pending.size.w = width_;
+  pending.size.h = height_;
+  pending.format = format_;
+
+  uint8_t palette[768] = {};
+  int transparent;
+  quantize(pending, box, palette, &transparent);
+
+  // Graphic control extension: keep the frame (disposal 1) or, when the
+  // next frame clears pixels, restore its area to the transparent
+  // background (disposal 2).
+  uint8_t gce[8] = {0x21, 0xF9, 0x04};
+  gce[3] = uint8_t((dispose ? 2 : 1) << 2 | (transparent >= 0 ? 1 : 0));
+  put_u16_le(gce + 4, delay(pending_start_, pending_ticks_));
+  gce[6] = uint8_t(transparent >= 0 ? transparent : 0);
+  gce[7] = 0;
+
+  // Image descriptor with a full 256-entry local color table.
+  uint8_t desc[10] = {0x2C};
+  put_u16_le(desc + 1, uint16_t(box.x0));
+  put_u16_le(desc + 3, uint16_t(box.y0));
+  put_u16_le(desc + 5, uint16_t(box.x1 - box.x0));
+  put_u16_le(desc + 7, uint16_t(box.y1 - box.y0));
+  desc[9] = 0x80 | 7;
+
+  lzw_.clear();
+  lzw_.push_back(8); // minimum code size
+  LzwEncoder(&lzw_).encode(indices_.data(), indices_.size());
+  lzw_.push_back(0); // block terminator
+
+  if(!sink(gce, sizeof(gce)) || !sink(desc, sizeof(desc)) || !sink(palette, sizeof(palette)) ||
+     !sink(lzw_.data(), lzw_.size()))
+    return BL_ERROR_INVALID_STATE;
+  return BL_SUCCESS;
+}
+
+// Frames are written one behind: whether a frame must be disposed of, and
+// over which area, depends on the frame that follows it.
+BLResult GifWriter::write_frame(const BLImageData& img, const BLBoxI& changed)
+{
+  BLBoxI box = changed;
+  if(frames_ > 0) {
+    BLBoxI cleared;
+    const bool dispose = cleared_box(img, box, &cleared);
+    BLBoxI area = pending_box_;
+    if(dispose) {
+      area = BLBoxI(std::min(area.x0, cleared.x0), std::min(area.y0, cleared.y0),
+                    std::max(area.x1, cleared.x1), std::max(area.y1, cleared.y1));
+      // Everything disposed of has to be drawn again.
+      box = BLBoxI(std::min(box.x0, area.x0), std::min(box.y0, area.y0),
+                   std::max(box.x1, area.x1), std::max(box.y1, area.y1));
+    }
+
+    BLResult r = write_pending(area, dispose);
+    if(r != BL_SUCCESS)
+      return r;
+  }
+
+  format_ = img.format;
+  pending_box_ = box;
+  pending_start_ = ticks_;
+  pending_ticks_ = 1;
+  return BL_SUCCESS;
+}
+
+bool GifWriter::extend_frame(uint32_t ticks)
+{
+  const double scale = 100.0 / opts_.fps;
+  if(std::round(double(pending_start_ + ticks) * scale) -
+         std::round(double(pending_start_) * scale) >
+     65535.0)
+    return false;
+
+  pending_ticks_ = ticks;
+  return true;
+}
+
+BLResult GifWriter::write_trailer()
+{
+  BLResult r = write_pending(pending_box_, false);
+  if(r != BL_SUCCESS)
+    return r;
+
+  const uint8_t trailer = 0x3B;
+  return sink(&trailer, 1) ? BL_SUCCESS : BL_ERROR_INVALID_STATE;
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "file_sink.h"
+#include "png_encoder.h"
+
+#include <blend2d/blend2d.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// Animation encoders
+// ----------------------------------------------------------------------------
+// Append PRGB32/XRGB32 frames of one size to an animated PNG or GIF as they
+// are produced, so a sequence never exists as separate files. Every frame
+// after the first is compared with the one before and only the bounding box
+// of the changed pixels is encoded; a frame identical to the previous one
+// just extends how long that one is shown.
+
+struct AnimOptions {
+  double fps = 30.0;
+  unsigned plays = 0; // times the animation is played, 0 loops forever
+  PngOptions png;     // APNG frame compression
+};
+
+class AnimWriter {
+public:
+  AnimWriter(FileSink* file, const AnimOptions& opts);
+  virtual ~AnimWriter() = default;
+
+  AnimWriter(const AnimWriter&) = delete;
+  AnimWriter& operator=(const AnimWriter&) = delete;
+
+  // Appends a frame. The first one fixes the size of the animation; later
+  // frames must match it.
+  BLResult add_frame(const BLImage& img);
+
+  // Completes the file contents. The sink still has to be closed.
+  BLResult finish();
+
+  int width() const noexcept
+  {
+    return width_;
+  }
+
+  int height() const noexcept
+  {
+    return height_;
+  }
+
+  // Frames passed to add_frame, identical ones included.
+  uint64_t frame_count() const noexcept
+  {
+    return ticks_;
+  }
+
+protected:
+  virtual BLResult write_header() = 0;
+
+  // Encodes the `box` area of `img`. `prev_` still holds the previous frame.
+  virtual BLResult write_frame(const BLImageData& img, const BLBoxI& box) = 0;
+
+  // Makes the last written frame last `ticks` frame intervals. Returns false
+  // if the format cannot express that delay.
+  virtual bool extend_frame(uint32_t ticks) = 0;
+
+  virtual BLResult write_trailer() = 0;
+
+  bool sink(const uint8_t* data, size_t size)
+  {
+    return file_->write(data, size);
+  }
+
+  FileSink* file_;
+  AnimOptions opts_;
+  int width_ = 0;
+  int height_ = 0;
+  uint64_t ticks_ = 0;         // frames added so far
+  uint32_t frames_ = 0;        // frames actually written
+  std::vector<uint32_t> prev_; // previous frame, tightly packed
+
+private:
+  bool diff_box(const BLImageData& img, BLBoxI* box) const;
+
+  uint32_t frame_ticks_ = 0; // intervals the last written frame spans
+  bool failed_ = false;
+};
+
+// APNG with one fcTL/fdAT frame per change. Frames replace their area
+// (APNG_BLEND_OP_SOURCE), so transparency is kept exactly.
+class ApngWriter final : public AnimWriter {
+public:
+  ApngWriter(FileSink* file, const AnimOptions& opts);
+
+protected:
+  BLResult write_header() override;
+  BLResult write_frame(const BLImageData& img, const BLBoxI& box) override;
+  bool extend_frame(uint32_t ticks) override;
+  BLResult write_trailer() override;
+
+private:
+  BLResult write_chunk(const char type[4], const uint8_t* data, size_t size);
+  bool patch_chunk(uint64_t offset, const char type[4], const uint8_t* data, size_t size);
+
+  uint16_t delay_num_ = 1;
+  uint16_t delay_den_ = 30;
+  uint32_t sequence_ = 0;
+  uint64_t actl_offset_ = 0;
+  uint64_t fctl_offset_ = 0;
+  uint8_t fctl_[26] = {};
+  std::vector<uint8_t> fdat_;
+};
+
+// GIF89a with a median-cut palette of up to 255 colors per frame and no
+// dithering. Alpha becomes a 1-bit mask (transparent below 128).
+class GifWriter final : public AnimWriter {
+public:
+  GifWriter(FileSink* file, const AnimOptions& opts);
+
+protected:
+  BLResult write_header() override;
+  BLResult write_frame(const BLImageData& img, const BLBoxI& box) override;
+  bool extend_frame(uint32_t ticks) override;
+  BLResult write_trailer() override;
+
+private:
+  uint16_t delay(uint64_t start, uint32_t ticks) const;
+  bool cleared_box(const BLImageData& img, const BLBoxI& box, BLBoxI* cleared) const;
+  BLResult write_pending(const BLBoxI& box, bool dispose);
+  // Fills indices_ for the `box` area and returns the palette size. Sets
+  // `transparent` to the index of transparent pixels, or -1 if there are none.
+  int quantize(const BLImageData& img, const BLBoxI& box, uint8_t palette[768], int* transparent);
+
+  // The last frame, held back until the next one shows how to dispose of it.
+  BLBoxI pending_box_{};
+  uint64_t pending_start_ = 0;
+  uint32_t pending_ticks_ = 0;
+  uint32_t format_ = BL_FORMAT_PRGB32;
+
+  std::vector<uint8_t> rgba_;
+  std::vector<uint8_t> indices_;
+  std::vector<uint8_t> lzw_;
+  // 15-bit color histogram for the palette.
+  std::vector<uint32_t> hist_;
+  std::vector<uint64_t> sums_;
+  std::vector<uint16_t> bins_;
+  std::vector<uint8_t> lut_;
+};
@@ -0,0 +1,90 @@
+#include "base64.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BLENDEND_BASE64_SSSE3 1
+#include <immintrin.h>
+#endif
+
+namespace {
+  const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  // Encodes whole 3-byte groups and the padded tail.
+  void encode_scalar(const uint8_t* src, size_t size, char* dst)
+  {
+    size_t i = 0;
+    for(; i + 3 <= size; i += 3, dst += 4) {
+      uint32_t v = (uint32_t(src[i]) << 16) | (uint32_t(src[i + 1]) << 8) | src[i + 2];
+      dst[0] = kAlphabet[(v >> 18) & 0x3F];
+      dst[1] = kAlphabet[(v >> 12) & 0x3F];
+      dst[2] = kAlphabet[(v >> 6) & 0x3F];
+      dst[3] = kAlphabet[v & 0x3F];
+    }
+
+    size_t rest = size - i;
+    if(rest) {
+      uint32_t v = uint32_t(src[i]) << 16;
+      if(rest == 2)
+        v |= uint32_t(src[i + 1]) << 8;
+      dst[0] = kAlphabet[(v >> 18) & 0x3F];
+      dst[1] = kAlphabet[(v >> 12) & 0x3F];
+      dst[2] = rest == 2 ? kAlphabet[(v >> 6) & 0x3F] : '=';
+      dst[3] = '=';
+    }
+  }
+
+#ifdef BLENDEND_BASE64_SSSE3
+  // 12 input bytes -> 16 output chars per step (W. Mula's pshufb method):
+  // spread each 3-byte group over a 32-bit lane, split the lane into four
+  // 6-bit indices with two multiplies, then map indices to ASCII by adding
+  // a per-range offset looked up with pshufb.
+  __attribute__((target("ssse3"))) size_t encode_ssse3(const uint8_t* src,
+                                                       size_t size,
+                                                       char* dst)
+  {
+    const __m128i shuf = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+    size_t i = 0;
+    // Each load reads 16 bytes but consumes 12.
+    for(; i + 16 <= size; i += 12, dst += 16) {
+      __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      in = _mm_shuffle_epi8(in, shuf);
+
+      const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+      const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+      const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+      const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+      const __m128i idx = _mm_or_si128(t1, t3);
+
+      __m128i range = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+      const __m128i lower = _mm_cmpgt_epi8(_mm_set1_epi8(26), idx);
+      range = _mm_or_si128(range, _mm_and_si128(lower, _mm_set1_epi8(13)));
+
+      const __m128i out = _mm_add_epi8(_mm_shuffle_epi8(offsets, range), idx);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), out);
+    }
+    return i;
+  }
+
+  bool has_ssse3()
+  {
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+  }
+#endif
+} // namespace
+
+void base64_encode(const uint8_t* src, size_t size, char* dst)
+{
+#ifdef BLENDEND_BASE64_SSSE3
+  if(has_ssse3()) {
+    size_t done = encode_ssse3(src, size, dst);
+    src += done;
+    dst += done / 3 * 4;
+    size -= done;
+  }
+#endif
+  encode_scalar(src, size, dst);
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Length of the padded base64 encoding of `size` bytes.
+inline size_t base64_encoded_size(size_t size)
+{
+  return (size + 2) / 3 * 4;
+}
+
+// Encodes `size` bytes from `src` as padded standard base64 into `dst`, which
+// must hold base64_encoded_size(size) bytes. Uses SSSE3 when the CPU has it.
+void base64_encode(const uint8_t* src, size_t size, char* dst);
@@ -0,0 +1,138 @@
+#include "file_sink.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+  constexpr size_t kBufferSize = 256 * 1024;
+}
+
+FileSink::~FileSink()
+{
+  if(fd_ >= 0)
+    discard();
+}
+
+bool FileSink::open(const std::string& path)
+{
+  if(fd_ >= 0)
+    return false;
+
+  // Written next to the target so the final rename stays on one file system.
+  std::string tmp = path + ".tmp.XXXXXX";
+  fd_ = ::mkstemp(tmp.data());
+  if(fd_ < 0)
+    return false;
+  ::fcntl(fd_, F_SETFD, FD_CLOEXEC);
+
+  // mkstemp creates the file as 0600; give it the mode an existing target
+  // has, or the usual 0644.
+  struct stat st;
+  ::fchmod(fd_, ::stat(path.c_str(), &st) == 0 ? st.st_mode & 07777 : 0644);
+
+  path_ = path;
+  tmp_path_ = std::move(tmp);
+  buffer_.resize(kBufferSize);
+  used_ = 0;
+  flushed_ = 0;
+  return true;
+}
+
+bool FileSink::write(const uint8_t* data, size_t size)
+{
+  if(fd_ < 0)
+    return false;
+
+  if(used_ + size > buffer_.size()) {
+    if(!flush())
+      return false;
+    // Large pieces (whole IDAT chunks) skip the buffer.
+    if(size >= buffer_.size())
+      return write_all(data, size);
+  }
+
+  memcpy(buffer_.data() + used_, data, size);
+  used_ += size;
+  return true;
+}
+
+bool FileSink::patch(uint64_t offset, const uint8_t* data, size_t size)
+{
+  if(fd_ < 0 || offset + size > position())
+    return false;
+
+  // Still in the buffer: patch in place.
+  if(offset >= flushed_) {
+    memcpy(buffer_.data() + (offset - flushed_), data, size);
+    return true;
+  }
+
+  if(!flush())
+    return false;
+  while(size > 0) {
+    ssize_t n = ::pwrite(fd_, data, size, off_t(offset));
+    if(n < 0) {
+      if(errno == EINTR)
+        continue;
+      return false;
+    }
+    data += n;
+    size -= size_t(n);
+    offset += uint64_t(n);
+  }
+  return true;
+}
+
+bool FileSink::close(bool sync)
+{
+  if(fd_ < 0)
+    return false;
+
+  if(!flush() || (sync && ::fsync(fd_) != 0)) {
+    discard();
+    return false;
+  }
+
+  int fd = fd_;
+  fd_ = -1;
+  if(::close(fd) != 0 || ::rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+    ::unlink(tmp_path_.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool FileSink::flush()
+{
+  bool ok = write_all(buffer_.data(), used_);
+  used_ = 0;
+  return ok;
+}
+
+bool FileSink::write_all(const uint8_t* data, size_t size)
+{
+  flushed_ += size;
+  while(size > 0) {
+    ssize_t n = ::write(fd_, data, size);
+    if(n < 0) {
+      if(errno == EINTR)
+        continue;
+      return false;
+    }
+    data += n;
+    size -= size_t(n);
+  }
+  return true;
+}
+
+void FileSink::discard()
+{
+  ::close(fd_);
+  fd_ = -1;
+  ::unlink(tmp_path_.c_str());
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Buffered output file for the streaming encoders. Encoders hand over small
+// pieces (chunk headers, CRCs, single rows); they are collected into large
+// writes on the descriptor. The data goes to a temporary file next to the
+// target, which a successful close() renames over it; a sink destroyed
+// without one removes the temporary file and leaves the target untouched.
+class FileSink {
+public:
+  FileSink() = default;
+  ~FileSink();
+
+  FileSink(const FileSink&) = delete;
+  FileSink& operator=(const FileSink&) = delete;
+
+  // Creates the temporary file `path`.tmp.XXXXXX for `path`.
+  bool open(const std::string& path);
+
+  bool write(const uint8_t* data, size_t size);
+
+  // Bytes written so far, buffered ones included.
+  uint64_t position() const noexcept
+  {
+    return flushed_ + used_;
+  }
+
+  // Overwrites `size` already written bytes at `offset`, for headers whose
+  // contents are only known at the end (frame counts, delays).
+  bool patch(uint64_t offset, const uint8_t* data, size_t size);
+
+  // Flushes the buffer, fsyncs when `sync` is set, closes the file and
+  // renames it to the target path.
+  bool close(bool sync);
+
+private:
+  bool flush();
+  bool write_all(const uint8_t* data, size_t size);
+  void discard();
+
+  int fd_ = -1;
+  std::string path_;
+  std::string tmp_path_;
+  std::vector<uint8_t> buffer_;
+  size_t used_ = 0;
+  uint64_t flushed_ = 0;
+};
@@ -3,6 +3,8 @@
 #include "../nif/nif_resource.h"
 #include "../nif/nif_util.h"
 
+#include <cstring>
+
 // image_read_from_data(Binary) -> {:ok, Image} | {:error, reason}
 ERL_NIF_TERM image_read_from_data(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
 {
@@ -30,6 +32,143 @@ ERL_NIF_TERM image_read_from_data(ErlNifEnv* env, int argc, const ERL_NIF_TERM a
   return make_result_ok(env, res_term);
 }
 
+// Destroy callback for images wrapping an Erlang binary: the binary lives in
+// a private env that is freed together with the image data.
+static void free_binary_env(void*, void*, void* user_data)
+{
+  enif_free_env(static_cast<ErlNifEnv*>(user_data));
+}
+
+// Premultiplies one row of straight-alpha 8-bit RGBA (swap_rb) or BGRA
+// pixels into native PRGB32.
+static void premultiply_row(const uint8_t* src, uint32_t* dst, int w, bool swap_rb)
+{
+  const int ri = swap_rb ? 0 : 2;
+  const int bi = swap_rb ? 2 : 0;
+
+  for(int x = 0; x < w; x++, src += 4) {
+    uint32_t a = src[3];
+    uint32_t r = src[ri];
+    uint32_t g = src[1];
+    uint32_t b = src[bi];
+
+    if(a != 255) {
+      // c * a / 255, rounded, without a division.
+      auto mul = [a](uint32_t c) {
+        uint32_t t = c * a + 128;
+        return (t + (t >> 8)) >> 8;
+      };
+      r = mul(r);
+      g = mul(g);
+      b = mul(b);
+    }
+
+    dst[x] = (a << 24) | (r << 16) | (g << 8) | b;
+  }
+}
+
+// image_from_raw(Binary, W, H, Format, Stride) -> {:ok, Image} | {:error, reason}
+//
+// Format:
+//   :prgb32 | :xrgb32 | :a8 -> Blend2D's native layouts; the binary is wrapped
+//                              without copying and kept alive by the image
+//   :bgra | :rgba           -> straight alpha bytes; converted to PRGB32 in a
+//                              single premultiplying pass into a new buffer
+// Stride 0 means tightly packed rows.
+ERL_NIF_TERM image_from_raw(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 5) {
+    return enif_make_badarg(env);
+  }
+
+  ErlNifBinary bin;
+  if(!enif_inspect_binary(env, argv[0], &bin)) {
+    return make_result_error(env, "image_from_raw_invalid_data");
+  }
+
+  int w, h;
+  long stride;
+  if(!enif_get_int(env, argv[1], &w) || !enif_get_int(env, argv[2], &h) || w <= 0 || h <= 0 ||
+     !enif_get_long(env, argv[4], &stride) || stride < 0) {
+    return make_result_error(env, "image_from_raw_invalid_size");
+  }
+
+  char fmt[16];
+  if(!enif_get_atom(env, argv[3], fmt, sizeof(fmt), ERL_NIF_UTF8)) {
+    return make_result_error(env, "image_from_raw_invalid_format");
+  }
+
+  BLFormat format = BL_FORMAT_PRGB32;
+  bool convert = false;
+  bool swap_rb = false;
+  if(strcmp(fmt, "prgb32") == 0) format = BL_FORMAT_PRGB32;
+  else if(strcmp(fmt, "xrgb32") == 0) format = BL_FORMAT_XRGB32;
+  else if(strcmp(fmt, "a8") == 0) format = BL_FORMAT_A8;
+  else if(strcmp(fmt, "bgra") == 0) convert = true;
+  else if(strcmp(fmt, "rgba") == 0) { convert = true; swap_rb = true; }
+  else return make_result_error(env, "image_from_raw_invalid_format");
+
+  const size_t bpp = format == BL_FORMAT_A8 ? 1 : 4;
+  const size_t row_bytes = static_cast<size_t>(w) * bpp;
+  if(stride == 0)
+    stride = static_cast<long>(row_bytes);
+
+  if(static_cast<size_t>(stride) < row_bytes ||
+     bin.size < static_cast<size_t>(stride) * static_cast<size_t>(h - 1) + row_bytes) {
+    return make_result_error(env, "image_from_raw_invalid_stride");
+  }
+
+  auto img = NifResource<Image>::alloc();
+  if(img == nullptr) {
+    return make_result_error(env, "image_from_raw_alloc_failed");
+  }
+
+  const bool aligned = (reinterpret_cast<uintptr_t>(bin.data) % bpp) == 0 && stride % bpp == 0;
+  BLResult r = BL_SUCCESS;
+
+  if(!convert && aligned) {
+    // Move a reference to the binary into a private env; refc binaries are
+    // shared, not copied. The image frees the env once nothing uses it.
+    ErlNifEnv* keep_env = enif_alloc_env();
+    ErlNifBinary kept;
+    if(!keep_env || !enif_inspect_binary(keep_env, enif_make_copy(keep_env, argv[0]), &kept)) {
+      if(keep_env)
+        enif_free_env(keep_env);
+      enif_release_resource(img);
+      return make_result_error(env, "image_from_raw_alloc_failed");
+    }
+
+    r = img->value.create_from_data(w, h, format, kept.data, stride, BL_DATA_ACCESS_READ,
+                                    free_binary_env, keep_env);
+    if(r != BL_SUCCESS)
+      enif_free_env(keep_env);
+  }
+  else {
+    BLImageData dst{};
+    r = img->value.create(w, h, format);
+    if(r == BL_SUCCESS)
+      r = img->value.make_mutable(&dst);
+
+    if(r == BL_SUCCESS) {
+      for(int y = 0; y < h; y++) {
+        const uint8_t* src_row = bin.data + static_cast<size_t>(y) * static_cast<size_t>(stride);
+        uint8_t* dst_row = static_cast<uint8_t*>(dst.pixel_data) + static_cast<size_t>(y) * dst.stride;
+        if(convert)
+          premultiply_row(src_row, reinterpret_cast<uint32_t*>(dst_row), w, swap_rb);
+        else
+          memcpy(dst_row, src_row, row_bytes);
+      }
+    }
+  }
+
+  if(r != BL_SUCCESS) {
+    enif_release_resource(img);
+    return make_result_error(env, "image_from_raw_failed");
+  }
+
+  return make_result_ok(env, NifResource<Image>::make(env, img));
+}
+
 // image_read_mask_from_data(Binary [, ChannelAtom]) -> {:ok, ImageA8} | {:error, reason}
 ERL_NIF_TERM image_read_mask_from_data(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
 {
@@ -332,3 +471,62 @@ ERL_NIF_TERM image_blur(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
   out->value = work;
   return make_result_ok(env, NifResource<Image>::make(env, out));
 }
+
+static const char* format_name(uint32_t format)
+{
+  switch(format) {
+    case BL_FORMAT_PRGB32:
+      return "prgb32";
+    case BL_FORMAT_XRGB32:
+      return "xrgb32";
+    case BL_FORMAT_A8:
+      return "a8";
+    default:
+      return "none";
+  }
+}
+
+ERL_NIF_TERM make_pixel_view(ErlNifEnv* env, void* owner, const BLImage& img)
+{
+  BLImageData data{};
+  if(img.is_empty() || img.get_data(&data) != BL_SUCCESS || data.stride <= 0) {
+    return 0;
+  }
+
+  size_t size = static_cast<size_t>(data.stride) * static_cast<size_t>(data.size.h);
+  ERL_NIF_TERM bin = enif_make_resource_binary(env, owner, data.pixel_data, size);
+
+  ERL_NIF_TERM map = enif_make_new_map(env);
+
+  auto put = [&](const char* key, ERL_NIF_TERM value) {
+    enif_make_map_put(env, map, enif_make_atom(env, key), value, &map);
+  };
+
+  put("data", bin);
+  put("width", enif_make_int(env, data.size.w));
+  put("height", enif_make_int(env, data.size.h));
+  put("stride", enif_make_long(env, static_cast<long>(data.stride)));
+  put("format", enif_make_atom(env, format_name(data.format)));
+
+  return map;
+}
+
+// image_pixels(Image) -> {:ok, %{data, width, height, stride, format}} | {:error, reason}
+ERL_NIF_TERM image_pixels(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 1) {
+    return enif_make_badarg(env);
+  }
+
+  auto img = NifResource<Image>::get(env, argv[0]);
+  if(img == nullptr) {
+    return make_result_error(env, "invalid_image_resource");
+  }
+
+  ERL_NIF_TERM view = make_pixel_view(env, img, img->value);
+  if(!view) {
+    return make_result_error(env, "image_pixels_failed");
+  }
+
+  return make_result_ok(env, view);
+}
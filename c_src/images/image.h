@@ -1,6 +1,7 @@
 #pragma once
 #include <blend2d/blend2d.h>
 #include <cstdint>
+#include <erl_nif.h>
 
 struct Image {
   BLImage value;
@@ -11,3 +12,9 @@ struct Image {
   }
 };
 
+
+// Returns %{data: binary, width:, height:, stride:, format:} describing the
+// pixels of `img` without copying them. `data` is a resource binary over the
+// image buffer that keeps `owner` (the resource holding `img`) alive. Returns
+// 0 if the image is empty or its data cannot be accessed.
+ERL_NIF_TERM make_pixel_view(ErlNifEnv* env, void* owner, const BLImage& img);
@@ -0,0 +1,59 @@
+#include "pixel_convert.h"
+
+#include <array>
+#include <cstring>
+
+namespace {
+  // Exact x / a for x < 2^16 and a < 256 as (x * m[a]) >> 24.
+  const std::array<uint32_t, 256>& unpremultiply_table()
+  {
+    static const std::array<uint32_t, 256> table = [] {
+      std::array<uint32_t, 256> t{};
+      for(uint32_t a = 1; a < 256; a++)
+        t[a] = ((1u << 24) + a - 1) / a;
+      return t;
+    }();
+    return table;
+  }
+} // namespace
+
+void unpremultiply_row(const uint8_t* src, BLFormat format, int width, bool opaque, uint8_t* dst)
+{
+  const auto& inv = unpremultiply_table();
+
+  for(int x = 0; x < width; x++, src += 4) {
+    uint32_t p;
+    memcpy(&p, src, 4);
+
+    uint32_t a = format == BL_FORMAT_XRGB32 ? 255u : p >> 24;
+    uint32_t r = (p >> 16) & 0xFF;
+    uint32_t g = (p >> 8) & 0xFF;
+    uint32_t b = p & 0xFF;
+
+    if(opaque) {
+      dst[0] = uint8_t(r);
+      dst[1] = uint8_t(g);
+      dst[2] = uint8_t(b);
+      dst += 3;
+      continue;
+    }
+
+    if(a != 255) {
+      if(a == 0) {
+        r = g = b = 0;
+      }
+      else {
+        const uint32_t m = inv[a];
+        r = ((r * 255 + a / 2) * m) >> 24;
+        g = ((g * 255 + a / 2) * m) >> 24;
+        b = ((b * 255 + a / 2) * m) >> 24;
+      }
+    }
+
+    dst[0] = uint8_t(r);
+    dst[1] = uint8_t(g);
+    dst[2] = uint8_t(b);
+    dst[3] = uint8_t(a);
+    dst += 4;
+  }
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <blend2d/blend2d.h>
+#include <cstdint>
+
+// Converts `width` PRGB32/XRGB32 pixels to 8-bit RGBA with straight alpha,
+// or to RGB when `opaque` is set (premultiplied values are the pixel
+// composited over black). Shared by the streaming encoders.
+void unpremultiply_row(const uint8_t* src, BLFormat format, int width, bool opaque, uint8_t* dst);
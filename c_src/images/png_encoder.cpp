@@ -0,0 +1,492 @@
+#include "png_encoder.h"
+#include "pixel_convert.h"
+#include "../nif/parallel.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace {
+  constexpr size_t kIdatSize = 64 * 1024;
+  // Stripes below this many rows cost more in stream overhead and lost
+  // cross-stripe matches than they gain from parallelism.
+  constexpr int kMinStripeRows = 64;
+  // PNG caps a chunk at 2^31 - 1 bytes.
+  constexpr size_t kMaxChunkSize = 0x7FFFFFFFu;
+
+  void put_u32_be(uint8_t* p, uint32_t v)
+  {
+    p[0] = uint8_t(v >> 24);
+    p[1] = uint8_t(v >> 16);
+    p[2] = uint8_t(v >> 8);
+    p[3] = uint8_t(v);
+  }
+
+  inline uint8_t paeth(uint8_t a, uint8_t b, uint8_t c)
+  {
+    int p = int(a) + int(b) - int(c);
+    int pa = std::abs(p - int(a));
+    int pb = std::abs(p - int(b));
+    int pc = std::abs(p - int(c));
+    if(pa <= pb && pa <= pc)
+      return a;
+    return pb <= pc ? b : c;
+  }
+
+  // Writes the filter byte followed by the filtered row to `out`.
+  void filter_row(PngFilter filter,
+                  const uint8_t* cur,
+                  const uint8_t* prev,
+                  size_t len,
+                  size_t bpp,
+                  uint8_t* out)
+  {
+    *out++ = uint8_t(filter);
+
+    switch(filter) {
+      case PNG_FILTER_SUB:
+        memcpy(out, cur, bpp);
+        for(size_t i = bpp; i < len; i++)
+          out[i] = uint8_t(cur[i] - cur[i - bpp]);
+        break;
+      case PNG_FILTER_UP:
+        for(size_t i = 0; i < len; i++)
+          out[i] = uint8_t(cur[i] - prev[i]);
+        break;
+      case PNG_FILTER_AVERAGE:
+        for(size_t i = 0; i < bpp; i++)
+          out[i] = uint8_t(cur[i] - (prev[i] >> 1));
+        for(size_t i = bpp; i < len; i++)
+          out[i] = uint8_t(cur[i] - ((uint32_t(cur[i - bpp]) + prev[i]) >> 1));
+        break;
+      case PNG_FILTER_PAETH:
+        for(size_t i = 0; i < bpp; i++)
+          out[i] = uint8_t(cur[i] - prev[i]);
+        for(size_t i = bpp; i < len; i++)
+          out[i] = uint8_t(cur[i] - paeth(cur[i - bpp], prev[i], prev[i - bpp]));
+        break;
+      default:
+        memcpy(out, cur, len);
+        break;
+    }
+  }
+
+  // Sum of absolute values of the filtered bytes taken as signed.
+  uint64_t filter_cost(const uint8_t* row, size_t len)
+  {
+    uint64_t sum = 0;
+    for(size_t i = 0; i < len; i++)
+      sum += uint64_t(std::abs(int(int8_t(row[i]))));
+    return sum;
+  }
+
+  int effective_level(const PngOptions& opts)
+  {
+    return opts.fast ? 1 : opts.compression;
+  }
+
+  int effective_strategy(const PngOptions& opts)
+  {
+    return opts.fast ? Z_RLE : Z_DEFAULT_STRATEGY;
+  }
+
+  // One horizontal stripe compressed as a raw deflate stream. All but the
+  // last stripe end with a sync flush, so they stop on a byte boundary
+  // without a final block and can be concatenated. The whole stream is
+  // deflated into one buffer, so its bound has to fit zlib's uInt counters.
+  struct Stripe {
+    int y0 = 0;
+    int y1 = 0;
+    std::vector<uint8_t> data;
+    uLong adler = 1;
+    size_t raw_size = 0;
+    bool ok = false;
+  };
+
+  // Whether a stripe of `raw_size` filtered bytes can be deflated in one go.
+  bool stripe_fits(size_t raw_size)
+  {
+    return raw_size <= UINT_MAX && compressBound(uLong(raw_size)) <= UINT_MAX - 16;
+  }
+
+  // Runs on a worker thread, so allocation failures leave stripe->ok false
+  // rather than unwind out of it.
+  void encode_stripe(const BLImageData& img, const PngOptions& opts, bool last, Stripe* stripe)
+  {
+    const uint8_t* pixels = static_cast<const uint8_t*>(img.pixel_data);
+    const BLFormat format = BLFormat(img.format);
+
+    z_stream zs{};
+    if(deflateInit2(&zs, effective_level(opts), Z_DEFLATED, -15, 8, effective_strategy(opts)) !=
+       Z_OK)
+      return;
+
+    bool ok = false;
+    try {
+      PngRowFilter rows(img.size.w, opts);
+      if(stripe->y0 > 0)
+        rows.prime(pixels + intptr_t(stripe->y0 - 1) * img.stride, format);
+
+      stripe->raw_size = rows.row_size() * size_t(stripe->y1 - stripe->y0);
+      ok = stripe_fits(stripe->raw_size);
+      if(ok) {
+        stripe->data.resize(deflateBound(&zs, uLong(stripe->raw_size)) + 16);
+        zs.next_out = stripe->data.data();
+        zs.avail_out = uInt(stripe->data.size());
+      }
+
+      for(int y = stripe->y0; y < stripe->y1 && ok; y++) {
+        const uint8_t* row = rows.next(pixels + intptr_t(y) * img.stride, format);
+        stripe->adler = adler32(stripe->adler, row, uInt(rows.row_size()));
+
+        zs.next_in = const_cast<Bytef*>(row);
+        zs.avail_in = uInt(rows.row_size());
+        ok = deflate(&zs, Z_NO_FLUSH) == Z_OK && zs.avail_in == 0;
+      }
+
+      if(ok) {
+        int ret = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+        ok = last ? ret == Z_STREAM_END : ret == Z_OK;
+      }
+
+      stripe->data.resize(stripe->data.size() - zs.avail_out);
+    }
+    catch(const std::bad_alloc&) {
+      ok = false;
+    }
+
+    stripe->ok = ok;
+    deflateEnd(&zs);
+  }
+
+  BLResult encode_parallel(const BLImageData& img,
+                           const PngOptions& opts,
+                           unsigned count,
+                           const PngSink& sink)
+  {
+    std::vector<Stripe> stripes(count);
+    const int h = img.size.h;
+    for(unsigned i = 0; i < count; i++) {
+      stripes[i].y0 = int(int64_t(h) * i / count);
+      stripes[i].y1 = int(int64_t(h) * (i + 1) / count);
+    }
+
+    parallel_for(count, [&](size_t i) {
+      encode_stripe(img, opts, i == count - 1, &stripes[i]);
+    });
+
+    for(const auto& stripe : stripes) {
+      if(!stripe.ok)
+        return BL_ERROR_OUT_OF_MEMORY;
+    }
+
+    BLResult r = png_write_header(sink, img.size.w, h, opts.opaque);
+    if(r != BL_SUCCESS)
+      return r;
+
+    // zlib header (CM=8, 32K window, level hint in FLEVEL) ...
+    const int level = effective_level(opts);
+    const uint8_t flevel = level <= 1 ? 0x01 : level <= 5 ? 0x5E : level == 6 ? 0x9C : 0xDA;
+    stripes.front().data.insert(stripes.front().data.begin(), {0x78, flevel});
+
+    // ... and the Adler-32 of all filtered rows, combined per stripe.
+    uLong adler = stripes.front().adler;
+    for(unsigned i = 1; i < count; i++)
+      adler = adler32_combine(adler, stripes[i].adler, z_off_t(stripes[i].raw_size));
+    uint8_t trailer[4];
+    put_u32_be(trailer, uint32_t(adler));
+    stripes.back().data.insert(stripes.back().data.end(), trailer, trailer + 4);
+
+    // Same chunk size as PngWriter, which also keeps every chunk far below
+    // PNG's 2^31 - 1 byte limit.
+    for(const auto& stripe : stripes) {
+      for(size_t at = 0; at < stripe.data.size(); at += kIdatSize) {
+        const size_t size = std::min(kIdatSize, stripe.data.size() - at);
+        r = png_write_chunk(sink, "IDAT", stripe.data.data() + at, size);
+        if(r != BL_SUCCESS)
+          return r;
+      }
+    }
+
+    return png_write_chunk(sink, "IEND", nullptr, 0);
+  }
+} // namespace
+
+BLResult png_write_chunk(const PngSink& sink, const char type[4], const uint8_t* data, size_t size)
+{
+  if(size > kMaxChunkSize)
+    return BL_ERROR_INVALID_VALUE;
+
+  uint8_t head[8];
+  put_u32_be(head, uint32_t(size));
+  memcpy(head + 4, type, 4);
+
+  uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(type), 4);
+  if(size)
+    crc = crc32(crc, data, uInt(size));
+
+  uint8_t tail[4];
+  put_u32_be(tail, uint32_t(crc));
+
+  if(!sink(head, 8) || (size && !sink(data, size)) || !sink(tail, 4))
+    return BL_ERROR_INVALID_STATE;
+  return BL_SUCCESS;
+}
+
+BLResult png_write_header(const PngSink& sink, int width, int height, bool opaque)
+{
+  static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  if(!sink(signature, sizeof(signature)))
+    return BL_ERROR_INVALID_STATE;
+
+  uint8_t ihdr[13];
+  put_u32_be(ihdr, uint32_t(width));
+  put_u32_be(ihdr + 4, uint32_t(height));
+  ihdr[8] = 8;                 // bit depth
+  ihdr[9] = opaque ? 2 : 6;    // RGB / RGBA
+  ihdr[10] = 0;                // deflate
+  ihdr[11] = 0;                // adaptive filtering
+  ihdr[12] = 0;                // no interlace
+  return png_write_chunk(sink, "IHDR", ihdr, sizeof(ihdr));
+}
+
+BLResult png_deflate_rows(const uint8_t* pixels,
+                          intptr_t stride,
+                          int width,
+                          int height,
+                          BLFormat format,
+                          const PngOptions& opts,
+                          const PngSink& emit)
+{
+  const int level = effective_level(opts);
+  if(width <= 0 || height <= 0 || level < 0 || level > 9)
+    return BL_ERROR_INVALID_VALUE;
+  if(format != BL_FORMAT_PRGB32 && format != BL_FORMAT_XRGB32)
+    return BL_ERROR_INVALID_VALUE;
+
+  z_stream zs{};
+  if(deflateInit2(&zs, level, Z_DEFLATED, 15, 8, effective_strategy(opts)) != Z_OK)
+    return BL_ERROR_OUT_OF_MEMORY;
+
+  PngRowFilter rows(width, opts);
+  std::vector<uint8_t> out(kIdatSize);
+  zs.next_out = out.data();
+  zs.avail_out = uInt(out.size());
+
+  // Deflates the pending input with `flush`, handing over every full buffer.
+  auto step = [&](int flush) {
+    for(;;) {
+      int ret = deflate(&zs, flush);
+      if(ret == Z_STREAM_ERROR)
+        return BL_ERROR_INVALID_STATE;
+
+      if(zs.avail_out == 0) {
+        if(!emit(out.data(), out.size()))
+          return BL_ERROR_INVALID_STATE;
+        zs.next_out = out.data();
+        zs.avail_out = uInt(out.size());
+        continue;
+      }
+
+      if(flush == Z_FINISH ? ret == Z_STREAM_END : zs.avail_in == 0)
+        return BL_SUCCESS;
+    }
+  };
+
+  BLResult r = BL_SUCCESS;
+  for(int y = 0; y < height && r == BL_SUCCESS; y++) {
+    zs.next_in = const_cast<Bytef*>(rows.next(pixels + intptr_t(y) * stride, format));
+    zs.avail_in = uInt(rows.row_size());
+    r = step(Z_NO_FLUSH);
+  }
+
+  if(r == BL_SUCCESS) {
+    zs.next_in = nullptr;
+    zs.avail_in = 0;
+    r = step(Z_FINISH);
+  }
+
+  const size_t pending = out.size() - zs.avail_out;
+  if(r == BL_SUCCESS && pending && !emit(out.data(), pending))
+    r = BL_ERROR_INVALID_STATE;
+
+  deflateEnd(&zs);
+  return r;
+}
+
+PngRowFilter::PngRowFilter(int width, const PngOptions& opts)
+    : width_(width),
+      bpp_(opts.opaque ? 3 : 4),
+      filter_(opts.fast ? PNG_FILTER_SUB : opts.filter),
+      opaque_(opts.opaque)
+{
+  const size_t row_bytes = size_t(width_) * bpp_;
+  cur_.resize(row_bytes);
+  prev_.assign(row_bytes, 0);
+  // One slot for the chosen row, one for the adaptive candidate.
+  filtered_.resize(2 * (row_bytes + 1));
+}
+
+void PngRowFilter::prime(const uint8_t* src_row, BLFormat format)
+{
+  unpremultiply_row(src_row, format, width_, opaque_, prev_.data());
+}
+
+const uint8_t* PngRowFilter::next(const uint8_t* src_row, BLFormat format)
+{
+  const size_t len = cur_.size();
+  uint8_t* best = filtered_.data();
+  uint8_t* trial = best + len + 1;
+
+  unpremultiply_row(src_row, format, width_, opaque_, cur_.data());
+
+  if(filter_ == PNG_FILTER_ADAPTIVE) {
+    uint64_t best_cost = UINT64_MAX;
+    for(int f = PNG_FILTER_NONE; f <= PNG_FILTER_PAETH; f++) {
+      filter_row(PngFilter(f), cur_.data(), prev_.data(), len, bpp_, trial);
+      uint64_t cost = filter_cost(trial + 1, len);
+      if(cost < best_cost) {
+        best_cost = cost;
+        std::swap(best, trial);
+      }
+    }
+  }
+  else {
+    filter_row(filter_, cur_.data(), prev_.data(), len, bpp_, best);
+  }
+
+  cur_.swap(prev_);
+  return best;
+}
+
+PngWriter::PngWriter(int width, int height, const PngOptions& opts, PngSink sink)
+    : width_(width), height_(height), opts_(opts), sink_(std::move(sink)), rows_(width, opts)
+{
+  idat_.resize(kIdatSize);
+}
+
+PngWriter::~PngWriter()
+{
+  if(zs_ready_)
+    deflateEnd(&zs_);
+}
+
+BLResult PngWriter::begin()
+{
+  if(width_ <= 0 || height_ <= 0)
+    return BL_ERROR_INVALID_VALUE;
+
+  int level = effective_level(opts_);
+  if(level < 0 || level > 9)
+    return BL_ERROR_INVALID_VALUE;
+
+  if(deflateInit2(&zs_, level, Z_DEFLATED, 15, 8, effective_strategy(opts_)) != Z_OK)
+    return BL_ERROR_OUT_OF_MEMORY;
+  zs_ready_ = true;
+  zs_.next_out = idat_.data();
+  zs_.avail_out = uInt(idat_.size());
+
+  return png_write_header(sink_, width_, height_, opts_.opaque);
+}
+
+BLResult PngWriter::deflate_step(int flush)
+{
+  for(;;) {
+    int ret = deflate(&zs_, flush);
+    if(ret == Z_STREAM_ERROR)
+      return BL_ERROR_INVALID_STATE;
+
+    if(zs_.avail_out == 0) {
+      BLResult r = png_write_chunk(sink_, "IDAT", idat_.data(), idat_.size());
+      if(r != BL_SUCCESS)
+        return r;
+      zs_.next_out = idat_.data();
+      zs_.avail_out = uInt(idat_.size());
+      continue;
+    }
+
+    if(flush == Z_FINISH ? ret == Z_STREAM_END : zs_.avail_in == 0)
+      return BL_SUCCESS;
+  }
+}
+
+BLResult PngWriter::write_rows(const uint8_t* pixels, intptr_t stride, int count, BLFormat format)
+{
+  if(!zs_ready_ || count < 0 || rows_written_ + count > height_)
+    return BL_ERROR_INVALID_STATE;
+  if(format != BL_FORMAT_PRGB32 && format != BL_FORMAT_XRGB32)
+    return BL_ERROR_INVALID_VALUE;
+
+  for(int y = 0; y < count; y++) {
+    zs_.next_in = const_cast<Bytef*>(rows_.next(pixels + intptr_t(y) * stride, format));
+    zs_.avail_in = uInt(rows_.row_size());
+    BLResult r = deflate_step(Z_NO_FLUSH);
+    if(r != BL_SUCCESS)
+      return r;
+  }
+
+  rows_written_ += count;
+  return BL_SUCCESS;
+}
+
+BLResult PngWriter::finish()
+{
+  if(!zs_ready_ || rows_written_ != height_)
+    return BL_ERROR_INVALID_STATE;
+
+  zs_.next_in = nullptr;
+  zs_.avail_in = 0;
+  BLResult r = deflate_step(Z_FINISH);
+  if(r != BL_SUCCESS)
+    return r;
+
+  size_t pending = idat_.size() - zs_.avail_out;
+  if(pending) {
+    r = png_write_chunk(sink_, "IDAT", idat_.data(), pending);
+    if(r != BL_SUCCESS)
+      return r;
+  }
+
+  deflateEnd(&zs_);
+  zs_ready_ = false;
+  return png_write_chunk(sink_, "IEND", nullptr, 0);
+}
+
+BLResult png_encode(const BLImage& img, const PngOptions& opts, const PngSink& sink)
+{
+  BLImageData data{};
+  BLResult r = img.get_data(&data);
+  if(r != BL_SUCCESS)
+    return r;
+
+  const int level = effective_level(opts);
+  if(data.size.w <= 0 || data.size.h <= 0 || level < 0 || level > 9)
+    return BL_ERROR_INVALID_VALUE;
+  if(data.format != BL_FORMAT_PRGB32 && data.format != BL_FORMAT_XRGB32)
+    return BL_ERROR_INVALID_VALUE;
+
+  // Stripes too large to deflate into one buffer go through the streaming
+  // writer instead.
+  unsigned stripes = std::min<unsigned>(opts.threads, unsigned(data.size.h / kMinStripeRows));
+  const size_t row_size = size_t(data.size.w) * (opts.opaque ? 3 : 4) + 1;
+  if(stripes > 1 && stripe_fits(row_size * ((size_t(data.size.h) + stripes - 1) / stripes))) {
+    try {
+      return encode_parallel(data, opts, stripes, sink);
+    }
+    catch(const std::bad_alloc&) {
+      return BL_ERROR_OUT_OF_MEMORY;
+    }
+  }
+
+  PngWriter writer(data.size.w, data.size.h, opts, sink);
+  r = writer.begin();
+  if(r == BL_SUCCESS)
+    r = writer.write_rows(static_cast<const uint8_t*>(data.pixel_data), data.stride, data.size.h,
+                          BLFormat(data.format));
+  if(r == BL_SUCCESS)
+    r = writer.finish();
+  return r;
+}
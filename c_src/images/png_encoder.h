@@ -0,0 +1,123 @@
+#pragma once
+#include <blend2d/blend2d.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <zlib.h>
+
+// ----------------------------------------------------------------------------
+// PNG encoder
+// ----------------------------------------------------------------------------
+// A small zlib-based PNG writer used where Blend2D's codec offers no knobs:
+// compression level, row filter, a speed-first mode and RGB output. Pixels
+// come in as PRGB32/XRGB32 rows and are written as 8-bit RGBA (straight
+// alpha) or, in opaque mode, 8-bit RGB.
+
+enum PngFilter : uint8_t {
+  PNG_FILTER_NONE = 0,
+  PNG_FILTER_SUB = 1,
+  PNG_FILTER_UP = 2,
+  PNG_FILTER_AVERAGE = 3,
+  PNG_FILTER_PAETH = 4,
+  // Per row, picks the filter with the smallest sum of absolute differences
+  // (the libpng heuristic).
+  PNG_FILTER_ADAPTIVE = 5
+};
+
+struct PngOptions {
+  int compression = 6;                  // zlib level, 0..9
+  PngFilter filter = PNG_FILTER_ADAPTIVE;
+  bool fast = false;                    // level 1, Z_RLE and the SUB filter
+  bool opaque = false;                  // RGB output; alpha is dropped
+  unsigned threads = 1;                 // stripes deflated in parallel by png_encode
+};
+
+// Receives encoded bytes in order. Returning false aborts the encode.
+using PngSink = std::function<bool(const uint8_t* data, size_t size)>;
+
+// Writes one chunk: length, type, `data` and its CRC.
+BLResult png_write_chunk(const PngSink& sink, const char type[4], const uint8_t* data, size_t size);
+
+// Writes the signature and an 8-bit RGBA (or, if `opaque`, RGB) IHDR.
+BLResult png_write_header(const PngSink& sink, int width, int height, bool opaque);
+
+// Filters and deflates `height` rows of `width` PRGB32/XRGB32 pixels into a
+// complete zlib stream, handed to `emit` in pieces of at most 64 KB. For
+// callers that wrap the image data in chunks of their own (APNG frames).
+BLResult png_deflate_rows(const uint8_t* pixels,
+                          intptr_t stride,
+                          int width,
+                          int height,
+                          BLFormat format,
+                          const PngOptions& opts,
+                          const PngSink& emit);
+
+// Converts and filters rows for one PNG scanline sequence. Each row depends
+// only on itself and the row above it, which is what lets stripes of an
+// image be filtered independently.
+class PngRowFilter {
+public:
+  PngRowFilter(int width, const PngOptions& opts);
+
+  // Size of a filtered row, filter byte included.
+  size_t row_size() const noexcept
+  {
+    return cur_.size() + 1;
+  }
+
+  // Sets the row above the next one (the first row of a stripe below the top).
+  void prime(const uint8_t* src_row, BLFormat format);
+
+  // Converts and filters one PRGB32/XRGB32 row. The result stays valid until
+  // the next call.
+  const uint8_t* next(const uint8_t* src_row, BLFormat format);
+
+private:
+  int width_;
+  size_t bpp_;
+  PngFilter filter_;
+  bool opaque_;
+  std::vector<uint8_t> cur_;
+  std::vector<uint8_t> prev_;
+  std::vector<uint8_t> filtered_;
+};
+
+// Streams a PNG of a known size row by row, so callers can produce pixels
+// incrementally and never hold the whole encoded file.
+class PngWriter {
+public:
+  PngWriter(int width, int height, const PngOptions& opts, PngSink sink);
+  ~PngWriter();
+
+  PngWriter(const PngWriter&) = delete;
+  PngWriter& operator=(const PngWriter&) = delete;
+
+  // Writes the signature and header. Must be called once, before any rows.
+  BLResult begin();
+
+  // Writes `count` rows of `format` pixels (PRGB32 or XRGB32), top to bottom.
+  BLResult write_rows(const uint8_t* pixels, intptr_t stride, int count, BLFormat format);
+
+  // Flushes the compressed stream and writes IEND. Requires all rows.
+  BLResult finish();
+
+private:
+  BLResult deflate_step(int flush);
+
+  int width_;
+  int height_;
+  int rows_written_ = 0;
+  PngOptions opts_;
+  PngSink sink_;
+  PngRowFilter rows_;
+  std::vector<uint8_t> idat_;
+
+  z_stream zs_{};
+  bool zs_ready_ = false;
+};
+
+// Encodes a whole image with `opts`. With opts.threads > 1 and enough rows,
+// horizontal stripes are filtered and deflated on separate threads as
+// independent raw deflate streams, then stitched into a single zlib stream.
+BLResult png_encode(const BLImage& img, const PngOptions& opts, const PngSink& sink);
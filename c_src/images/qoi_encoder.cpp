@@ -0,0 +1,182 @@
+#include "qoi_encoder.h"
+#include "pixel_convert.h"
+
+#include <cstring>
+#include <utility>
+
+namespace {
+  constexpr size_t kOutSize = 64 * 1024;
+
+  constexpr uint8_t QOI_OP_INDEX = 0x00;
+  constexpr uint8_t QOI_OP_DIFF = 0x40;
+  constexpr uint8_t QOI_OP_LUMA = 0x80;
+  constexpr uint8_t QOI_OP_RUN = 0xC0;
+  constexpr uint8_t QOI_OP_RGB = 0xFE;
+  constexpr uint8_t QOI_OP_RGBA = 0xFF;
+
+  // Longest run a single QOI_OP_RUN can encode.
+  constexpr int kMaxRun = 62;
+
+  inline uint32_t hash(uint32_t px)
+  {
+    uint32_t r = px & 0xFF, g = (px >> 8) & 0xFF, b = (px >> 16) & 0xFF, a = px >> 24;
+    return (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+  }
+
+  void put_u32_be(uint8_t* p, uint32_t v)
+  {
+    p[0] = uint8_t(v >> 24);
+    p[1] = uint8_t(v >> 16);
+    p[2] = uint8_t(v >> 8);
+    p[3] = uint8_t(v);
+  }
+} // namespace
+
+QoiWriter::QoiWriter(int width, int height, QoiSink sink)
+    : width_(width), height_(height), sink_(std::move(sink))
+{
+}
+
+// Makes room for `reserve` more bytes, handing the buffer to the sink when full.
+BLResult QoiWriter::emit(size_t reserve)
+{
+  if(used_ + reserve <= out_.size())
+    return BL_SUCCESS;
+  if(!sink_(out_.data(), used_))
+    return BL_ERROR_INVALID_STATE;
+  used_ = 0;
+  return BL_SUCCESS;
+}
+
+void QoiWriter::end_run()
+{
+  out_[used_++] = uint8_t(QOI_OP_RUN | (run_ - 1));
+  run_ = 0;
+}
+
+BLResult QoiWriter::begin()
+{
+  if(width_ <= 0 || height_ <= 0 || started_)
+    return BL_ERROR_INVALID_VALUE;
+
+  started_ = true;
+  rgba_.resize(size_t(width_) * 4);
+  out_.resize(kOutSize);
+
+  uint8_t* h = out_.data();
+  memcpy(h, "qoif", 4);
+  put_u32_be(h + 4, uint32_t(width_));
+  put_u32_be(h + 8, uint32_t(height_));
+  h[12] = 4; // channels
+  h[13] = 0; // sRGB with linear alpha
+  used_ = 14;
+  return BL_SUCCESS;
+}
+
+BLResult QoiWriter::write_rows(const uint8_t* pixels, intptr_t stride, int count, BLFormat format)
+{
+  if(!started_ || count < 0 || rows_written_ + count > height_)
+    return BL_ERROR_INVALID_STATE;
+  if(format != BL_FORMAT_PRGB32 && format != BL_FORMAT_XRGB32)
+    return BL_ERROR_INVALID_VALUE;
+
+  for(int y = 0; y < count; y++) {
+    unpremultiply_row(pixels + intptr_t(y) * stride, format, width_, false, rgba_.data());
+
+    for(int x = 0; x < width_; x++) {
+      const uint8_t* c = rgba_.data() + size_t(x) * 4;
+      const uint32_t px = c[0] | uint32_t(c[1]) << 8 | uint32_t(c[2]) << 16 | uint32_t(c[3]) << 24;
+
+      // Room for a pending run plus the largest op.
+      BLResult r = emit(6);
+      if(r != BL_SUCCESS)
+        return r;
+
+      if(px == prev_) {
+        if(++run_ == kMaxRun)
+          end_run();
+        continue;
+      }
+
+      if(run_ > 0)
+        end_run();
+
+      const uint32_t slot = hash(px);
+      if(index_[slot] == px) {
+        out_[used_++] = uint8_t(QOI_OP_INDEX | slot);
+      }
+      else {
+        index_[slot] = px;
+
+        if(c[3] == uint8_t(prev_ >> 24)) {
+          const int8_t vr = int8_t(c[0] - uint8_t(prev_));
+          const int8_t vg = int8_t(c[1] - uint8_t(prev_ >> 8));
+          const int8_t vb = int8_t(c[2] - uint8_t(prev_ >> 16));
+          const int8_t vg_r = int8_t(vr - vg);
+          const int8_t vg_b = int8_t(vb - vg);
+
+          if(vr >= -2 && vr <= 1 && vg >= -2 && vg <= 1 && vb >= -2 && vb <= 1) {
+            out_[used_++] = uint8_t(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+          }
+          else if(vg_r >= -8 && vg_r <= 7 && vg >= -32 && vg <= 31 && vg_b >= -8 && vg_b <= 7) {
+            out_[used_++] = uint8_t(QOI_OP_LUMA | (vg + 32));
+            out_[used_++] = uint8_t((vg_r + 8) << 4 | (vg_b + 8));
+          }
+          else {
+            out_[used_++] = QOI_OP_RGB;
+            memcpy(&out_[used_], c, 3);
+            used_ += 3;
+          }
+        }
+        else {
+          out_[used_++] = QOI_OP_RGBA;
+          memcpy(&out_[used_], c, 4);
+          used_ += 4;
+        }
+      }
+
+      prev_ = px;
+    }
+  }
+
+  rows_written_ += count;
+  return BL_SUCCESS;
+}
+
+BLResult QoiWriter::finish()
+{
+  if(!started_ || rows_written_ != height_)
+    return BL_ERROR_INVALID_STATE;
+
+  static const uint8_t end_marker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+  BLResult r = emit(1 + sizeof(end_marker));
+  if(r != BL_SUCCESS)
+    return r;
+  if(run_ > 0)
+    end_run();
+  memcpy(out_.data() + used_, end_marker, sizeof(end_marker));
+  used_ += sizeof(end_marker);
+
+  if(!sink_(out_.data(), used_))
+    return BL_ERROR_INVALID_STATE;
+  used_ = 0;
+  return BL_SUCCESS;
+}
+
+BLResult qoi_encode(const BLImage& img, const QoiSink& sink)
+{
+  BLImageData data{};
+  BLResult r = img.get_data(&data);
+  if(r != BL_SUCCESS)
+    return r;
+
+  QoiWriter writer(data.size.w, data.size.h, sink);
+  r = writer.begin();
+  if(r == BL_SUCCESS)
+    r = writer.write_rows(static_cast<const uint8_t*>(data.pixel_data), data.stride, data.size.h,
+                          BLFormat(data.format));
+  if(r == BL_SUCCESS)
+    r = writer.finish();
+  return r;
+}
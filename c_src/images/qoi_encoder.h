@@ -0,0 +1,51 @@
+#pragma once
+#include <blend2d/blend2d.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// QOI encoder
+// ----------------------------------------------------------------------------
+// Streaming counterpart of Blend2D's QOI codec, which can only encode into
+// one in-memory array. Pixels come in as PRGB32/XRGB32 rows and are written
+// as 4-channel sRGB QOI with straight alpha, like Blend2D's output.
+
+// Receives encoded bytes in order. Returning false aborts the encode.
+using QoiSink = std::function<bool(const uint8_t* data, size_t size)>;
+
+class QoiWriter {
+public:
+  QoiWriter(int width, int height, QoiSink sink);
+
+  // Writes the header. Must be called once, before any rows.
+  BLResult begin();
+
+  // Writes `count` rows of `format` pixels (PRGB32 or XRGB32), top to bottom.
+  BLResult write_rows(const uint8_t* pixels, intptr_t stride, int count, BLFormat format);
+
+  // Closes the last run and writes the end marker. Requires all rows.
+  BLResult finish();
+
+private:
+  BLResult emit(size_t reserve);
+  void end_run();
+
+  int width_;
+  int height_;
+  int rows_written_ = 0;
+  QoiSink sink_;
+  bool started_ = false;
+
+  uint32_t index_[64] = {};
+  uint32_t prev_ = 0xFF000000u; // RGBA packed as r | g << 8 | b << 16 | a << 24
+  int run_ = 0;
+
+  std::vector<uint8_t> rgba_;
+  std::vector<uint8_t> out_;
+  size_t used_ = 0;
+};
+
+// Encodes a whole image.
+BLResult qoi_encode(const BLImage& img, const QoiSink& sink);
@@ -0,0 +1,111 @@
+#include "surface_pool.h"
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace {
+  constexpr int kMinBucket = 64;
+  // Larger surfaces are allocated and freed directly.
+  constexpr int kMaxBucket = 8192;
+  constexpr size_t kMaxPooledBytes = 64 * 1024 * 1024;
+
+  int bucket_size(int n)
+  {
+    int size = kMinBucket;
+    while(size < n)
+      size *= 2;
+    return size;
+  }
+
+  size_t image_bytes(const BLImage& img)
+  {
+    BLSizeI sz = img.size();
+    return size_t(sz.w) * size_t(sz.h) * (img.format() == BL_FORMAT_A8 ? 1 : 4);
+  }
+
+  struct Pool {
+    std::mutex mutex;
+    std::vector<BLImage> free;
+    size_t bytes = 0;
+  };
+
+  Pool& pool()
+  {
+    static Pool instance;
+    return instance;
+  }
+} // namespace
+
+PooledSurface::PooledSurface(BLFormat format, int width, int height)
+    : width_(width), height_(height)
+{
+  if(width <= 0 || height <= 0)
+    return;
+
+  const bool pooled = width <= kMaxBucket && height <= kMaxBucket;
+  const int bw = pooled ? bucket_size(width) : width;
+  const int bh = pooled ? bucket_size(height) : height;
+
+  if(pooled) {
+    Pool& p = pool();
+    std::lock_guard<std::mutex> guard(p.mutex);
+    // Newest first; the list stays ordered from least to most recently used.
+    for(size_t i = p.free.size(); i-- > 0;) {
+      BLImage& img = p.free[i];
+      BLSizeI sz = img.size();
+      if(img.format() == format && sz.w == bw && sz.h == bh) {
+        p.bytes -= image_bytes(img);
+        image_ = std::move(img);
+        p.free.erase(p.free.begin() + ptrdiff_t(i));
+        return;
+      }
+    }
+  }
+
+  if(image_.create(bw, bh, format) != BL_SUCCESS)
+    image_.reset();
+}
+
+PooledSurface::~PooledSurface()
+{
+  release();
+}
+
+PooledSurface::PooledSurface(PooledSurface&& other) noexcept
+    : image_(std::move(other.image_)), width_(other.width_), height_(other.height_)
+{
+}
+
+PooledSurface& PooledSurface::operator=(PooledSurface&& other) noexcept
+{
+  if(this != &other) {
+    release();
+    image_ = std::move(other.image_);
+    width_ = other.width_;
+    height_ = other.height_;
+  }
+  return *this;
+}
+
+void PooledSurface::release()
+{
+  if(image_.is_empty())
+    return;
+
+  BLSizeI sz = image_.size();
+  const size_t bytes = image_bytes(image_);
+  // A surface that could never fit must not evict the pooled ones first.
+  if(sz.w <= kMaxBucket && sz.h <= kMaxBucket && bytes <= kMaxPooledBytes) {
+    Pool& p = pool();
+    std::lock_guard<std::mutex> guard(p.mutex);
+    // Make room by dropping the surfaces that have been idle longest.
+    while(!p.free.empty() && p.bytes + bytes > kMaxPooledBytes) {
+      p.bytes -= image_bytes(p.free.front());
+      p.free.erase(p.free.begin());
+    }
+    p.bytes += bytes;
+    p.free.push_back(std::move(image_));
+  }
+  image_.reset();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <blend2d/blend2d.h>
+
+// ----------------------------------------------------------------------------
+// Scratch surface pool
+// ----------------------------------------------------------------------------
+// Offscreen images for layers and effects are taken from a process-wide
+// pool instead of being allocated per call. Sizes are rounded up to power-of-
+// two buckets (at least 64 pixels per side) so a surface serves any request
+// that fits its bucket; users draw into the top-left width x height area
+// only. Released surfaces are kept while the pool stays under its memory
+// budget and handed to whichever thread or process asks next.
+
+class PooledSurface {
+public:
+  PooledSurface() = default;
+  // Takes a surface of `format` (PRGB32 or A8) at least `width` x `height`
+  // from the pool, or allocates one. Check valid() for allocation failure.
+  PooledSurface(BLFormat format, int width, int height);
+  ~PooledSurface();
+
+  PooledSurface(PooledSurface&& other) noexcept;
+  PooledSurface& operator=(PooledSurface&& other) noexcept;
+  PooledSurface(const PooledSurface&) = delete;
+  PooledSurface& operator=(const PooledSurface&) = delete;
+
+  bool valid() const noexcept
+  {
+    return !image_.is_empty();
+  }
+
+  BLImage& image() noexcept
+  {
+    return image_;
+  }
+
+  // The requested size; the image itself may be larger.
+  int width() const noexcept
+  {
+    return width_;
+  }
+
+  int height() const noexcept
+  {
+    return height_;
+  }
+
+private:
+  void release();
+
+  BLImage image_;
+  int width_ = 0;
+  int height_ = 0;
+};
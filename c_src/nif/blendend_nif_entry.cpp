@@ -1,6 +1,9 @@
 #include "../canvas/canvas.h"
+#include "../canvas/display_list.h"
 #include "../geometries/matrix2d.h"
 #include "../geometries/path.h"
+#include "../geometries/path_index.h"
+#include "../images/anim.h"
 #include "../images/image.h"
 #include "../nif/nif_templates.h"
 #include "../styles/styles.h"
@@ -42,8 +45,14 @@ static int load(ErlNifEnv* env, void**, ERL_NIF_TERM)
     return -1;
   if(NifResource<Image>::open(env, "Elixir.Blendend.Native", "ImageRes") < 0)
     return -1;
+  if(NifResource<Anim>::open(env, "Elixir.Blendend.Native", "AnimRes") < 0)
+    return -1;
+  if(NifResource<DisplayList>::open(env, "Elixir.Blendend.Native", "DisplayListRes") < 0)
+    return -1;
   if(NifResource<Path>::open(env, "Elixir.Blendend.Native", "Path") < 0)
     return -1;
+  if(NifResource<PathIndex>::open(env, "Elixir.Blendend.Native", "PathIndexRes") < 0)
+    return -1;
   if(NifResource<Matrix2D>::open(env, "Elixir.Blendend.Native", "Matrix2D") < 0)
     return -1;
   if(NifResource<Color>::open(env, "Elixir.Blendend.Native", "ColorRes") < 0)
@@ -52,6 +61,8 @@ static int load(ErlNifEnv* env, void**, ERL_NIF_TERM)
     return -1;
   if(NifResource<Pattern>::open(env, "Elixir.Blendend.Native", "PatternRes") < 0)
     return -1;
+  if(NifResource<CompiledStyle>::open(env, "Elixir.Blendend.Native", "StyleRes") < 0)
+    return -1;
   if(NifResource<FontFace>::open(env, "Elixir.Blendend.Native", "FontfaceRes") < 0)
     return -1;
   if(NifResource<Font>::open(env, "Elixir.Blendend.Native", "FontRes") < 0)
@@ -66,6 +77,11 @@ static int load(ErlNifEnv* env, void**, ERL_NIF_TERM)
 
 // Canvas
 MAKE_TERM(canvas_new)
+MAKE_TERM(canvas_clone)
+MAKE_TERM(canvas_to_image)
+MAKE_TERM(canvas_begin_layer)
+MAKE_TERM(canvas_end_layer)
+MAKE_TERM(canvas_fill_instances)
 MAKE_TERM(canvas_size)
 MAKE_TERM(canvas_save_state)
 MAKE_TERM(canvas_restore_state)
@@ -91,10 +107,19 @@ MAKE_TERM(canvas_blit_image)
 MAKE_TERM(canvas_blit_image_scaled)
 MAKE_TERM(canvas_fill_mask)
 MAKE_TERM(canvas_blur_path)
+MAKE_TERM(canvas_exec)
+MAKE_TERM(tiled_render)
+MAKE_TERM(display_list_new)
+MAKE_TERM(display_list_bounds)
+MAKE_TERM(display_list_replay)
 
 MAKE_TERM(canvas_to_png_base64)
 MAKE_TERM(canvas_to_png)
 MAKE_TERM(canvas_to_qoi)
+MAKE_TERM(canvas_write_file)
+MAKE_TERM(canvas_dirty_rects)
+MAKE_TERM(canvas_export_delta)
+MAKE_TERM(canvas_pixels)
 
 // Image
 MAKE_TERM(image_size)
@@ -104,6 +129,13 @@ MAKE_TERM(image_read_mask_from_data)
 MAKE_TERM(image_get_pixel)
 MAKE_TERM(image_decode_qoi)
 MAKE_TERM(image_blur)
+MAKE_TERM(image_pixels)
+MAKE_TERM(image_from_raw)
+
+// Animation
+MAKE_TERM(anim_new)
+MAKE_TERM(anim_add_frame)
+MAKE_TERM(anim_finish)
 
 // Styles
 MAKE_TERM(color)
@@ -119,6 +151,8 @@ MAKE_TERM(pattern_create)
 MAKE_TERM(pattern_set_extend)
 MAKE_TERM(pattern_set_transform)
 MAKE_TERM(pattern_reset_transform)
+MAKE_TERM(style_compile)
+MAKE_TERM(style_mode)
 
 //Geometries
 MAKE_TERM(path_new)
@@ -156,10 +190,21 @@ MAKE_TERM(path_translate)
 MAKE_TERM(path_transform)
 MAKE_TERM(path_close)
 MAKE_TERM(path_hit_test)
+MAKE_TERM(path_hit_test_many)
+MAKE_TERM(path_to_binary)
+MAKE_TERM(path_from_binary)
+MAKE_TERM(path_from_svg_d)
+MAKE_TERM(path_index_new)
+MAKE_TERM(path_index_insert)
+MAKE_TERM(path_index_size)
+MAKE_TERM(path_index_query_point)
+MAKE_TERM(path_index_query_rect)
 MAKE_TERM(path_clear)
 MAKE_TERM(path_equals)
 MAKE_TERM(path_fit_to)
 MAKE_TERM(path_flatten)
+MAKE_TERM(path_simplify)
+MAKE_TERM(plot_decimate_m4)
 
 MAKE_TERM(canvas_fill_path)
 MAKE_TERM(canvas_stroke_path)
@@ -244,6 +289,7 @@ MAKE_DRAW_GLYPH(stroke_glyph_run)
 #define NIF_LIST(X) \
   /* Canvas */ \
   X(canvas_new, 2, 0) \
+  X(canvas_new, 3, 0) \
   X(canvas_size, 1, 0) \
   X(canvas_clear, 2, 0) \
   /* Canvas state */ \
@@ -270,9 +316,27 @@ MAKE_DRAW_GLYPH(stroke_glyph_run)
   X(canvas_set_fill_rule, 2, 0) \
   X(canvas_blit_image, 4, 0) \
   X(canvas_blit_image_scaled, 6, 0) \
+  X(canvas_exec, 2, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(canvas_exec, 3, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(tiled_render, 9, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(display_list_new, 2, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(display_list_bounds, 1, 0) \
+  X(display_list_replay, 4, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
   X(canvas_to_png_base64, 1, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(canvas_to_png_base64, 2, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
   X(canvas_to_png, 1, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(canvas_to_png, 2, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
   X(canvas_to_qoi, 1, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(canvas_write_file, 5, ERL_NIF_DIRTY_JOB_IO_BOUND) \
+  X(canvas_dirty_rects, 1, 0) \
+  X(canvas_export_delta, 3, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(canvas_pixels, 1, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(canvas_clone, 1, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(canvas_to_image, 2, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(canvas_begin_layer, 6, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(canvas_end_layer, 1, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(canvas_end_layer, 2, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(canvas_fill_instances, 7, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
   X(canvas_fill_path, 2, 0) \
   X(canvas_fill_path, 3, 0) \
   X(canvas_stroke_path, 2, 0) \
@@ -284,6 +348,12 @@ MAKE_DRAW_GLYPH(stroke_glyph_run)
   X(image_get_pixel, 3, 0) \
   X(image_decode_qoi, 1, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
   X(image_blur, 2, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(image_pixels, 1, 0) \
+  X(image_from_raw, 5, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  /* Animation */ \
+  X(anim_new, 5, ERL_NIF_DIRTY_JOB_IO_BOUND) \
+  X(anim_add_frame, 2, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(anim_finish, 1, ERL_NIF_DIRTY_JOB_IO_BOUND) \
   /* Styles */ \
   X(color, 4, 0) \
   X(color_components, 1, 0) \
@@ -298,6 +368,8 @@ MAKE_DRAW_GLYPH(stroke_glyph_run)
   X(pattern_set_transform, 2, 0) \
   X(pattern_reset_transform, 1, 0) \
   X(pattern_set_extend, 2, 0) \
+  X(style_compile, 2, 0) \
+  X(style_mode, 1, 0) \
   /* Geometries */ \
   X(path_new, 0, 0) \
   X(path_set_vertex_at, 5, 0) \
@@ -338,10 +410,21 @@ MAKE_DRAW_GLYPH(stroke_glyph_run)
   X(path_close, 1, 0) \
   X(path_hit_test, 3, 0) \
   X(path_hit_test, 4, 0) \
+  X(path_hit_test_many, 4, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(path_to_binary, 1, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(path_from_binary, 1, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(path_from_svg_d, 1, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(path_index_new, 1, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(path_index_insert, 2, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(path_index_size, 1, 0) \
+  X(path_index_query_point, 4, 0) \
+  X(path_index_query_rect, 5, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
   X(path_clear, 1, 0) \
   X(path_equals, 2, 0) \
   X(path_fit_to, 2, 0) \
-  X(path_flatten, 2, 0) \
+  X(path_flatten, 3, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(path_simplify, 4, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
+  X(plot_decimate_m4, 6, ERL_NIF_DIRTY_JOB_CPU_BOUND) \
   /* Matrix */ \
   X(matrix2d_new, 1, 0) \
   X(matrix2d_identity, 0, 0) \
@@ -0,0 +1,178 @@
+#pragma once
+#include <blend2d/blend2d.h>
+#include <cstdint>
+#include <cstring>
+#include <erl_nif.h>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// parse_list<T>
+// ----------------------------------------------------------------------------
+// Purpose: Convert an Erlang list into a std::vector<T> for specific Blend2D
+//          shapes (BLPoint, BLRect, BLBox).
+// Usage:   Called by get_array_arg for list arguments.
+// Args:    list :: [tuple()] where tuple arity depends on T.
+// Returns: vector<T>. If list/tuple decode fails mid-way, returns elements
+//          parsed so far (best-effort) and stops.
+
+template <typename T>
+inline std::vector<T> parse_list(ErlNifEnv* env, ERL_NIF_TERM list);
+
+template <>
+inline std::vector<BLPoint> parse_list<BLPoint>(ErlNifEnv* env, ERL_NIF_TERM list)
+{
+  std::vector<BLPoint> out;
+  unsigned int len;
+  if(!enif_get_list_length(env, list, &len))
+    return out;
+  out.reserve(len);
+
+  ERL_NIF_TERM head, tail = list;
+  for(unsigned int i = 0; i < len; i++) {
+    if(!enif_get_list_cell(env, tail, &head, &tail))
+      break;
+    const ERL_NIF_TERM* tuple;
+    int arity;
+    double x, y;
+    if(!enif_get_tuple(env, head, &arity, &tuple) || arity != 2 ||
+       !enif_get_double(env, tuple[0], &x) || !enif_get_double(env, tuple[1], &y))
+      break;
+    out.emplace_back(x, y);
+  }
+  return out;
+}
+
+template <>
+inline std::vector<BLRect> parse_list<BLRect>(ErlNifEnv* env, ERL_NIF_TERM list)
+{
+  std::vector<BLRect> out;
+  unsigned int len;
+  if(!enif_get_list_length(env, list, &len))
+    return out;
+  out.reserve(len);
+
+  ERL_NIF_TERM head, tail = list;
+  for(unsigned int i = 0; i < len; i++) {
+    if(!enif_get_list_cell(env, tail, &head, &tail))
+      break;
+    const ERL_NIF_TERM* tuple;
+    int arity;
+    double x, y, w, h;
+    if(!enif_get_tuple(env, head, &arity, &tuple) || arity != 4 ||
+       !enif_get_double(env, tuple[0], &x) || !enif_get_double(env, tuple[1], &y) ||
+       !enif_get_double(env, tuple[2], &w) || !enif_get_double(env, tuple[3], &h))
+      break;
+    out.emplace_back(x, y, w, h);
+  }
+  return out;
+}
+
+template <>
+inline std::vector<BLBox> parse_list<BLBox>(ErlNifEnv* env, ERL_NIF_TERM list)
+{
+  std::vector<BLBox> out;
+  unsigned int len;
+  if(!enif_get_list_length(env, list, &len))
+    return out;
+  out.reserve(len);
+
+  ERL_NIF_TERM head, tail = list;
+  for(unsigned int i = 0; i < len; i++) {
+    if(!enif_get_list_cell(env, tail, &head, &tail))
+      break;
+    const ERL_NIF_TERM* tuple;
+    int arity;
+    double x0, y0, x1, y1;
+    if(!enif_get_tuple(env, head, &arity, &tuple) || arity != 4 ||
+       !enif_get_double(env, tuple[0], &x0) || !enif_get_double(env, tuple[1], &y0) ||
+       !enif_get_double(env, tuple[2], &x1) || !enif_get_double(env, tuple[3], &y1))
+      break;
+    out.emplace_back(x0, y0, x1, y1);
+  }
+  return out;
+}
+
+// ----------------------------------------------------------------------------
+// ArrayArg<T> / get_array_arg<T>
+// ----------------------------------------------------------------------------
+// Purpose: Decode an array argument (points, rects, boxes) into a
+//          BLArrayView<T> that can be handed straight to Blend2D.
+// Accepts:
+//   - [tuple()]               -> parsed with parse_list<T> into `storage`
+//   - binary()                -> packed native-endian f64 values, 2 per point
+//                                and 4 per rect/box; viewed in place when the
+//                                binary is suitably aligned (the common case
+//                                for refc binaries), copied otherwise
+//   - {:f32, binary()}        -> packed native-endian f32 values, widened to
+//                                double into `storage`
+// Returns: false if the term has none of these shapes or the binary size is
+//          not a multiple of the element size.
+// Notes:
+//   - A binary view borrows the binary's memory; it is only valid while the
+//     term is alive, i.e. for the duration of the NIF call.
+
+template <typename T>
+struct ArrayArg {
+  std::vector<T> storage;
+  BLArrayView<T> view;
+};
+
+template <typename T>
+inline bool get_array_arg(ErlNifEnv* env, ERL_NIF_TERM term, ArrayArg<T>* out)
+{
+  static_assert(sizeof(T) % sizeof(double) == 0, "array element must be a run of doubles");
+  constexpr size_t kDoubles = sizeof(T) / sizeof(double);
+
+  ErlNifBinary bin;
+  int arity;
+  const ERL_NIF_TERM* tuple;
+
+  if(enif_is_list(env, term)) {
+    out->storage = parse_list<T>(env, term);
+    out->view.reset(out->storage.data(), out->storage.size());
+    return true;
+  }
+
+  if(enif_inspect_binary(env, term, &bin)) {
+    if(bin.size % sizeof(T) != 0)
+      return false;
+
+    size_t count = bin.size / sizeof(T);
+    if(reinterpret_cast<uintptr_t>(bin.data) % alignof(T) == 0) {
+      out->view.reset(reinterpret_cast<const T*>(bin.data), count);
+    }
+    else {
+      out->storage.resize(count);
+      if(count)
+        std::memcpy(out->storage.data(), bin.data, bin.size);
+      out->view.reset(out->storage.data(), count);
+    }
+    return true;
+  }
+
+  if(enif_get_tuple(env, term, &arity, &tuple) && arity == 2) {
+    char tag[8];
+    if(!enif_get_atom(env, tuple[0], tag, sizeof(tag), ERL_NIF_UTF8) ||
+       std::strcmp(tag, "f32") != 0 || !enif_inspect_binary(env, tuple[1], &bin))
+      return false;
+
+    constexpr size_t kStride = kDoubles * sizeof(float);
+    if(bin.size % kStride != 0)
+      return false;
+
+    size_t count = bin.size / kStride;
+    out->storage.resize(count);
+
+    double* dst = reinterpret_cast<double*>(out->storage.data());
+    for(size_t i = 0; i < count * kDoubles; i++) {
+      float v;
+      std::memcpy(&v, bin.data + i * sizeof(float), sizeof(float));
+      dst[i] = double(v);
+    }
+
+    out->view.reset(out->storage.data(), count);
+    return true;
+  }
+
+  return false;
+}
@@ -5,99 +5,13 @@
 #include "../text/font.h"
 #include "../text/glyph_buffer.h"
 #include "../text/glyph_run.h"
+#include "nif_array.h"
 #include "nif_resource.h"
 #include "nif_util.h"
 #include <blend2d/blend2d.h>
 #include <string>
 #include <unordered_map>
 
-// ----------------------------------------------------------------------------
-// parse_list<T>
-// ----------------------------------------------------------------------------
-// Purpose: Convert an Erlang list into a std::vector<T> for specific Blend2D
-//          shapes (BLPoint, BLRect, BLBox).
-// Usage:   Called by draw_shape_template when ShapeT is BLArrayView<...>.
-// Args:    list :: [tuple()] where tuple arity depends on T.
-// Returns: vector<T>. If list/tuple decode fails mid-way, returns elements
-//          parsed so far (best-effort) and stops.
-
-template <typename T>
-static std::vector<T> parse_list(ErlNifEnv* env, ERL_NIF_TERM list);
-
-template <>
-std::vector<BLPoint> parse_list<BLPoint>(ErlNifEnv* env, ERL_NIF_TERM list)
-{
-  std::vector<BLPoint> out;
-  unsigned int len;
-  if(!enif_get_list_length(env, list, &len))
-    return out;
-  out.reserve(len);
-
-  ERL_NIF_TERM head, tail = list;
-  for(unsigned int i = 0; i < len; i++) {
-    if(!enif_get_list_cell(env, tail, &head, &tail))
-      break;
-    const ERL_NIF_TERM* tuple;
-    int arity;
-    double x, y;
-    if(!enif_get_tuple(env, head, &arity, &tuple) || arity != 2 ||
-       !enif_get_double(env, tuple[0], &x) || !enif_get_double(env, tuple[1], &y))
-      break;
-    out.emplace_back(x, y);
-  }
-  return out;
-}
-
-template <>
-std::vector<BLRect> parse_list<BLRect>(ErlNifEnv* env, ERL_NIF_TERM list)
-{
-  std::vector<BLRect> out;
-  unsigned int len;
-  if(!enif_get_list_length(env, list, &len))
-    return out;
-  out.reserve(len);
-
-  ERL_NIF_TERM head, tail = list;
-  for(unsigned int i = 0; i < len; i++) {
-    if(!enif_get_list_cell(env, tail, &head, &tail))
-      break;
-    const ERL_NIF_TERM* tuple;
-    int arity;
-    double x, y, w, h;
-    if(!enif_get_tuple(env, head, &arity, &tuple) || arity != 4 ||
-       !enif_get_double(env, tuple[0], &x) || !enif_get_double(env, tuple[1], &y) ||
-       !enif_get_double(env, tuple[2], &w) || !enif_get_double(env, tuple[3], &h))
-      break;
-    out.emplace_back(x, y, w, h);
-  }
-  return out;
-}
-
-template <>
-std::vector<BLBox> parse_list<BLBox>(ErlNifEnv* env, ERL_NIF_TERM list)
-{
-  std::vector<BLBox> out;
-  unsigned int len;
-  if(!enif_get_list_length(env, list, &len))
-    return out;
-  out.reserve(len);
-
-  ERL_NIF_TERM head, tail = list;
-  for(unsigned int i = 0; i < len; i++) {
-    if(!enif_get_list_cell(env, tail, &head, &tail))
-      break;
-    const ERL_NIF_TERM* tuple;
-    int arity;
-    double x0, y0, x1, y1;
-    if(!enif_get_tuple(env, head, &arity, &tuple) || arity != 4 ||
-       !enif_get_double(env, tuple[0], &x0) || !enif_get_double(env, tuple[1], &y0) ||
-       !enif_get_double(env, tuple[2], &x1) || !enif_get_double(env, tuple[3], &y1))
-      break;
-    out.emplace_back(x0, y0, x1, y1);
-  }
-  return out;
-}
-
 // ----------------------------------------------------------------------------
 // draw_shape_template
 // ----------------------------------------------------------------------------
@@ -108,11 +22,11 @@ std::vector<BLBox> parse_list<BLBox>(ErlNifEnv* env, ERL_NIF_TERM list)
 // argv layout:
 //   [0] Canvas resource
 //   [1..N] numeric args OR a list (for array shapes)
-//   [last?] optional opts list (style)
+//   [last?] optional opts list or compiled style
 // Shape routing:
 //   - If ShapeT == BLArrayView<BLPoint|BLRect|BLBox>:
-//       argv[1] must be a list of tuples; parsed with parse_list<T> and wrapped
-//       in a transient BLArrayView passed directly to ctx method.
+//       argv[1] is a list of tuples, a packed f64 binary or {:f32, binary};
+//       decoded with get_array_arg<T> and its view passed directly to ctx method.
 //   - Else (single shape types BLBox/BLRect/BLLine/BLCircle/BLEllipse/BLRoundRect/BLArc/BLTriangle):
 //       collects up to 8 doubles from argv[1..], validates arity, constructs ShapeT.
 // Style:
@@ -134,10 +48,14 @@ ERL_NIF_TERM draw_shape_template(ErlNifEnv* env,
     return make_result_error(env, "draw_shape_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   // ---- Optional style ----
   ERL_NIF_TERM opts = 0;
   int numeric_argc = argc - 1;
-  if(argc >= 3 && enif_is_list(env, argv[argc - 1])) {
+  if(argc >= 3 && is_style_arg(env, argv[argc - 1])) {
     opts = argv[argc - 1];
     numeric_argc -= 1;
   }
@@ -153,22 +71,31 @@ ERL_NIF_TERM draw_shape_template(ErlNifEnv* env,
 
   // ---- Case 1: array shapes ----
   if constexpr(std::is_same_v<ShapeT, BLArrayView<BLPoint>>) {
-    auto points = parse_list<BLPoint>(env, argv[1]);
-    BLArrayView<BLPoint> view;
-    view.reset(points.data(), points.size());
-    result = (canvas->ctx.*fn)(view);
+    ArrayArg<BLPoint> points;
+    if(!get_array_arg(env, argv[1], &points)) {
+      canvas->ctx.restore();
+      return make_result_error(env, "draw_shape_invalid_array");
+    }
+    result = (canvas->ctx.*fn)(points.view);
+    canvas->dirty.add(canvas->ctx, shape_bounds(points.view));
   }
   else if constexpr(std::is_same_v<ShapeT, BLArrayView<BLRect>>) {
-    auto rects = parse_list<BLRect>(env, argv[1]);
-    BLArrayView<BLRect> view;
-    view.reset(rects.data(), rects.size());
-    result = (canvas->ctx.*fn)(view);
+    ArrayArg<BLRect> rects;
+    if(!get_array_arg(env, argv[1], &rects)) {
+      canvas->ctx.restore();
+      return make_result_error(env, "draw_shape_invalid_array");
+    }
+    result = (canvas->ctx.*fn)(rects.view);
+    canvas->dirty.add(canvas->ctx, shape_bounds(rects.view));
   }
   else if constexpr(std::is_same_v<ShapeT, BLArrayView<BLBox>>) {
-    auto boxes = parse_list<BLBox>(env, argv[1]);
-    BLArrayView<BLBox> view;
-    view.reset(boxes.data(), boxes.size());
-    result = (canvas->ctx.*fn)(view);
+    ArrayArg<BLBox> boxes;
+    if(!get_array_arg(env, argv[1], &boxes)) {
+      canvas->ctx.restore();
+      return make_result_error(env, "draw_shape_invalid_array");
+    }
+    result = (canvas->ctx.*fn)(boxes.view);
+    canvas->dirty.add(canvas->ctx, shape_bounds(boxes.view));
   }
 
   // ---- Case 2: single shapes ----
@@ -247,6 +174,7 @@ ERL_NIF_TERM draw_shape_template(ErlNifEnv* env,
     }
 
     result = (canvas->ctx.*fn)(shape);
+    canvas->dirty.add(canvas->ctx, shape_bounds(shape));
   }
 
   canvas->ctx.restore();
@@ -294,7 +222,7 @@ ERL_NIF_TERM nif_make_resource_from_args(ErlNifEnv* env, const ERL_NIF_TERM argv
 //   [2] x :: double
 //   [3] y :: double
 //   [4] TEXT: binary (UTF-8/bytes)   |  GLYPH: GlyphRun resource
-//   [5] (optional) opts list (style)
+//   [5] (optional) opts list or compiled style
 // Dispatch:
 //   - If FnT == TextFn: argv[4] must be binary; passed as BLStringView (not NUL-terminated).
 //   - If FnT == GlyphFn: argv[4] must be a GlyphRun resource; run passed directly.
@@ -318,6 +246,10 @@ draw_text_or_glyph_template(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[],
     return make_result_error(env, "draw_text_or_glyph_invalid_canvas");
   }
 
+  CanvasLock lock(canvas);
+  if(!lock)
+    return make_result_error(env, "canvas_busy");
+
   // font resource
   auto font = NifResource<Font>::get(env, argv[1]);
   if(font == nullptr) {
@@ -363,7 +295,14 @@ draw_text_or_glyph_template(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[],
 
     const char* text = reinterpret_cast<const char*>(text_bin.data);
     size_t len = text_bin.size;
-    result = (canvas->ctx.*fn)(origin, font->value, BLStringView{text, len});
+    BLStringView view{text, len};
+    result = (canvas->ctx.*fn)(origin, font->value, view);
+
+    BLBox bounds;
+    if(text_bounds(font->value, origin, view, &bounds))
+      canvas->dirty.add(canvas->ctx, bounds);
+    else
+      canvas->dirty.add_all();
   }
   else if constexpr(std::is_same_v<FnT, GlyphFn>) {
     // GLYPH variant: expect a GlyphRun resource at argv[4]
@@ -375,6 +314,12 @@ draw_text_or_glyph_template(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[],
 
     const BLGlyphRun& run = gr->run;
     result = (canvas->ctx.*fn)(origin, font->value, run);
+
+    BLBox bounds;
+    if(glyph_run_bounds(font->value, origin, run, &bounds))
+      canvas->dirty.add(canvas->ctx, bounds);
+    else
+      canvas->dirty.add_all();
   }
   else {
     // unsupported FnT
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// parallel_for
+// ----------------------------------------------------------------------------
+// Purpose: Run fn(0) .. fn(count - 1) side by side, one thread per chunk.
+// Usage:   Called from dirty NIFs that split their work into chunks.
+// Args:    count :: number of chunks; fn :: callable taking the chunk index,
+//          safe to call from several threads at once.
+// Notes:   The calling (dirty scheduler) thread takes chunk 0. If a thread
+//          cannot be started (std::system_error when the process is out of
+//          threads, or std::bad_alloc), the chunks left run on the calling
+//          thread instead, so no exception reaches the NIF boundary.
+
+template <typename Fn>
+inline void parallel_for(size_t count, Fn&& fn)
+{
+  if(count == 0)
+    return;
+
+  std::vector<std::thread> workers;
+  size_t started = 1;
+  try {
+    workers.reserve(count - 1);
+    for(; started < count; started++)
+      workers.emplace_back([&fn, started] { fn(started); });
+  }
+  catch(const std::exception&) {
+    // Out of threads: the chunks not started yet run below.
+  }
+
+  fn(size_t(0));
+  for(size_t i = started; i < count; i++)
+    fn(i);
+  for(auto& worker : workers)
+    worker.join();
+}
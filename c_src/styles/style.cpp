@@ -0,0 +1,66 @@
+#include "../nif/nif_resource.h"
+#include "../nif/nif_util.h"
+#include "styles.h"
+
+#include <cstring>
+
+// style_compile(opts, mode)
+//   opts :: keyword list accepted by the draw NIFs
+//   mode :: :fill | :stroke (the mode Blendend.Draw classified the opts as)
+//
+// Parses and validates `opts` once. Unlike a plain parse, every recognized
+// key must carry a valid value; the returned resource can then be passed to
+// any draw NIF in place of the opts list.
+ERL_NIF_TERM style_compile(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 2 || !enif_is_list(env, argv[0])) {
+    return enif_make_badarg(env);
+  }
+
+  char mode[8];
+  if(!enif_get_atom(env, argv[1], mode, sizeof(mode), ERL_NIF_UTF8) ||
+     (strcmp(mode, "fill") != 0 && strcmp(mode, "stroke") != 0)) {
+    return make_result_error(env, "style_compile_invalid_mode");
+  }
+
+  Style style;
+  if(!parse_style(env, argv, argc, 0, &style)) {
+    return make_result_error(env, "style_compile_invalid_opts");
+  }
+
+  auto compiled = NifResource<CompiledStyle>::alloc();
+  if(compiled == nullptr) {
+    return make_result_error(env, "style_compile_alloc_failed");
+  }
+
+  void* brushes[] = {style.color,
+                     style.gradient,
+                     style.pattern,
+                     style.stroke_color,
+                     style.stroke_gradient,
+                     style.stroke_pattern};
+  for(void* res : brushes) {
+    if(res)
+      enif_keep_resource(res);
+  }
+
+  compiled->style = style;
+  compiled->stroke_mode = strcmp(mode, "stroke") == 0;
+
+  return make_result_ok(env, NifResource<CompiledStyle>::make(env, compiled));
+}
+
+// style_mode(style) -> :fill | :stroke
+ERL_NIF_TERM style_mode(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  if(argc != 1) {
+    return enif_make_badarg(env);
+  }
+
+  auto compiled = NifResource<CompiledStyle>::get(env, argv[0]);
+  if(compiled == nullptr) {
+    return make_result_error(env, "style_mode_invalid_style");
+  }
+
+  return enif_make_atom(env, compiled->stroke_mode ? "stroke" : "fill");
+}
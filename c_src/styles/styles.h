@@ -3,8 +3,7 @@
 #include "erl_nif.h"
 
 #include <blend2d/blend2d.h>
-#include <string>
-#include <unordered_map>
+#include <cstring>
 struct Color {
   BLRgba32 value;
 
@@ -114,6 +113,33 @@ struct Style {
   }
 };
 
+// A style parsed once by style_compile/2 and reused across draw calls in
+// place of an opts list. It holds a reference on every brush it points to,
+// so the brushes stay alive as long as the compiled style does.
+struct CompiledStyle {
+  Style style;
+  bool stroke_mode = false; // the draw mode Blendend.Draw picks for it
+
+  void destroy() noexcept {
+    void* brushes[] = {style.color,
+                       style.gradient,
+                       style.pattern,
+                       style.stroke_color,
+                       style.stroke_gradient,
+                       style.stroke_pattern};
+    for(void* res : brushes) {
+      if(res)
+        enif_release_resource(res);
+    }
+  }
+};
+
+// True if `term` can stand in for the opts argument of a draw NIF: either a
+// keyword list or a compiled style.
+inline bool is_style_arg(ErlNifEnv* env, ERL_NIF_TERM term) {
+  return enif_is_list(env, term) || NifResource<CompiledStyle>::get(env, term) != nullptr;
+}
+
 inline bool
 parse_style(ErlNifEnv* env, const ERL_NIF_TERM argv[], int argc, int opts_index, Style* out) {
   // Track whether any stroke styling was provided so we can disambiguate
@@ -129,34 +155,43 @@ parse_style(ErlNifEnv* env, const ERL_NIF_TERM argv[], int argc, int opts_index,
   if(argc <= opts_index)
     return true;
 
-  // Options must be a list; if not, treat as malformed
   ERL_NIF_TERM list = argv[opts_index], head, tail;
+
+  // Precompiled style: already validated, just copy it.
+  if(auto compiled = NifResource<CompiledStyle>::get(env, list)) {
+    *out = compiled->style;
+    return true;
+  }
+
+  // Options must be a list; if not, treat as malformed
   if(!enif_is_list(env, list))
     return false;
 
-  bool ok = true; // becomes false if any recognized key has a bad value
+  // Becomes false if any recognized key has a bad value, including an
+  // unknown cap, join or comp_op atom. Draw NIFs that ignore the result skip
+  // such keys; style_compile rejects them.
+  bool ok = true;
 
   auto parse_cap_atom = [&](ERL_NIF_TERM term, uint8_t* out_cap) -> bool {
     char cap[32];
     if(!enif_get_atom(env, term, cap, sizeof(cap), ERL_NIF_UTF8))
       return false;
 
-    uint8_t mode = BL_STROKE_CAP_BUTT;
-
     if(!strcmp(cap, "butt"))
-      mode = BL_STROKE_CAP_BUTT;
+      *out_cap = BL_STROKE_CAP_BUTT;
     else if(!strcmp(cap, "round"))
-      mode = BL_STROKE_CAP_ROUND;
+      *out_cap = BL_STROKE_CAP_ROUND;
     else if(!strcmp(cap, "square"))
-      mode = BL_STROKE_CAP_SQUARE;
+      *out_cap = BL_STROKE_CAP_SQUARE;
     else if(!strcmp(cap, "round_rev"))
-      mode = BL_STROKE_CAP_ROUND_REV;
+      *out_cap = BL_STROKE_CAP_ROUND_REV;
     else if(!strcmp(cap, "triangle"))
-      mode = BL_STROKE_CAP_TRIANGLE;
+      *out_cap = BL_STROKE_CAP_TRIANGLE;
     else if(!strcmp(cap, "triangle_rev"))
-      mode = BL_STROKE_CAP_TRIANGLE_REV;
+      *out_cap = BL_STROKE_CAP_TRIANGLE_REV;
+    else
+      return false;
 
-    *out_cap = mode;
     return true;
   };
 
@@ -165,19 +200,19 @@ parse_style(ErlNifEnv* env, const ERL_NIF_TERM argv[], int argc, int opts_index,
     if(!enif_get_atom(env, term, join, sizeof(join), ERL_NIF_UTF8))
       return false;
 
-    uint8_t mode = BL_STROKE_JOIN_MITER_CLIP;
     if(!strcmp(join, "miter_clip"))
-      mode = BL_STROKE_JOIN_MITER_CLIP;
+      *out_join = BL_STROKE_JOIN_MITER_CLIP;
     else if(!strcmp(join, "round"))
-      mode = BL_STROKE_JOIN_ROUND;
+      *out_join = BL_STROKE_JOIN_ROUND;
     else if(!strcmp(join, "bevel"))
-      mode = BL_STROKE_JOIN_BEVEL;
+      *out_join = BL_STROKE_JOIN_BEVEL;
     else if(!strcmp(join, "miter_bevel"))
-      mode = BL_STROKE_JOIN_MITER_BEVEL;
+      *out_join = BL_STROKE_JOIN_MITER_BEVEL;
     else if(!strcmp(join, "miter_round"))
-      mode = BL_STROKE_JOIN_MITER_ROUND;
+      *out_join = BL_STROKE_JOIN_MITER_ROUND;
+    else
+      return false;
 
-    *out_join = mode;
     return true;
   };
 
@@ -309,8 +344,10 @@ parse_style(ErlNifEnv* env, const ERL_NIF_TERM argv[], int argc, int opts_index,
     else if(strcmp(key, "comp_op") == 0) {
       char op[32];
       if(enif_get_atom(env, tup[1], op, sizeof(op), ERL_NIF_UTF8)) {
-        // static map once
-        static const std::unordered_map<std::string, BLCompOp> comp_map = {
+        static const struct {
+          const char* name;
+          BLCompOp op;
+        } comp_ops[] = {
             {"src_over", BL_COMP_OP_SRC_OVER},
             {"src_copy", BL_COMP_OP_SRC_COPY},
             {"src_in", BL_COMP_OP_SRC_IN},
@@ -338,10 +375,19 @@ parse_style(ErlNifEnv* env, const ERL_NIF_TERM argv[], int argc, int opts_index,
             {"pin_light", BL_COMP_OP_PIN_LIGHT},
             {"hard_light", BL_COMP_OP_HARD_LIGHT},
             {"soft_light", BL_COMP_OP_SOFT_LIGHT},
-            {"exclusion", BL_COMP_OP_EXCLUSION}};
-        out->has_comp_op = true;
-        auto it = comp_map.find(std::string(op));
-        out->comp_op = (it != comp_map.end()) ? it->second : BL_COMP_OP_SRC_OVER;
+            {"exclusion", BL_COMP_OP_EXCLUSION},
+        };
+        bool found = false;
+        for(const auto& entry : comp_ops) {
+          if(strcmp(op, entry.name) == 0) {
+            out->has_comp_op = true;
+            out->comp_op = entry.op;
+            found = true;
+            break;
+          }
+        }
+        if(!found)
+          ok = false;
       }
       else {
         ok = false;
@@ -0,0 +1,129 @@
+defmodule Blendend.Anim do
+  @moduledoc """
+  Writes animated PNG and GIF files frame by frame.
+
+  Instead of saving every frame as its own image and stitching them with an
+  external tool, open an animation, draw each frame on a canvas and append
+  it. Frames are encoded on dirty schedulers and written to the file as they
+  arrive, so neither the frames nor the encoded file are held in memory.
+
+      {:ok, canvas} = Blendend.Canvas.new(320, 240)
+      {:ok, anim} = Blendend.Anim.new("orbit.png", :apng, 30)
+
+      for t <- 0..89 do
+        :ok = Blendend.Canvas.clear(canvas, fill: background)
+        :ok = Blendend.Canvas.Fill.circle(canvas, 160 + 100 * :math.cos(t / 14), 120, 12, dot)
+        :ok = Blendend.Anim.add_frame(anim, canvas)
+      end
+
+      :ok = Blendend.Anim.finish(anim)
+
+  Each frame is compared with the previous one and only the bounding box of
+  the changed pixels is encoded. A frame identical to the previous one
+  costs nothing but a longer delay.
+
+  `:apng` output is lossless, transparency included. `:gif` output is
+  quantized to a median-cut palette of up to 256 colors per frame, without
+  dithering, and alpha is cut to fully transparent below 128. GIF delays
+  are whole centiseconds; frames are never shown for less than 0.02 s, which
+  caps GIF playback at 50 fps.
+  """
+
+  alias Blendend.{Canvas, Error, Native}
+
+  @typedoc "Opaque animation writer resource."
+  @opaque t :: reference()
+
+  @typedoc """
+  Options for `new/4`; for `:apng`, any `t:Blendend.Canvas.png_opt/0`
+  except `:threads` is applied to the frames.
+  """
+  @type opt :: {:loop, non_neg_integer()} | Canvas.png_opt()
+
+  @doc """
+  Starts an animation to be written to `path` (`format` is `:apng` or
+  `:gif`), playing `fps` frames per second.
+
+  Frames go to a temporary file next to `path`, created right away;
+  `finish/1` renames it over `path`. Until then an existing file at `path`
+  is left as it was, and readers never see a partial animation.
+
+  The first frame added fixes the size of the animation.
+
+  Options:
+
+    * `:loop` – how many times the animation plays, `0` (default) for
+      forever.
+    * For `:apng`, the encoder options of `Blendend.Canvas.to_png/2`
+      (`:compression`, `:filter`, `:fast`, `:opaque`).
+
+  On success, returns `{:ok, anim}`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec new(Path.t(), :apng | :gif, number(), [opt()]) :: {:ok, t()} | {:error, term()}
+  def new(path, format, fps, opts \\ []) when is_number(fps) do
+    {loop, png_opts} = Keyword.pop(opts, :loop, 0)
+    Native.anim_new(IO.chardata_to_string(path), format, fps * 1.0, loop, png_opts)
+  end
+
+  @doc """
+  Same as `new/4`, but returns the animation directly and raises on failure.
+  """
+  @spec new!(Path.t(), :apng | :gif, number(), [opt()]) :: t()
+  def new!(path, format, fps, opts \\ []) do
+    case new(path, format, fps, opts) do
+      {:ok, anim} -> anim
+      {:error, reason} -> raise Error.new(:anim_new, reason)
+    end
+  end
+
+  @doc """
+  Appends the current contents of `canvas` as the next frame.
+
+  Every frame must have the size of the first one.
+
+  On success, returns `:ok`.
+
+  On failure, returns `{:error, reason}`. A failed write closes the
+  animation and removes its temporary file; `path` is not touched.
+  """
+  @spec add_frame(t(), Canvas.t()) :: :ok | {:error, term()}
+  def add_frame(anim, canvas), do: Native.anim_add_frame(anim, canvas)
+
+  @doc """
+  Same as `add_frame/2`, but raises on failure.
+  """
+  @spec add_frame!(t(), Canvas.t()) :: :ok
+  def add_frame!(anim, canvas) do
+    case add_frame(anim, canvas) do
+      :ok -> :ok
+      {:error, reason} -> raise Error.new(:anim_add_frame, reason)
+    end
+  end
+
+  @doc """
+  Completes the file and renames it over `path`.
+
+  The temporary file of an animation that is never finished is removed when
+  the animation is garbage collected, as is the one of an animation
+  finished without frames; in both cases `path` is not touched.
+
+  On success, returns `:ok`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec finish(t()) :: :ok | {:error, term()}
+  def finish(anim), do: Native.anim_finish(anim)
+
+  @doc """
+  Same as `finish/1`, but raises on failure.
+  """
+  @spec finish!(t()) :: :ok
+  def finish!(anim) do
+    case finish(anim) do
+      :ok -> :ok
+      {:error, reason} -> raise Error.new(:anim_finish, reason)
+    end
+  end
+end
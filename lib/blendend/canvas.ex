@@ -13,11 +13,53 @@ defmodule Blendend.Canvas do
 
   Under the hood, the backing image is created as a `blend2d` `BLImage` with
   format `BL_FORMAT_PRGB32` (premultiplied 32-bit RGBA).
+
+  ## Concurrency
+
+  A canvas may be shared between processes. Every call takes a per-canvas
+  lock, so calls never interleave inside the native context. When a call
+  running on a normal scheduler finds the canvas held by another process for
+  longer than a brief spin (typically a long encode or `exec/2` running on a
+  dirty scheduler), it returns `{:error, :canvas_busy}` instead of blocking
+  the scheduler; the bang variants raise. Calls running on dirty schedulers
+  (`to_png/1`, `to_qoi/1`, `exec/2`, ...) wait for the lock instead.
+
+  Transforms and saved states belong to the canvas, not the calling process:
+  processes drawing on the same canvas should either leave the transform
+  alone or work on separate canvases.
   """
 
   @typedoc "Canvas/context resource backed by a blend2d `BLContext`."
   @opaque t :: reference()
 
+  @typedoc "Option for `new/3`."
+  @type new_opt :: {:threads, non_neg_integer()} | {:command_queue_limit, non_neg_integer()}
+
+  @typedoc "Encoder option for `to_png/2`."
+  @type png_opt ::
+          {:compression, 0..9}
+          | {:filter, :none | :sub | :up | :average | :paeth | :adaptive}
+          | {:fast, boolean()}
+          | {:opaque, boolean()}
+          | {:threads, pos_integer()}
+
+  @typedoc "A canvas region in pixels, as reported by `dirty_rects/1`."
+  @type rect :: %{
+          x: non_neg_integer(),
+          y: non_neg_integer(),
+          width: pos_integer(),
+          height: pos_integer()
+        }
+
+  @typedoc "One encoded region returned by `export_delta/2`."
+  @type delta :: %{
+          x: non_neg_integer(),
+          y: non_neg_integer(),
+          width: pos_integer(),
+          height: pos_integer(),
+          data: binary()
+        }
+
   alias Blendend.{Native, Error, Matrix2D, Image}
 
   # ===========================================================================
@@ -32,9 +74,27 @@ defmodule Blendend.Canvas do
   Returns `{:ok, canvas}` on success, where `canvas` is a reference that
   you pass to the other functions in this module.
 
+  ## Options
+
+    * `:threads` - number of worker threads used by the rendering context.
+      `0` (the default) rasterizes synchronously on the calling scheduler.
+      With `n > 0`, draw calls are queued and rasterized asynchronously by
+      `blend2d`'s thread pool; `to_png/1`, `to_qoi/1` and the other readers
+      wait for pending work before touching the pixels.
+    * `:command_queue_limit` - maximum number of queued commands before a batch
+      is handed to the workers (`0` lets `blend2d` pick).
+
+  Multi-threaded rendering pays off for large canvases with many draw calls,
+  e.g. 4K frames; small canvases are usually faster synchronously.
+
+  ## Examples
+
+      iex> {:ok, c} = Blendend.Canvas.new(3840, 2160, threads: 8)
   """
-  @spec new(pos_integer(), pos_integer()) :: {:ok, t()} | {:error, term()}
-  def new(w, h), do: Native.canvas_new(w, h)
+  @spec new(pos_integer(), pos_integer(), [new_opt()]) :: {:ok, t()} | {:error, term()}
+  def new(w, h, opts \\ [])
+  def new(w, h, []), do: Native.canvas_new(w, h)
+  def new(w, h, opts), do: Native.canvas_new(w, h, opts)
 
   @doc """
   Returns the canvas size in pixels.
@@ -60,15 +120,15 @@ defmodule Blendend.Canvas do
   end
 
   @doc """
-  Same as `new/2`, but returns the canvas directly.
+  Same as `new/3`, but returns the canvas directly.
 
   On success, returns `canvas`.
 
   On failure, raises `Blendend.Error`.
   """
-  @spec new!(pos_integer(), pos_integer()) :: t()
-  def new!(w, h) do
-    case new(w, h) do
+  @spec new!(pos_integer(), pos_integer(), [new_opt()]) :: t()
+  def new!(w, h, opts \\ []) do
+    case new(w, h, opts) do
       {:ok, canvas} -> canvas
       {:error, reason} -> raise Error.new(:canvas_new, reason)
     end
@@ -77,7 +137,8 @@ defmodule Blendend.Canvas do
   @doc """
   Saves the contents of a canvas to a png image file on disk.
 
-  The `path` is a filename (e.g. `"out.png"`). 
+  The `path` is a filename (e.g. `"out.png"`). The image is encoded
+  straight into the file, see `write_file/4`.
 
   Returns `:ok` on success or `{:error, reason}` if the image could not be
   written.
@@ -89,11 +150,7 @@ defmodule Blendend.Canvas do
       iex> :ok = Blendend.Canvas.save(c, "test_output.png")
   """
   @spec save(t(), String.t()) :: :ok | {:error, term()}
-  def save(canvas, path) do
-    with {:ok, bin} <- to_png(canvas) do
-      File.write(path, bin)
-    end
-  end
+  def save(canvas, path), do: write_file(canvas, path, :png)
 
   @doc """
   Same as `save/2`, but raises on failure.
@@ -119,7 +176,8 @@ defmodule Blendend.Canvas do
   @doc """
   Saves the contents of a canvas to an image file on disk in QOI format.
 
-  The `path` is a filename (e.g. `"out.qoi"`). 
+  The `path` is a filename (e.g. `"out.qoi"`). The image is encoded
+  straight into the file, see `write_file/4`.
 
   Returns `:ok` on success or `{:error, reason}` if writing fails.
 
@@ -130,11 +188,7 @@ defmodule Blendend.Canvas do
       iex> :ok = Blendend.Canvas.save_qoi(c, "test_output.qoi")
   """
   @spec save_qoi(t(), String.t()) :: :ok | {:error, term()}
-  def save_qoi(canvas, path) do
-    with {:ok, bin} <- to_qoi(canvas) do
-      File.write(path, bin)
-    end
-  end
+  def save_qoi(canvas, path), do: write_file(canvas, path, :qoi)
 
   @doc """
   Same as `save_qoi/2`, but raises on failure.
@@ -157,6 +211,53 @@ defmodule Blendend.Canvas do
     end
   end
 
+  @doc """
+  Encodes the canvas as `format` (`:png` or `:qoi`) directly into the file
+  at `path`.
+
+  Unlike `to_png/2` followed by `File.write/2`, the encoded image never
+  exists as a whole: rows are encoded and written in small pieces on a dirty
+  IO scheduler, and no binary reaches the Erlang heap. This keeps memory flat
+  when exporting many images in a row.
+
+  Options:
+
+    * `:fsync` – `true` flushes the file to stable storage before
+      returning (default `false`).
+    * For `:png`, the encoder options of `to_png/2`. Unlike `to_png/2`,
+      `:threads` defaults to `1`, as batch exports usually run several
+      writes side by side.
+
+  The image is written to a temporary file next to `path` and renamed over
+  it once complete, so readers never see a half-written file.
+
+  On success, returns `:ok`.
+
+  On failure, returns `{:error, reason}`; no partial file is left behind
+  and an existing file at `path` is kept as it was.
+  """
+  @spec write_file(t(), Path.t(), :png | :qoi, [png_opt() | {:fsync, boolean()}]) ::
+          :ok | {:error, term()}
+  def write_file(canvas, path, format, opts \\ []) do
+    {fsync, png_opts} = Keyword.pop(opts, :fsync, false)
+    Native.canvas_write_file(canvas, IO.chardata_to_string(path), format, fsync, png_opts)
+  end
+
+  @doc """
+  Same as `write_file/4`, but raises on failure.
+
+  On success, returns `:ok`.
+
+  On failure, raises `Blendend.Error`.
+  """
+  @spec write_file!(t(), Path.t(), :png | :qoi, [png_opt() | {:fsync, boolean()}]) :: :ok
+  def write_file!(canvas, path, format, opts \\ []) do
+    case write_file(canvas, path, format, opts) do
+      :ok -> :ok
+      {:error, reason} -> raise Error.new(:canvas_write_file, reason)
+    end
+  end
+
   @doc """
   Clears the entire canvas.
 
@@ -177,9 +278,9 @@ defmodule Blendend.Canvas do
       iex> :ok = Blendend.Canvas.clear(c, fill: Blendend.Style.Color.rgb!(0, 0, 0, 0), comp_op: :src_copy)
 
   The exact shape of the options is the same as the shape–drawing functions in
-  `Blendend.Canvas.Fill.path/3`.
+  `Blendend.Canvas.Fill.path/3`; a compiled `Blendend.Style` works as well.
   """
-  @spec clear(t(), keyword()) :: :ok | {:error, term()}
+  @spec clear(t(), keyword() | Blendend.Style.t()) :: :ok | {:error, term()}
   def clear(canvas, opts \\ []), do: Native.canvas_clear(canvas, opts)
 
   @doc """
@@ -187,7 +288,7 @@ defmodule Blendend.Canvas do
 
   On failure, raises `Blendend.Error`.
   """
-  @spec clear!(t(), keyword()) :: t()
+  @spec clear!(t(), keyword() | Blendend.Style.t()) :: t()
   def clear!(canvas, opts \\ []) do
     case clear(canvas, opts) do
       :ok -> canvas
@@ -535,6 +636,44 @@ defmodule Blendend.Canvas do
     end
   end
 
+  # ===========================================================================
+  # Batched drawing
+  # ===========================================================================
+
+  @doc """
+  Replays a `Blendend.Draw.Batch` on the canvas in a single NIF call.
+
+  The canvas state (transform, styles) is saved before the first op and
+  restored after the last one, so a batch behaves like the sequence of
+  individual draw calls it records.
+
+  On success, returns `:ok`.
+
+  On failure, returns `{:error, {reason, offset}}` where `offset` is the byte
+  offset of the first op that could not be replayed. Ops before it have
+  already been drawn.
+  """
+  @spec exec(t(), Blendend.Draw.Batch.t()) :: :ok | {:error, term()}
+  def exec(canvas, %Blendend.Draw.Batch{} = batch) do
+    {ops, refs} = Blendend.Draw.Batch.encode(batch)
+    Native.canvas_exec(canvas, ops, refs)
+  end
+
+  @doc """
+  Same as `exec/2`, but returns the canvas.
+
+  On success, returns `canvas`.
+
+  On failure, raises `Blendend.Error`.
+  """
+  @spec exec!(t(), Blendend.Draw.Batch.t()) :: t()
+  def exec!(canvas, batch) do
+    case exec(canvas, batch) do
+      :ok -> canvas
+      {:error, reason} -> raise Error.new(:canvas_exec, reason)
+    end
+  end
+
   # ===========================================================================
   # Export: PNG / Base64 / QOI
   # ===========================================================================
@@ -542,23 +681,52 @@ defmodule Blendend.Canvas do
   @doc """
   Encodes the current canvas contents as PNG.
 
+  The canvas goes through blendend's own encoder, split into horizontal
+  stripes that are compressed in parallel. The options expose the
+  trade-off between latency and file size:
+
+    * `:compression` – zlib level `0..9` (default `6`). `0` stores the
+      pixels uncompressed and is the fastest possible encode.
+    * `:filter` – row filter: `:none`, `:sub`, `:up`, `:average`, `:paeth`
+      or `:adaptive` (default; tries all five per row and keeps the
+      cheapest). A fixed filter is noticeably faster than `:adaptive`.
+    * `:fast` – `true` selects level 1, run-length matching and the `:sub`
+      filter: several times faster than the defaults for somewhat larger
+      files. Meant for live previews.
+    * `:opaque` – `true` writes RGB instead of RGBA, a quarter fewer bytes
+      to compress. Translucent pixels come out as if drawn over black.
+    * `:threads` – number of horizontal stripes filtered and compressed in
+      parallel (default: the number of online dirty CPU schedulers). The
+      stripes are stitched into one standard PNG; each costs a few hundred
+      bytes of extra output. Canvases under 128 rows are encoded on one
+      thread regardless.
+
+  For archival output use `compression: 9`; it shrinks files by a few
+  percent at several times the encode cost. `mix run bench/png_encode.exs`
+  times each option against Blend2D's codec on the same canvas and reports
+  both encode time and file size.
+
   On success, returns `{:ok, binary}` where `binary` is a valid PNG stream.
 
-  On failure, returns `{:error, reason}`.
+  On failure, returns `{:error, reason}`; unknown or malformed options give
+  `{:error, :canvas_to_png_invalid_options}`.
   """
-  @spec to_png(t()) :: {:ok, binary()} | {:error, term()}
-  def to_png(canvas), do: Native.canvas_to_png(canvas)
+  @spec to_png(t(), [png_opt()]) :: {:ok, binary()} | {:error, term()}
+  def to_png(canvas, opts \\ []), do: Native.canvas_to_png(canvas, png_opts(opts))
+
+  defp png_opts(opts),
+    do: Keyword.put_new(opts, :threads, :erlang.system_info(:dirty_cpu_schedulers_online))
 
   @doc """
-  Same as `to_png/1`, but returns the PNG binary directly.
+  Same as `to_png/2`, but returns the PNG binary directly.
 
   On success, returns the PNG `binary`.
 
   On failure, raises `Blendend.Error`.
   """
-  @spec to_png!(t()) :: binary()
-  def to_png!(canvas) do
-    case to_png(canvas) do
+  @spec to_png!(t(), [png_opt()]) :: binary()
+  def to_png!(canvas, opts \\ []) do
+    case to_png(canvas, opts) do
       {:ok, bin} -> bin
       {:error, reason} -> raise Error.new(:canvas_to_png, reason)
     end
@@ -567,29 +735,90 @@ defmodule Blendend.Canvas do
   @doc """
   Encodes the canvas as PNG and returns a Base64–encoded string.
 
+  Takes the same options as `to_png/2`.
+
   On success, returns `{:ok, base64}` where `base64` is the PNG encoded as a
   Base64 binary (no data URL prefix is added).
 
+  The canvas stays usable: drawing can continue afterwards, so the same
+  canvas can emit progressive previews.
+
   On failure, returns `{:error, reason}`.
   """
-  @spec to_png_base64(t()) :: {:ok, binary()} | {:error, term()}
-  def to_png_base64(canvas), do: Native.canvas_to_png_base64(canvas)
+  @spec to_png_base64(t(), [png_opt()]) :: {:ok, binary()} | {:error, term()}
+  def to_png_base64(canvas, opts \\ []),
+    do: Native.canvas_to_png_base64(canvas, png_opts(opts))
 
   @doc """
-  Same as `to_png_base64/1`, but returns the Base64 string directly.
+  Same as `to_png_base64/2`, but returns the Base64 string directly.
 
   On success, returns the Base64-encoded PNG `binary`.
 
   On failure, raises `Blendend.Error`.
   """
-  @spec to_png_base64!(t()) :: binary()
-  def to_png_base64!(canvas) do
-    case to_png_base64(canvas) do
+  @spec to_png_base64!(t(), [png_opt()]) :: binary()
+  def to_png_base64!(canvas, opts \\ []) do
+    case to_png_base64(canvas, opts) do
       {:ok, bin} -> bin
       {:error, reason} -> raise Error.new(:canvas_to_png_base64, reason)
     end
   end
 
+  @doc """
+  Encodes only what changed since the previous call.
+
+  The canvas keeps track of the pixels touched by every fill, stroke, text,
+  blit and `exec/2` op: each shape's bounds are mapped through the current
+  transform, padded for the current stroke width and antialiasing, and
+  collected into at most four rectangles. `export_delta/2` encodes each
+  rectangle as a standalone image and starts tracking afresh, so a client
+  holding the previous frame only needs to draw the returned patches at
+  their offsets.
+
+  A new canvas counts as fully changed, as does anything after `clear/2`
+  or a draw with a composition operator that can affect pixels outside the
+  shape (`:src_in`, `:src_out`, `:dst_in`, `:dst_atop`). Bounds are
+  conservative; a delta can cover a few more pixels than were changed.
+
+  Options:
+
+    * `:format` – `:png` (default) or `:qoi`.
+    * For `:png`, the encoder options of `to_png/2`; deltas are encoded on
+      one thread.
+
+  On success, returns `{:ok, deltas}`, an empty list when nothing was drawn.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec export_delta(t(), [{:format, :png | :qoi} | png_opt()]) ::
+          {:ok, [delta()]} | {:error, term()}
+  def export_delta(canvas, opts \\ []) do
+    {format, png_opts} = Keyword.pop(opts, :format, :png)
+    Native.canvas_export_delta(canvas, format, png_opts)
+  end
+
+  @doc """
+  Same as `export_delta/2`, but returns the deltas directly.
+
+  On success, returns a list of `t:delta/0`.
+
+  On failure, raises `Blendend.Error`.
+  """
+  @spec export_delta!(t(), [{:format, :png | :qoi} | png_opt()]) :: [delta()]
+  def export_delta!(canvas, opts \\ []) do
+    case export_delta(canvas, opts) do
+      {:ok, deltas} -> deltas
+      {:error, reason} -> raise Error.new(:canvas_export_delta, reason)
+    end
+  end
+
+  @doc """
+  Returns the regions changed since the last `export_delta/2`, without
+  encoding or resetting them.
+  """
+  @spec dirty_rects(t()) :: {:ok, [rect()]} | {:error, term()}
+  def dirty_rects(canvas), do: Native.canvas_dirty_rects(canvas)
+
   @doc """
   Encodes the canvas as a QOI image and returns the raw `.qoi` binary.
 
@@ -614,6 +843,254 @@ defmodule Blendend.Canvas do
     end
   end
 
+  @doc """
+  Returns the canvas pixels without encoding or copying them.
+
+  Pending drawing is flushed first. The result is a map with the PRGB32
+  buffer as `data` (rows of `stride` bytes, BGRA byte order with
+  premultiplied alpha on little-endian machines) plus `width`, `height`,
+  `stride` and `format`; see `t:Blendend.Image.pixels/0`.
+
+  `data` shares the canvas buffer but never changes: the canvas hands the
+  buffer over and the next drawing call continues on a copy, made only if
+  `data` is still referenced by then. Exporting a frame is therefore free,
+  and drawing the next one costs one copy while the previous frame is
+  still held. While layers, saved states (`save_state/1`) or a clip
+  (`Blendend.Canvas.Clip.to_rect/5`) are in place, `data` is a copy taken
+  right away.
+  """
+  @spec pixels(t()) :: {:ok, Blendend.Image.pixels()} | {:error, term()}
+  def pixels(canvas), do: Native.canvas_pixels(canvas)
+
+  @doc """
+  Same as `pixels/1`, but returns the map directly and raises on failure.
+  """
+  @spec pixels!(t()) :: Blendend.Image.pixels()
+  def pixels!(canvas) do
+    case pixels(canvas) do
+      {:ok, pixels} -> pixels
+      {:error, reason} -> raise Error.new(:canvas_pixels, reason)
+    end
+  end
+
+  @doc """
+  Returns a new canvas holding a copy of the pixels of `canvas`.
+
+  Pending drawing is flushed first. The copy uses the same `new/3` options
+  (worker threads) but starts with a fresh rendering state: identity
+  transform, no clip and no saved states. Render a static background once,
+  then clone it for every frame or request instead of drawing it again.
+
+  On success, returns `{:ok, canvas}`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec clone(t()) :: {:ok, t()} | {:error, term()}
+  def clone(canvas), do: Native.canvas_clone(canvas)
+
+  @doc """
+  Same as `clone/1`, but returns the canvas directly and raises on failure.
+  """
+  @spec clone!(t()) :: t()
+  def clone!(canvas) do
+    case clone(canvas) do
+      {:ok, copy} -> copy
+      {:error, reason} -> raise Error.new(:canvas_clone, reason)
+    end
+  end
+
+  @doc """
+  Copies the current pixels of `canvas` into a `Blendend.Image`, without
+  going through an encoded format.
+
+  The image is a snapshot: later drawing on the canvas does not change it.
+  It can be used wherever images are taken, such as `blit_image/4` or
+  `Blendend.Style.Pattern.create/1`.
+
+  Options:
+
+    * `:format` – `:prgb32` (default) for a color image, or `:a8` for just
+      the alpha channel, as a mask for `Blendend.Canvas.Mask.fill/5`.
+
+  On success, returns `{:ok, image}`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec to_image(t(), [{:format, :prgb32 | :a8}]) :: {:ok, Blendend.Image.t()} | {:error, term()}
+  def to_image(canvas, opts \\ []) do
+    Native.canvas_to_image(canvas, Keyword.get(opts, :format, :prgb32))
+  end
+
+  @doc """
+  Same as `to_image/2`, but returns the image directly and raises on failure.
+  """
+  @spec to_image!(t(), [{:format, :prgb32 | :a8}]) :: Blendend.Image.t()
+  def to_image!(canvas, opts \\ []) do
+    case to_image(canvas, opts) do
+      {:ok, image} -> image
+      {:error, reason} -> raise Error.new(:canvas_to_image, reason)
+    end
+  end
+
+  @doc """
+  Starts an offscreen layer covering `{x, y, width, height}` canvas pixels.
+
+  Until the matching `end_layer/2`, everything drawn on `canvas` goes into
+  a transparent surface instead, with the current transform and fill rule
+  carried over, so shapes land where they would have on the canvas.
+  `end_layer/2` then composites the whole group at once. This gives
+  overlapping shapes one group opacity instead of showing through each
+  other, and lets a group be blended with a single `:comp_op`.
+
+  Layer surfaces come from a pool shared by all canvases and reused across
+  calls, so short-lived layers do not allocate. Layers nest; drawing outside
+  the bounds is clipped. `pixels/1`, `to_png/2` and the other exports see
+  the canvas without the open layers.
+
+  Options:
+
+    * `:format` – `:prgb32` (default) for a color layer, or `:a8` to only
+      record coverage, which `end_layer/2` paints with its `:fill`.
+
+  On success, returns `:ok`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec begin_layer(t(), {integer(), integer(), pos_integer(), pos_integer()}, [
+          {:format, :prgb32 | :a8}
+        ]) :: :ok | {:error, term()}
+  def begin_layer(canvas, {x, y, w, h}, opts \\ []) do
+    Native.canvas_begin_layer(canvas, x, y, w, h, Keyword.get(opts, :format, :prgb32))
+  end
+
+  @doc """
+  Same as `begin_layer/3`, but returns the canvas.
+
+  On success, returns `canvas`.
+
+  On failure, raises `Blendend.Error`.
+  """
+  @spec begin_layer!(t(), {integer(), integer(), pos_integer(), pos_integer()}, [
+          {:format, :prgb32 | :a8}
+        ]) :: t()
+  def begin_layer!(canvas, bounds, opts \\ []) do
+    case begin_layer(canvas, bounds, opts) do
+      :ok -> canvas
+      {:error, reason} -> raise Error.new(:canvas_begin_layer, reason)
+    end
+  end
+
+  @doc """
+  Ends the innermost layer started by `begin_layer/3` and composites it onto
+  what lies below.
+
+  Takes the usual style options; the ones that apply are `:alpha` (group
+  opacity), `:comp_op` and, for `:a8` layers, `:fill`.
+
+  On success, returns `:ok`.
+
+  On failure, returns `{:error, reason}`; `:canvas_end_layer_no_layer` if
+  no layer is open.
+  """
+  @spec end_layer(t(), keyword()) :: :ok | {:error, term()}
+  def end_layer(canvas, opts \\ []), do: Native.canvas_end_layer(canvas, opts)
+
+  @doc """
+  Same as `end_layer/2`, but returns the canvas.
+
+  On success, returns `canvas`.
+
+  On failure, raises `Blendend.Error`.
+  """
+  @spec end_layer!(t(), keyword()) :: t()
+  def end_layer!(canvas, opts \\ []) do
+    case end_layer(canvas, opts) do
+      :ok -> canvas
+      {:error, reason} -> raise Error.new(:canvas_end_layer, reason)
+    end
+  end
+
+  @typedoc "The shape `fill_instances/4` repeats."
+  @type instance_shape ::
+          {:circle, number()} | {:rect, number(), number()} | Blendend.Path.t()
+
+  @doc """
+  Fills `shape` once at every point of `positions`, in one call.
+
+  Scatter plots and particle systems draw thousands of the same mark. Doing
+  that with `Blendend.Canvas.Fill.circle/5` parses the style and saves the
+  canvas state once per mark. Here the style is set up once and the marks
+  are drawn in a native loop.
+
+  `shape` is `{:circle, r}` or `{:rect, w, h}`, centered on each position,
+  or a `Blendend.Path` drawn with its origin at each position. `positions`
+  is a list of `{x, y}` tuples or packed points, as for
+  `Blendend.Canvas.Fill.polygon/3`.
+
+  Options, each a binary with one entry per instance:
+
+    * `:scales` – native-endian f64 scale factors.
+    * `:rotations` – native-endian f64 angles in radians. Circles ignore
+      them.
+    * `:colors` – 4 bytes `r, g, b, a` (not premultiplied). They replace
+      `:fill`.
+
+  Other options are the style options of `Blendend.Canvas.Fill.path/3`.
+  Runs of instances with one opaque solid color are merged and filled
+  together when the composition is `:src_over` and there is no `:alpha`.
+  The result is visually equivalent to drawing them one by one, but may
+  differ on anti-aliased edges where instances overlap: a merged run
+  covers each edge pixel once instead of blending it once per instance.
+  Instances with a non-finite position, scale or rotation are skipped.
+
+  On success, returns `:ok`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec fill_instances(
+          t(),
+          instance_shape(),
+          [{number(), number()}] | Blendend.Canvas.Fill.packed(),
+          keyword()
+        ) :: :ok | {:error, term()}
+  def fill_instances(canvas, shape, positions, opts \\ []) do
+    {instance_opts, style_opts} = Keyword.split(opts, [:scales, :rotations, :colors])
+
+    Native.canvas_fill_instances(
+      canvas,
+      instance_shape(shape),
+      positions,
+      instance_opts[:scales],
+      instance_opts[:rotations],
+      instance_opts[:colors],
+      style_opts
+    )
+  end
+
+  @doc """
+  Same as `fill_instances/4`, but returns the canvas.
+
+  On success, returns `canvas`.
+
+  On failure, raises `Blendend.Error`.
+  """
+  @spec fill_instances!(
+          t(),
+          instance_shape(),
+          [{number(), number()}] | Blendend.Canvas.Fill.packed(),
+          keyword()
+        ) :: t()
+  def fill_instances!(canvas, shape, positions, opts \\ []) do
+    case fill_instances(canvas, shape, positions, opts) do
+      :ok -> canvas
+      {:error, reason} -> raise Error.new(:canvas_fill_instances, reason)
+    end
+  end
+
+  defp instance_shape({:circle, r}), do: {:circle, r * 1.0}
+  defp instance_shape({:rect, w, h}), do: {:rect, w * 1.0, h * 1.0}
+  defp instance_shape(path), do: path
+
   # ===========================================================================
   # Matrix helpers
   # ===========================================================================
@@ -19,7 +19,14 @@ defmodule Blendend.Canvas.Fill do
   alias Blendend.{Native, Error}
 
   @type canvas :: Blendend.Canvas.t()
-  @type opts :: keyword()
+  @type opts :: keyword() | Blendend.Style.t()
+
+  @typedoc """
+  A list of tuples, or the same numbers packed as native-endian floats:
+  a binary of f64 values, or `{:f32, binary}` for f32 values. Packed input
+  is read in place by the NIF instead of being decoded term by term.
+  """
+  @type packed :: binary() | {:f32, binary()}
 
   @doc """
   Fills `path` on `canvas` using the given style options.
@@ -399,11 +406,12 @@ defmodule Blendend.Canvas.Fill do
   end
 
   @doc """
-  Fills a polygon from a list of `{x, y}` points.
+  Fills a polygon from a list of `{x, y}` points
+  or packed `x, y` pairs (see `t:packed/0`).
 
   Uses the same style options as `path/3`.
   """
-  @spec polygon(canvas(), [{number(), number()}], opts()) ::
+  @spec polygon(canvas(), [{number(), number()}] | packed(), opts()) ::
           :ok | {:error, term()}
   def polygon(canvas, points, opts \\ []) do
     Native.canvas_fill_polygon(canvas, points, opts)
@@ -412,7 +420,7 @@ defmodule Blendend.Canvas.Fill do
   @doc """
   Same as `polygon/3`, but returns the canvas and raises on error.
   """
-  @spec polygon!(canvas(), [{number(), number()}], opts()) :: canvas()
+  @spec polygon!(canvas(), [{number(), number()}] | packed(), opts()) :: canvas()
   def polygon!(canvas, points, opts \\ []) do
     case polygon(canvas, points, opts) do
       :ok -> canvas
@@ -423,11 +431,12 @@ defmodule Blendend.Canvas.Fill do
   @doc """
   Fills multiple boxes in one call.
 
-  `boxes` is a list of `{x0, y0, x1, y1}` tuples.
+  `boxes` is a list of `{x0, y0, x1, y1}` tuples or packed
+  quadruples (see `t:packed/0`).
 
   Uses the same style options as `path/3`.
   """
-  @spec box_array(canvas(), [{number(), number(), number(), number()}], opts()) ::
+  @spec box_array(canvas(), [{number(), number(), number(), number()}] | packed(), opts()) ::
           :ok | {:error, term()}
   def box_array(canvas, boxes, opts \\ []) do
     Native.canvas_fill_box_array(canvas, boxes, opts)
@@ -436,7 +445,8 @@ defmodule Blendend.Canvas.Fill do
   @doc """
   Same as `box_array/3`, but returns the canvas and raises on error.
   """
-  @spec box_array!(canvas(), [{number(), number(), number(), number()}], opts()) :: canvas()
+  @spec box_array!(canvas(), [{number(), number(), number(), number()}] | packed(), opts()) ::
+          canvas()
   def box_array!(canvas, boxes, opts \\ []) do
     case box_array(canvas, boxes, opts) do
       :ok -> canvas
@@ -447,11 +457,12 @@ defmodule Blendend.Canvas.Fill do
   @doc """
   Fills multiple rectangles in one call.
 
-  `rects` is a list of `{x, y, w, h}` tuples.
+  `rects` is a list of `{x, y, w, h}` tuples or packed
+  quadruples (see `t:packed/0`).
 
   Uses the same style options as `path/3`.
   """
-  @spec rect_array(canvas(), [{number(), number(), number(), number()}], opts()) ::
+  @spec rect_array(canvas(), [{number(), number(), number(), number()}] | packed(), opts()) ::
           :ok | {:error, term()}
   def rect_array(canvas, rects, opts \\ []) do
     Native.canvas_fill_rect_array(canvas, rects, opts)
@@ -460,7 +471,8 @@ defmodule Blendend.Canvas.Fill do
   @doc """
   Same as `rect_array/3`, but returns the canvas and raises on error.
   """
-  @spec rect_array!(canvas(), [{number(), number(), number(), number()}], opts()) :: canvas()
+  @spec rect_array!(canvas(), [{number(), number(), number(), number()}] | packed(), opts()) ::
+          canvas()
   def rect_array!(canvas, rects, opts \\ []) do
     case rect_array(canvas, rects, opts) do
       :ok -> canvas
@@ -19,7 +19,14 @@ defmodule Blendend.Canvas.Stroke do
   alias Blendend.{Native, Error}
 
   @type canvas :: Blendend.Canvas.t()
-  @type opts :: keyword()
+  @type opts :: keyword() | Blendend.Style.t()
+
+  @typedoc """
+  A list of tuples, or the same numbers packed as native-endian floats:
+  a binary of f64 values, or `{:f32, binary}` for f32 values. Packed input
+  is read in place by the NIF instead of being decoded term by term.
+  """
+  @type packed :: binary() | {:f32, binary()}
 
   # ===========================================================================
   # Path
@@ -448,11 +455,12 @@ defmodule Blendend.Canvas.Stroke do
   end
 
   @doc """
-  Strokes a polyline given as a list of `{x, y}` points.
+  Strokes a polyline given as a list of `{x, y}` points
+  or packed `x, y` pairs (see `t:packed/0`).
 
   Uses the same stroke options as `path/3`.
   """
-  @spec polyline(canvas(), [{number(), number()}], opts()) ::
+  @spec polyline(canvas(), [{number(), number()}] | packed(), opts()) ::
           :ok | {:error, term()}
   def polyline(canvas, points, opts \\ []) do
     Native.canvas_stroke_polyline(canvas, points, opts)
@@ -461,7 +469,7 @@ defmodule Blendend.Canvas.Stroke do
   @doc """
   Same as `polyline/3`, but returns the canvas and raises on error.
   """
-  @spec polyline!(canvas(), [{number(), number()}], opts()) :: canvas()
+  @spec polyline!(canvas(), [{number(), number()}] | packed(), opts()) :: canvas()
   def polyline!(canvas, points, opts \\ []) do
     case polyline(canvas, points, opts) do
       :ok -> canvas
@@ -470,11 +478,12 @@ defmodule Blendend.Canvas.Stroke do
   end
 
   @doc """
-  Strokes a closed polygon given as a list of `{x, y}` points.
+  Strokes a closed polygon given as a list of `{x, y}` points
+  or packed `x, y` pairs (see `t:packed/0`).
 
   Uses the same stroke options as `path/3`.
   """
-  @spec polygon(canvas(), [{number(), number()}], opts()) ::
+  @spec polygon(canvas(), [{number(), number()}] | packed(), opts()) ::
           :ok | {:error, term()}
   def polygon(canvas, points, opts \\ []) do
     Native.canvas_stroke_polygon(canvas, points, opts)
@@ -483,7 +492,7 @@ defmodule Blendend.Canvas.Stroke do
   @doc """
   Same as `polygon/3`, but returns the canvas and raises on error.
   """
-  @spec polygon!(canvas(), [{number(), number()}], opts()) :: canvas()
+  @spec polygon!(canvas(), [{number(), number()}] | packed(), opts()) :: canvas()
   def polygon!(canvas, points, opts \\ []) do
     case polygon(canvas, points, opts) do
       :ok -> canvas
@@ -494,11 +503,12 @@ defmodule Blendend.Canvas.Stroke do
   @doc """
   Strokes multiple boxes in one call.
 
-  `boxes` is a list of `{x0, y0, x1, y1}` tuples.
+  `boxes` is a list of `{x0, y0, x1, y1}` tuples or packed
+  quadruples (see `t:packed/0`).
 
   Uses the same stroke options as `path/3`.
   """
-  @spec box_array(canvas(), [{number(), number(), number(), number()}], opts()) ::
+  @spec box_array(canvas(), [{number(), number(), number(), number()}] | packed(), opts()) ::
           :ok | {:error, term()}
   def box_array(canvas, boxes, opts \\ []) do
     Native.canvas_stroke_box_array(canvas, boxes, opts)
@@ -507,7 +517,8 @@ defmodule Blendend.Canvas.Stroke do
   @doc """
   Same as `box_array/3`, but returns the canvas and raises on error.
   """
-  @spec box_array!(canvas(), [{number(), number(), number(), number()}], opts()) :: canvas()
+  @spec box_array!(canvas(), [{number(), number(), number(), number()}] | packed(), opts()) ::
+          canvas()
   def box_array!(canvas, boxes, opts \\ []) do
     case box_array(canvas, boxes, opts) do
       :ok -> canvas
@@ -518,11 +529,12 @@ defmodule Blendend.Canvas.Stroke do
   @doc """
   Strokes multiple rectangles in one call.
 
-  `rects` is a list of `{x, y, w, h}` tuples.
+  `rects` is a list of `{x, y, w, h}` tuples or packed
+  quadruples (see `t:packed/0`).
 
   Uses the same stroke options as `path/3`.
   """
-  @spec rect_array(canvas(), [{number(), number(), number(), number()}], opts()) ::
+  @spec rect_array(canvas(), [{number(), number(), number(), number()}] | packed(), opts()) ::
           :ok | {:error, term()}
   def rect_array(canvas, rects, opts \\ []) do
     Native.canvas_stroke_rect_array(canvas, rects, opts)
@@ -531,7 +543,8 @@ defmodule Blendend.Canvas.Stroke do
   @doc """
   Same as `rect_array/3`, but returns the canvas and raises on error.
   """
-  @spec rect_array!(canvas(), [{number(), number(), number(), number()}], opts()) :: canvas()
+  @spec rect_array!(canvas(), [{number(), number(), number(), number()}] | packed(), opts()) ::
+          canvas()
   def rect_array!(canvas, rects, opts \\ []) do
     case rect_array(canvas, rects, opts) do
       :ok -> canvas
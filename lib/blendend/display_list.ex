@@ -0,0 +1,155 @@
+defmodule Blendend.DisplayList do
+  @moduledoc """
+  A recorded scene that is replayed natively, at any transform, without
+  going back through Elixir.
+
+  `Blendend.Canvas.exec/2` saves most of the per-call overhead, but the
+  batch is still encoded and its resources resolved on every render. A
+  display list is built from a `Blendend.Draw.Batch` once; it owns a copy of
+  the ops, keeps the colors, gradients, patterns and fonts it refers to
+  alive and snapshots its paths, so later changes to a path do not affect
+  it. Replaying it is a single NIF call:
+
+      alias Blendend.Draw.Batch
+
+      {:ok, dashboard} =
+        Blendend.DisplayList.new(fn batch ->
+          batch
+          |> Batch.rect(0, 0, 800, 600, fill: background)
+          |> Batch.fill_path(chart, fill: accent)
+        end)
+
+      :ok = Blendend.DisplayList.replay(canvas_1x, dashboard)
+      :ok = Blendend.DisplayList.replay(canvas_2x, dashboard, transform: {2.0, 0.0, 0.0, 2.0, 0.0, 0.0})
+
+  The bounds of every draw op are computed when the list is built. A replay
+  skips the ops whose bounds end up outside the canvas or the `:clip`
+  rectangle without decoding them, so drawing a zoomed-in part of a large
+  scene only pays for what is visible.
+
+  Lists are immutable and may be replayed from several processes at once.
+  """
+
+  alias Blendend.{Canvas, Error, Matrix2D, Native}
+  alias Blendend.Draw.Batch
+
+  @typedoc "Opaque display list resource."
+  @opaque t :: reference()
+
+  @typedoc """
+  An affine matrix `{m00, m01, m10, m11, m20, m21}`, as taken by
+  `Blendend.Draw.Batch.transform/2`, or a `Blendend.Matrix2D`.
+  """
+  @type transform :: {number(), number(), number(), number(), number(), number()} | Matrix2D.t()
+
+  @typedoc "Options for `replay/3`."
+  @type replay_opt ::
+          {:transform, transform()} | {:clip, {number(), number(), number(), number()}}
+
+  @doc """
+  Builds a display list from `scene`, a `Blendend.Draw.Batch` or a function
+  that receives an empty batch and returns the recorded one.
+
+  On success, returns `{:ok, list}`.
+
+  On failure, returns `{:error, reason}` or, for an op that could not be
+  decoded, `{:error, {reason, offset}}` as `Blendend.Canvas.exec/2` does.
+  """
+  @spec new(Batch.t() | (Batch.t() -> Batch.t())) :: {:ok, t()} | {:error, term()}
+  def new(scene) when is_function(scene, 1), do: new(scene.(Batch.new()))
+
+  def new(%Batch{} = batch) do
+    {ops, refs} = Batch.encode(batch)
+    Native.display_list_new(ops, refs)
+  end
+
+  @doc """
+  Same as `new/1`, but returns the list directly and raises on failure.
+  """
+  @spec new!(Batch.t() | (Batch.t() -> Batch.t())) :: t()
+  def new!(scene) do
+    case new(scene) do
+      {:ok, list} -> list
+      {:error, reason} -> raise Error.new(:display_list_new, reason)
+    end
+  end
+
+  @doc """
+  Returns the box `{x0, y0, x1, y1}` covered by the list's draw ops in its
+  own coordinates, including stroke widths. Useful to pick the transform
+  that fits a scene into a thumbnail.
+
+  On success, returns `{:ok, box}`; an empty list covers `{0.0, 0.0, 0.0, 0.0}`.
+
+  On failure, returns `{:error, reason}`; `:display_list_bounds_unbounded`
+  if an op has no finite extent, such as a `:src_in` composition.
+  """
+  @spec bounds(t()) :: {:ok, {float(), float(), float(), float()}} | {:error, term()}
+  def bounds(list), do: Native.display_list_bounds(list)
+
+  @doc """
+  Same as `bounds/1`, but returns the box directly and raises on failure.
+  """
+  @spec bounds!(t()) :: {float(), float(), float(), float()}
+  def bounds!(list) do
+    case bounds(list) do
+      {:ok, box} -> box
+      {:error, reason} -> raise Error.new(:display_list_bounds, reason)
+    end
+  end
+
+  @doc """
+  Draws `list` on `canvas`.
+
+  The list is drawn in the canvas' current user space, as
+  `Blendend.Canvas.exec/2` would draw the batch. The canvas state is
+  restored afterwards.
+
+  Options:
+
+    * `:transform` – applied on top of the canvas' transform before the
+      list is drawn. Transforms recorded in the list, `set_transform/2` and
+      `reset_transform/1` included, stay relative to it.
+    * `:clip` – `{x, y, w, h}` in the canvas' current user space. Drawing is
+      clipped to it and ops entirely outside it are skipped.
+
+  On success, returns `:ok`.
+
+  On failure, returns `{:error, reason}` or `{:error, {reason, offset}}` for
+  an op that could not be drawn.
+  """
+  @spec replay(Canvas.t(), t(), [replay_opt()]) :: :ok | {:error, term()}
+  def replay(canvas, list, opts \\ []) do
+    Native.display_list_replay(
+      canvas,
+      list,
+      transform_tuple(Keyword.get(opts, :transform)),
+      clip_tuple(Keyword.get(opts, :clip))
+    )
+  end
+
+  @doc """
+  Same as `replay/3`, but returns the canvas.
+
+  On success, returns `canvas`.
+
+  On failure, raises `Blendend.Error`.
+  """
+  @spec replay!(Canvas.t(), t(), [replay_opt()]) :: Canvas.t()
+  def replay!(canvas, list, opts \\ []) do
+    case replay(canvas, list, opts) do
+      :ok -> canvas
+      {:error, reason} -> raise Error.new(:display_list_replay, reason)
+    end
+  end
+
+  defp transform_tuple(nil), do: nil
+
+  defp transform_tuple({_, _, _, _, _, _} = m),
+    do: m |> Tuple.to_list() |> Enum.map(&(&1 * 1.0)) |> List.to_tuple()
+
+  defp transform_tuple(m), do: m |> Matrix2D.to_list!() |> List.to_tuple()
+
+  defp clip_tuple(nil), do: nil
+  defp clip_tuple({x, y, w, h}), do: {x * 1.0, y * 1.0, w * 1.0, h * 1.0}
+end
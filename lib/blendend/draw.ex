@@ -93,24 +93,39 @@ defmodule Blendend.Draw do
   defp to_f(v) when is_float(v), do: v
   defp to_f(v), do: v
 
-  defp to_f_points(points) do
+  # Packed binaries (`<<x::float-native-64, ...>>` or `{:f32, bin}`) go to
+  # the NIFs untouched.
+  defp to_f_points(points) when is_list(points) do
     Enum.map(points, fn {x, y} -> {to_f(x), to_f(y)} end)
   end
 
-  defp to_f_boxes(boxes) do
+  defp to_f_points(packed), do: packed
+
+  defp to_f_boxes(boxes) when is_list(boxes) do
     Enum.map(boxes, fn {x0, y0, x1, y1} ->
       {to_f(x0), to_f(y0), to_f(x1), to_f(y1)}
     end)
   end
 
-  defp to_f_rects(rects) do
+  defp to_f_boxes(packed), do: packed
+
+  defp to_f_rects(rects) when is_list(rects) do
     Enum.map(rects, fn {x, y, w, h} ->
       {to_f(x), to_f(y), to_f(w), to_f(h)}
     end)
   end
 
+  defp to_f_rects(packed), do: packed
+
   # fill vs stroke for shapes that support both
   @doc false
+  def classify_mode(style) when is_reference(style) do
+    case Blendend.Native.style_mode(style) do
+      :stroke -> {:stroke, style}
+      _ -> {:fill, style}
+    end
+  end
+
   def classify_mode(opts) do
     mode = Keyword.get(opts, :mode)
     opts = Keyword.drop(opts, [:mode])
@@ -1371,6 +1386,30 @@ defmodule Blendend.Draw do
     end
   end
 
+  # ------------------------------------------------------------------
+  # Batches
+  # ------------------------------------------------------------------
+
+  @doc """
+  Replays a `Blendend.Draw.Batch` on the current canvas in one NIF call.
+
+  Use it for scenes with many small shapes, where per-call overhead of
+  `circle/4`, `rect/5`, ... outweighs the rasterization itself:
+
+      draw 800, 600 do
+        points
+        |> Enum.reduce(Blendend.Draw.Batch.new(), fn {x, y}, b ->
+          Blendend.Draw.Batch.circle(b, x, y, 2, fill: rgb(30, 120, 220))
+        end)
+        |> exec()
+      end
+  """
+  def exec(%Blendend.Draw.Batch{} = batch) do
+    c = get_canvas()
+    Blendend.Canvas.exec!(c, batch)
+    :ok
+  end
+
   # ------------------------------------------------------------------
   # Effects
   # ------------------------------------------------------------------
@@ -0,0 +1,450 @@
+defmodule Blendend.Draw.Batch do
+  @moduledoc """
+  Records draw calls into a compact command buffer that is replayed on a
+  canvas with a single NIF call.
+
+  Every call in `Blendend.Canvas.Fill`, `Blendend.Canvas.Stroke` or the
+  `Blendend.Draw` helpers is one NIF round-trip: the canvas is resolved, the
+  style keyword list is parsed and the context state is saved and restored.
+  For scenes with tens of thousands of small shapes (scatter plots, particle
+  systems) that overhead dominates the actual rasterization. A batch encodes
+  the same calls into one binary and replays them in one go:
+
+      alias Blendend.Draw.Batch
+
+      dot = Blendend.Style.Color.rgb!(30, 120, 220)
+
+      batch =
+        Enum.reduce(points, Batch.new(), fn {x, y}, batch ->
+          Batch.circle(batch, x, y, 2.0, fill: dot)
+        end)
+
+      :ok = Blendend.Canvas.exec(canvas, batch)
+
+  Inside a `Blendend.Draw.draw/3` block use `Blendend.Draw.exec/1`.
+
+  Shape functions accept the same style options as the `Blendend.Draw` shape
+  helpers (`:fill`, `:stroke`, `:stroke_width`, caps/joins, `:alpha`,
+  `:stroke_alpha`, `:comp_op`, `:mode`). A style is only re-encoded when it
+  differs from the previous shape's style, so runs of identically styled
+  shapes cost one opcode and their coordinates.
+
+  Transforms (`translate/3`, `rotate/2`, ...) persist for the rest of the
+  batch, like the canvas functions they mirror; use `save/1` and `restore/1`
+  to scope them. Nothing leaks out of a replay: the canvas state is restored
+  after the last op.
+  """
+
+  alias Blendend.Draw
+
+  defstruct ops: [], refs: %{}, ref_list: [], ref_count: 0, style: nil
+
+  @type t :: %__MODULE__{}
+  @type brush :: reference()
+
+  # Opcodes, see c_src/canvas/exec.h.
+  @op_save 0x01
+  @op_restore 0x02
+  @op_translate 0x10
+  @op_scale 0x11
+  @op_rotate 0x12
+  @op_rotate_at 0x13
+  @op_skew 0x14
+  @op_transform 0x15
+  @op_set_transform 0x16
+  @op_reset_transform 0x17
+  @op_style 0x20
+  @op_fill 0x40
+  @op_stroke 0x80
+
+  @shapes %{
+    rect: 1,
+    box: 2,
+    circle: 3,
+    ellipse: 4,
+    round_rect: 5,
+    triangle: 6,
+    chord: 7,
+    pie: 8,
+    line: 9,
+    arc: 10,
+    polygon: 11,
+    polyline: 12,
+    path: 13,
+    text: 14
+  }
+
+  @style_fill 0x01
+  @style_stroke 0x02
+  @style_stroke_opts 0x04
+  @style_alpha 0x08
+  @style_stroke_alpha 0x10
+  @style_comp_op 0x20
+
+  @caps [:butt, :round, :square, :round_rev, :triangle, :triangle_rev]
+  @joins [:miter_clip, :round, :bevel, :miter_bevel, :miter_round]
+  @comp_ops [
+    :src_over,
+    :src_copy,
+    :src_in,
+    :src_out,
+    :src_atop,
+    :dst_over,
+    :dst_copy,
+    :dst_in,
+    :dst_out,
+    :dst_atop,
+    :difference,
+    :multiply,
+    :screen,
+    :overlay,
+    :xor,
+    :clear,
+    :plus,
+    :minus,
+    :modulate,
+    :darken,
+    :lighten,
+    :color_dodge,
+    :color_burn,
+    :linear_burn,
+    :pin_light,
+    :hard_light,
+    :soft_light,
+    :exclusion
+  ]
+
+  @cap_codes @caps |> Enum.with_index() |> Map.new()
+  @join_codes @joins |> Enum.with_index() |> Map.new()
+  @comp_op_codes @comp_ops |> Enum.with_index() |> Map.new()
+
+  @stroke_opt_keys [
+    :stroke_width,
+    :width,
+    :stroke_cap,
+    :cap,
+    :start_cap,
+    :end_cap,
+    :stroke_join,
+    :join,
+    :stroke_miter_limit,
+    :miter_limit
+  ]
+
+  @doc "Returns an empty batch."
+  @spec new() :: t()
+  def new, do: %__MODULE__{}
+
+  @doc """
+  Returns `{ops, refs}`: the encoded ops as iodata and the tuple of resources
+  they reference. This is what `Blendend.Canvas.exec/2` passes to the NIF.
+  """
+  @spec encode(t()) :: {iodata(), tuple()}
+  def encode(%__MODULE__{ops: ops, ref_list: ref_list}) do
+    {Enum.reverse(ops), ref_list |> Enum.reverse() |> List.to_tuple()}
+  end
+
+  @doc "Returns `true` if nothing has been recorded."
+  @spec empty?(t()) :: boolean()
+  def empty?(%__MODULE__{ops: ops}), do: ops == []
+
+  # ===========================================================================
+  # State and transforms
+  # ===========================================================================
+
+  @doc "Records a context save (see `Blendend.Canvas.save_state/1`)."
+  @spec save(t()) :: t()
+  def save(batch), do: %{push(batch, <<@op_save>>) | style: nil}
+
+  # A restore brings back the style from before the save, so the shape after
+  # it must encode its style again.
+  @doc "Records a context restore (see `Blendend.Canvas.restore_state/1`)."
+  @spec restore(t()) :: t()
+  def restore(batch), do: %{push(batch, <<@op_restore>>) | style: nil}
+
+  @doc "Records `Blendend.Canvas.translate/3`."
+  @spec translate(t(), number(), number()) :: t()
+  def translate(batch, tx, ty), do: push(batch, <<@op_translate, f64(tx)::binary, f64(ty)::binary>>)
+
+  @doc "Records `Blendend.Canvas.scale/3`."
+  @spec scale(t(), number(), number()) :: t()
+  def scale(batch, sx, sy), do: push(batch, <<@op_scale, f64(sx)::binary, f64(sy)::binary>>)
+
+  @doc "Records `Blendend.Canvas.rotate/2` (radians)."
+  @spec rotate(t(), number()) :: t()
+  def rotate(batch, angle), do: push(batch, <<@op_rotate, f64(angle)::binary>>)
+
+  @doc "Records `Blendend.Canvas.rotate_at/4` (radians, around `{cx, cy}`)."
+  @spec rotate(t(), number(), number(), number()) :: t()
+  def rotate(batch, angle, cx, cy),
+    do: push(batch, <<@op_rotate_at, f64(angle)::binary, f64(cx)::binary, f64(cy)::binary>>)
+
+  @doc "Records `Blendend.Canvas.skew/3` (radians)."
+  @spec skew(t(), number(), number()) :: t()
+  def skew(batch, kx, ky), do: push(batch, <<@op_skew, f64(kx)::binary, f64(ky)::binary>>)
+
+  @doc """
+  Records `Blendend.Canvas.apply_transform/2` with the affine matrix
+  `{m00, m01, m10, m11, m20, m21}`.
+  """
+  @spec transform(t(), {number(), number(), number(), number(), number(), number()}) :: t()
+  def transform(batch, matrix), do: push(batch, <<@op_transform, matrix_bin(matrix)::binary>>)
+
+  @doc """
+  Records `Blendend.Canvas.set_transform/2` with the affine matrix
+  `{m00, m01, m10, m11, m20, m21}`.
+  """
+  @spec set_transform(t(), {number(), number(), number(), number(), number(), number()}) :: t()
+  def set_transform(batch, matrix),
+    do: push(batch, <<@op_set_transform, matrix_bin(matrix)::binary>>)
+
+  @doc "Records `Blendend.Canvas.reset_transform/1`."
+  @spec reset_transform(t()) :: t()
+  def reset_transform(batch), do: push(batch, <<@op_reset_transform>>)
+
+  # ===========================================================================
+  # Shapes
+  # ===========================================================================
+
+  @doc "Records a rectangle at `{x, y}` with size `w × h` (fill or stroke)."
+  @spec rect(t(), number(), number(), number(), number(), keyword()) :: t()
+  def rect(batch, x, y, w, h, opts \\ []), do: shape(batch, :rect, [x, y, w, h], opts)
+
+  @doc "Records a box with corners `{x0, y0}` and `{x1, y1}` (fill or stroke)."
+  @spec box(t(), number(), number(), number(), number(), keyword()) :: t()
+  def box(batch, x0, y0, x1, y1, opts \\ []), do: shape(batch, :box, [x0, y0, x1, y1], opts)
+
+  @doc "Records a circle centered at `{cx, cy}` (fill or stroke)."
+  @spec circle(t(), number(), number(), number(), keyword()) :: t()
+  def circle(batch, cx, cy, r, opts \\ []), do: shape(batch, :circle, [cx, cy, r], opts)
+
+  @doc "Records an ellipse centered at `{cx, cy}` (fill or stroke)."
+  @spec ellipse(t(), number(), number(), number(), number(), keyword()) :: t()
+  def ellipse(batch, cx, cy, rx, ry, opts \\ []),
+    do: shape(batch, :ellipse, [cx, cy, rx, ry], opts)
+
+  @doc "Records a rounded rectangle (fill or stroke)."
+  @spec round_rect(t(), number(), number(), number(), number(), number(), number(), keyword()) ::
+          t()
+  def round_rect(batch, x, y, w, h, rx, ry, opts \\ []),
+    do: shape(batch, :round_rect, [x, y, w, h, rx, ry], opts)
+
+  @doc "Records a triangle (fill or stroke)."
+  @spec triangle(t(), number(), number(), number(), number(), number(), number(), keyword()) ::
+          t()
+  def triangle(batch, x0, y0, x1, y1, x2, y2, opts \\ []),
+    do: shape(batch, :triangle, [x0, y0, x1, y1, x2, y2], opts)
+
+  @doc "Records a chord (fill or stroke); angles in radians."
+  @spec chord(t(), number(), number(), number(), number(), number(), number(), keyword()) :: t()
+  def chord(batch, cx, cy, rx, ry, start, sweep, opts \\ []),
+    do: shape(batch, :chord, [cx, cy, rx, ry, start, sweep], opts)
+
+  @doc "Records a pie (fill or stroke); angles in radians."
+  @spec pie(t(), number(), number(), number(), number(), number(), number(), keyword()) :: t()
+  def pie(batch, cx, cy, rx, ry, start, sweep, opts \\ []),
+    do: shape(batch, :pie, [cx, cy, rx, ry, start, sweep], opts)
+
+  @doc "Records a stroked line from `{x0, y0}` to `{x1, y1}`."
+  @spec line(t(), number(), number(), number(), number(), keyword()) :: t()
+  def line(batch, x0, y0, x1, y1, opts \\ []),
+    do: draw(batch, :stroke, :line, nums([x0, y0, x1, y1]), opts)
+
+  @doc "Records a stroked arc; angles in radians."
+  @spec arc(t(), number(), number(), number(), number(), number(), number(), keyword()) :: t()
+  def arc(batch, cx, cy, rx, ry, start, sweep, opts \\ []),
+    do: draw(batch, :stroke, :arc, nums([cx, cy, rx, ry, start, sweep]), opts)
+
+  @doc """
+  Records a polygon given as a list of `{x, y}` points, a packed f64
+  binary or `{:f32, binary}` (fill or stroke). Raises `ArgumentError` if a
+  packed binary does not hold whole `{x, y}` pairs.
+  """
+  @spec polygon(t(), [{number(), number()}] | Blendend.Path.packed_points(), keyword()) :: t()
+  def polygon(batch, points, opts \\ []) do
+    {mode, opts} = Draw.classify_mode(opts)
+    draw(batch, mode, :polygon, points_bin(points), opts)
+  end
+
+  @doc """
+  Records a stroked polyline given as a list of `{x, y}` points, a packed
+  f64 binary or `{:f32, binary}`. Raises `ArgumentError` if a packed binary
+  does not hold whole `{x, y}` pairs.
+  """
+  @spec polyline(t(), [{number(), number()}] | Blendend.Path.packed_points(), keyword()) :: t()
+  def polyline(batch, points, opts \\ []),
+    do: draw(batch, :stroke, :polyline, points_bin(points), opts)
+
+  @doc "Records filling a `Blendend.Path`."
+  @spec fill_path(t(), Blendend.Path.t(), keyword()) :: t()
+  def fill_path(batch, path, opts \\ []) do
+    {batch, idx} = ref(batch, path)
+    draw(batch, :fill, :path, <<idx::unsigned-native-32>>, opts)
+  end
+
+  @doc "Records stroking a `Blendend.Path`."
+  @spec stroke_path(t(), Blendend.Path.t(), keyword()) :: t()
+  def stroke_path(batch, path, opts \\ []) do
+    {batch, idx} = ref(batch, path)
+    draw(batch, :stroke, :path, <<idx::unsigned-native-32>>, opts)
+  end
+
+  @doc """
+  Records UTF-8 `text` drawn with `font` at baseline `{x, y}` (fill or stroke).
+  """
+  @spec text(t(), Blendend.Text.Font.t(), number(), number(), String.t(), keyword()) :: t()
+  def text(batch, font, x, y, text, opts \\ []) when is_binary(text) do
+    {mode, opts} = Draw.classify_mode(opts)
+    {batch, idx} = ref(batch, font)
+
+    payload =
+      <<idx::unsigned-native-32, f64(x)::binary, f64(y)::binary,
+        byte_size(text)::unsigned-native-32, text::binary>>
+
+    draw(batch, mode, :text, payload, opts)
+  end
+
+  # ===========================================================================
+  # Encoding
+  # ===========================================================================
+
+  defp shape(batch, kind, args, opts) do
+    {mode, opts} = Draw.classify_mode(opts)
+    draw(batch, mode, kind, nums(args), opts)
+  end
+
+  defp draw(batch, mode, kind, payload, opts) do
+    {batch, style} = style_bin(batch, opts)
+
+    batch =
+      if style == batch.style do
+        batch
+      else
+        %{push(batch, [@op_style, style]) | style: style}
+      end
+
+    op = Map.fetch!(@shapes, kind) + if(mode == :fill, do: @op_fill, else: @op_stroke)
+    push(batch, [op, payload])
+  end
+
+  defp push(%__MODULE__{ops: ops} = batch, op), do: %{batch | ops: [op | ops]}
+
+  defp ref(%__MODULE__{refs: refs} = batch, resource) do
+    case refs do
+      %{^resource => idx} ->
+        {batch, idx}
+
+      _ ->
+        idx = batch.ref_count
+
+        batch = %{
+          batch
+          | refs: Map.put(refs, resource, idx),
+            ref_list: [resource | batch.ref_list],
+            ref_count: idx + 1
+        }
+
+        {batch, idx}
+    end
+  end
+
+  # Mirrors parse_style/5 in c_src/styles/styles.h.
+  defp style_bin(batch, opts) do
+    stroke_opts? = Enum.any?(@stroke_opt_keys, &Keyword.has_key?(opts, &1))
+    stroke_alpha = Keyword.get(opts, :stroke_alpha)
+    stroke? = Keyword.has_key?(opts, :stroke) or stroke_opts? or stroke_alpha != nil
+
+    {alpha, stroke_alpha} =
+      case {Keyword.get(opts, :alpha), stroke?} do
+        {nil, _} -> {nil, stroke_alpha}
+        {a, true} -> {nil, stroke_alpha || a}
+        {a, false} -> {a, stroke_alpha}
+      end
+
+    {batch, fill} = brush(batch, Keyword.get(opts, :fill))
+    {batch, stroke} = brush(batch, Keyword.get(opts, :stroke))
+
+    stroke_opts =
+      if stroke_opts? do
+        cap = Keyword.get(opts, :stroke_cap, Keyword.get(opts, :cap, :butt))
+
+        <<f64(Keyword.get(opts, :stroke_width, Keyword.get(opts, :width, 1.0)))::binary,
+          f64(Keyword.get(opts, :stroke_miter_limit, Keyword.get(opts, :miter_limit, 4.0)))::binary,
+          code(@cap_codes, Keyword.get(opts, :start_cap, cap)),
+          code(@cap_codes, Keyword.get(opts, :end_cap, cap)),
+          code(@join_codes, Keyword.get(opts, :stroke_join, Keyword.get(opts, :join, :miter_clip)))>>
+      end
+
+    comp_op =
+      case Keyword.get(opts, :comp_op) do
+        nil -> nil
+        op -> <<code(@comp_op_codes, op)>>
+      end
+
+    parts = [
+      {@style_fill, fill},
+      {@style_stroke, stroke},
+      {@style_stroke_opts, stroke_opts},
+      {@style_alpha, alpha && f64(alpha)},
+      {@style_stroke_alpha, stroke_alpha && f64(stroke_alpha)},
+      {@style_comp_op, comp_op}
+    ]
+
+    {flags, body} =
+      Enum.reduce(parts, {0, <<>>}, fn
+        {_flag, nil}, acc -> acc
+        {flag, bin}, {flags, body} -> {Bitwise.bor(flags, flag), <<body::binary, bin::binary>>}
+      end)
+
+    {batch, <<flags, body::binary>>}
+  end
+
+  defp brush(batch, nil), do: {batch, nil}
+
+  defp brush(batch, resource) do
+    {batch, idx} = ref(batch, resource)
+    {batch, <<idx::unsigned-native-32>>}
+  end
+
+  defp code(codes, atom) do
+    case codes do
+      %{^atom => code} -> code
+      _ -> raise ArgumentError, "unsupported style value: #{inspect(atom)}"
+    end
+  end
+
+  defp f64(v), do: <<v * 1.0::float-native-64>>
+
+  defp nums(args), do: for(v <- args, into: <<>>, do: f64(v))
+
+  defp matrix_bin({m00, m01, m10, m11, m20, m21}), do: nums([m00, m01, m10, m11, m20, m21])
+
+  defp points_bin(packed) when is_binary(packed) do
+    if rem(byte_size(packed), 16) != 0 do
+      raise ArgumentError,
+            "packed f64 points must be 16 bytes each, got #{byte_size(packed)} bytes"
+    end
+
+    <<div(byte_size(packed), 16)::unsigned-native-32, packed::binary>>
+  end
+
+  # The exec op format only carries f64, so f32 pairs are widened here.
+  defp points_bin({:f32, packed}) when is_binary(packed) do
+    if rem(byte_size(packed), 8) != 0 do
+      raise ArgumentError,
+            "packed f32 points must be 8 bytes each, got #{byte_size(packed)} bytes"
+    end
+
+    body =
+      for <<x::float-native-32, y::float-native-32 <- packed>>,
+        into: <<>>,
+        do: <<f64(x)::binary, f64(y)::binary>>
+
+    <<div(byte_size(body), 16)::unsigned-native-32, body::binary>>
+  end
+
+  defp points_bin(points) do
+    body = for {x, y} <- points, into: <<>>, do: <<f64(x)::binary, f64(y)::binary>>
+    <<length(points)::unsigned-native-32, body::binary>>
+  end
+end
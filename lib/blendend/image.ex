@@ -13,6 +13,22 @@ defmodule Blendend.Image do
   @typedoc "Opaque image resource (pixel buffer). Load via from_file!/1 or from_data/1."
   @opaque t :: reference()
 
+  @typedoc """
+  Raw pixels as returned by `pixels/1` and `Blendend.Canvas.pixels/1`.
+
+  `data` holds `height` rows of `stride` bytes each. For `:prgb32` and
+  `:xrgb32` a pixel is a native-endian 32-bit `0xAARRGGBB` word (BGRA bytes
+  on little-endian machines); `:prgb32` is premultiplied. `:a8` is one
+  alpha byte per pixel.
+  """
+  @type pixels :: %{
+          data: binary(),
+          width: non_neg_integer(),
+          height: non_neg_integer(),
+          stride: pos_integer(),
+          format: :prgb32 | :xrgb32 | :a8
+        }
+
   alias Blendend.Native
   alias Blendend.Error
 
@@ -61,6 +77,49 @@ defmodule Blendend.Image do
   def from_data(bin) when is_binary(bin),
     do: Native.image_read_from_data(bin)
 
+  @typedoc """
+  Layout of raw pixel data passed to `from_raw/5`.
+
+    * `:prgb32`, `:xrgb32`, `:a8` – Blend2D's own layouts (see
+      `t:pixels/0`); the binary is used in place without copying.
+    * `:bgra`, `:rgba` – 8-bit channels in that byte order with straight
+      (non-premultiplied) alpha, as produced by most cameras, codecs and
+      `Nx` tensors; converted to premultiplied `:prgb32` in a single pass.
+  """
+  @type raw_format :: :prgb32 | :xrgb32 | :a8 | :bgra | :rgba
+
+  @doc """
+  Creates an image from raw, undecoded pixels.
+
+  `binary` holds `height` rows of `stride` bytes (defaults to tightly packed
+  rows, `width * bytes_per_pixel`). For the native formats the image wraps
+  the binary directly and keeps it alive; nothing is copied, so the output
+  of `pixels/1` or `Blendend.Canvas.pixels/1` round-trips for free:
+
+      %{data: data, width: w, height: h, stride: stride} = Canvas.pixels!(canvas)
+      {:ok, image} = Image.from_raw(data, w, h, :prgb32, stride)
+
+  Returns `{:error, :image_from_raw_invalid_stride}` when the binary is too
+  small for the given size and stride.
+  """
+  @spec from_raw(binary(), pos_integer(), pos_integer(), raw_format(), non_neg_integer() | nil) ::
+          {:ok, t()} | {:error, term()}
+  def from_raw(binary, width, height, format, stride \\ nil)
+      when is_binary(binary) and is_integer(width) and is_integer(height) and is_atom(format),
+      do: Native.image_from_raw(binary, width, height, format, stride || 0)
+
+  @doc """
+  Same as `from_raw/5`, but returns the image directly and raises on failure.
+  """
+  @spec from_raw!(binary(), pos_integer(), pos_integer(), raw_format(), non_neg_integer() | nil) ::
+          t()
+  def from_raw!(binary, width, height, format, stride \\ nil) do
+    case from_raw(binary, width, height, format, stride) do
+      {:ok, img} -> img
+      {:error, reason} -> raise Error.new(:image_from_raw, reason)
+    end
+  end
+
   @doc """
   Returns the image size in pixels.
 
@@ -95,6 +154,26 @@ defmodule Blendend.Image do
     end
   end
 
+  @doc """
+  Returns the pixels of `image` without copying them; see `t:pixels/0`.
+
+  `data` is a binary over the image's own buffer. Images are immutable, so
+  the binary never changes; it keeps the image alive while referenced.
+  """
+  @spec pixels(t()) :: {:ok, pixels()} | {:error, term()}
+  def pixels(image), do: Native.image_pixels(image)
+
+  @doc """
+  Same as `pixels/1`, but returns the map directly and raises on failure.
+  """
+  @spec pixels!(t()) :: pixels()
+  def pixels!(image) do
+    case pixels(image) do
+      {:ok, pixels} -> pixels
+      {:error, reason} -> raise Error.new(:image_pixels, reason)
+    end
+  end
+
   @doc """
   Same as `size/1`, but returns the `{width, height}` tuple directly.
 
@@ -57,6 +57,15 @@ defmodule Blendend.Path do
   @typedoc "Opaque path resource (sequence of lines/curves). Build via DSL or Path.*! helpers."
   @opaque t :: reference()
   @type point :: {float(), float()}
+
+  @typedoc """
+  Points packed as native-endian floats, `<<x::float-native-64, y::float-native-64, ...>>`,
+  or `{:f32, <<x::float-native-32, y::float-native-32, ...>>}`.
+
+  Binaries are read by the NIF without decoding each term, which matters
+  for inputs with hundreds of thousands of points.
+  """
+  @type packed_points :: binary() | {:f32, binary()}
   @type segment :: {point(), point()}
   @type sampled_point :: {point(), {float(), float()}}
   @type hit_class :: :in | :out | :part
@@ -1027,9 +1036,12 @@ defmodule Blendend.Path do
   @doc """
   Adds a polyline defined by `points` (`[{x, y}, ...]`).
 
+  `points` may also be a packed binary of native-endian f64 `x, y` pairs, or
+  `{:f32, binary}` with f32 pairs; see `t:packed_points/0`.
+
   Accepts the same optional `opts` as `add_circle/5`.
   """
-  @spec add_polyline(t(), [point()], keyword()) :: :ok | {:error, term()}
+  @spec add_polyline(t(), [point()] | packed_points(), keyword()) :: :ok | {:error, term()}
   def add_polyline(path, points, opts \\ []) do
     {matrix, dir} = normalize_geometry_opts(opts)
     float_points = normalize_points(points)
@@ -1039,7 +1051,7 @@ defmodule Blendend.Path do
   @doc """
   Same as `add_polyline/3`, but returns the path .
   """
-  @spec add_polyline!(t(), [point()], keyword()) :: t()
+  @spec add_polyline!(t(), [point()] | packed_points(), keyword()) :: t()
   def add_polyline!(path, points, opts \\ []) do
     case add_polyline(path, points, opts) do
       :ok -> path
@@ -1050,9 +1062,12 @@ defmodule Blendend.Path do
   @doc """
   Adds a polygon defined by `points` (`[{x, y}, ...]`).
 
+  `points` may also be a packed binary of native-endian f64 `x, y` pairs, or
+  `{:f32, binary}` with f32 pairs; see `t:packed_points/0`.
+
   Accepts the same optional `opts` as `add_circle/5`.
   """
-  @spec add_polygon(t(), [point()], keyword()) :: :ok | {:error, term()}
+  @spec add_polygon(t(), [point()] | packed_points(), keyword()) :: :ok | {:error, term()}
   def add_polygon(path, points, opts \\ []) do
     {matrix, dir} = normalize_geometry_opts(opts)
     float_points = normalize_points(points)
@@ -1062,7 +1077,7 @@ defmodule Blendend.Path do
   @doc """
   Same as `add_polygon/3`, but returns the path .
   """
-  @spec add_polygon!(t(), [point()], keyword()) :: t()
+  @spec add_polygon!(t(), [point()] | packed_points(), keyword()) :: t()
   def add_polygon!(path, points, opts \\ []) do
     case add_polygon(path, points, opts) do
       :ok -> path
@@ -1086,6 +1101,9 @@ defmodule Blendend.Path do
     {matrix, dir}
   end
 
+  defp normalize_points(packed) when is_binary(packed), do: packed
+  defp normalize_points({:f32, packed} = points) when is_binary(packed), do: points
+
   defp normalize_points(points) do
     Enum.map(points, fn
       {x, y} -> {x * 1.0, y * 1.0}
@@ -1274,6 +1292,144 @@ defmodule Blendend.Path do
     end
   end
 
+  @doc """
+  Hit-tests many points against the path in one call.
+
+  `points` is a binary of native-endian 64-bit float `x, y` pairs (as
+  produced by `<<x::float-native, y::float-native>>` per point) or a list
+  of `{x, y}` tuples. The result holds one byte per point: `0` outside,
+  `1` inside and `2` on the boundary, like `:out`, `:in` and `:part` of
+  `hit_test/4`. Non-finite points are outside.
+
+  The work is split across as many threads as there are dirty CPU
+  schedulers. For large batches the path is rasterized once onto a coarse
+  grid, and only points in cells that its outline passes through are
+  tested exactly; the result is the same.
+
+  On success, returns `{:ok, codes}`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec hit_test_many(t(), binary() | [{number(), number()}], :non_zero | :even_odd) ::
+          {:ok, binary()} | {:error, term()}
+  def hit_test_many(path, points, rule \\ :non_zero)
+
+  def hit_test_many(path, points, rule) when is_list(points) do
+    bin = for {x, y} <- points, into: <<>>, do: <<x * 1.0::float-native, y * 1.0::float-native>>
+    hit_test_many(path, bin, rule)
+  end
+
+  def hit_test_many(path, points, rule) when is_binary(points) do
+    threads = :erlang.system_info(:dirty_cpu_schedulers_online)
+    Native.path_hit_test_many(path, points, rule, threads)
+  end
+
+  @doc """
+  Same as `hit_test_many/3`, but returns the codes directly and raises on
+  failure.
+  """
+  @spec hit_test_many!(t(), binary() | [{number(), number()}], :non_zero | :even_odd) ::
+          binary()
+  def hit_test_many!(path, points, rule \\ :non_zero) do
+    case hit_test_many(path, points, rule) do
+      {:ok, codes} -> codes
+      {:error, reason} -> raise Error.new(:path_hit_test_many, reason)
+    end
+  end
+
+  # ===========================================================================
+  # Serialization
+  # ===========================================================================
+
+  @doc """
+  Serializes the path into a compact binary, in one call.
+
+  The binary is Blend2D's own command and vertex arrays behind a small
+  header, so it round-trips exactly through `from_binary/1`, curves
+  included. It can be kept in ETS or written to disk to skip rebuilding
+  large paths command by command. The layout, all numbers little-endian:
+
+    * `"BLP1"`, then the vertex count `n` as a 32-bit unsigned integer
+    * `n` command bytes (0 move, 1 on-curve, 2 quad, 3 conic, 4 cubic,
+      5 close, 6 conic weight), zero-padded to a multiple of 8 bytes
+    * `n` vertices as 64-bit float `x, y` pairs
+
+  On success, returns `{:ok, binary}`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec to_binary(t()) :: {:ok, binary()} | {:error, term()}
+  def to_binary(path), do: Native.path_to_binary(path)
+
+  @doc """
+  Same as `to_binary/1`, but returns the binary directly and raises on
+  failure.
+  """
+  @spec to_binary!(t()) :: binary()
+  def to_binary!(path) do
+    case to_binary(path) do
+      {:ok, bin} -> bin
+      {:error, reason} -> raise Error.new(:path_to_binary, reason)
+    end
+  end
+
+  @doc """
+  Creates a path from a binary produced by `to_binary/1`.
+
+  The command sequence is validated; a truncated binary or one whose
+  commands Blend2D could not have produced is rejected.
+
+  On success, returns `{:ok, path}`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec from_binary(binary()) :: {:ok, t()} | {:error, term()}
+  def from_binary(bin), do: Native.path_from_binary(bin)
+
+  @doc """
+  Same as `from_binary/1`, but returns the path directly and raises on
+  failure.
+  """
+  @spec from_binary!(binary()) :: t()
+  def from_binary!(bin) do
+    case from_binary(bin) do
+      {:ok, path} -> path
+      {:error, reason} -> raise Error.new(:path_from_binary, reason)
+    end
+  end
+
+  @doc """
+  Parses SVG path data, the `d` attribute of a `<path>` element, into a new
+  path in one call.
+
+  The full grammar is supported: `M L H V C S Q T A Z` in absolute and
+  relative (lowercase) form, implicit repeats (coordinates after a move
+  are line-tos), smooth curves reflecting the previous control point, and
+  compact numbers and arc flags such as `"a5 5 0 1010 10"` or `"1.5.5"`.
+  Arc angles are in degrees, as in SVG.
+
+      {:ok, heart} = Blendend.Path.from_svg_d("M12 21l-1.5-1.4C5.4 15 2 12 2 8.5 2 5.4 4.4 3 7.5 3z")
+
+  On success, returns `{:ok, path}`; empty data gives an empty path.
+
+  On failure, returns `{:error, {reason, offset}}` with the byte offset in
+  `d` where parsing stopped.
+  """
+  @spec from_svg_d(iodata()) :: {:ok, t()} | {:error, term()}
+  def from_svg_d(d), do: Native.path_from_svg_d(d)
+
+  @doc """
+  Same as `from_svg_d/1`, but returns the path directly and raises on
+  failure.
+  """
+  @spec from_svg_d!(iodata()) :: t()
+  def from_svg_d!(d) do
+    case from_svg_d(d) do
+      {:ok, path} -> path
+      {:error, reason} -> raise Error.new(:path_from_svg_d, reason)
+    end
+  end
+
   @doc """
   Returns `true` if two paths are *exactly* equal.
 
@@ -1315,25 +1471,96 @@ defmodule Blendend.Path do
   by `:line_to` segments.
 
   The resulting path only contains `:move_to`, `:line_to`, and `:close`
-  commands. The `tolerance` argument controls the approximation accuracy
-  (default `0.25` user units).
+  commands. The `tolerance` argument is the largest distance allowed
+  between a curve and its lines (default `0.25` user units). Each curve is
+  split into the fewest evenly spaced lines that meet it, with no
+  recursion, and the result is allocated once.
+
+  Options:
+
+    * `:threads` – how many threads may share the work on very large
+      paths, a positive integer or `:auto` for one per dirty CPU
+      scheduler. Defaults to `1`.
 
   On success returns `{:ok, new_path}`.
+
+  On failure, returns `{:error, reason}`.
   """
-  @spec flatten(t(), number()) :: {:ok, t()} | {:error, term()}
+  @spec flatten(t(), number(), [{:threads, pos_integer() | :auto}]) ::
+          {:ok, t()} | {:error, term()}
+  def flatten(path, tolerance \\ 0.25, opts \\ []) do
+    threads =
+      case Keyword.get(opts, :threads, 1) do
+        :auto -> :erlang.system_info(:dirty_cpu_schedulers_online)
+        n -> n
+      end
 
-  def flatten(path, tolerance) do
-    Native.path_flatten(path, tolerance * 1.0)
+    Native.path_flatten(path, tolerance * 1.0, threads)
   end
 
-  @spec flatten!(t(), number()) :: t()
-  def flatten!(path, tolerance \\ 0.25) do
-    case flatten(path, tolerance) do
+  @spec flatten!(t(), number(), [{:threads, pos_integer() | :auto}]) :: t()
+  def flatten!(path, tolerance \\ 0.25, opts \\ []) do
+    case flatten(path, tolerance, opts) do
       {:ok, new_path} -> new_path
       {:error, reason} -> raise Error.new(:path_flatten, reason)
     end
   end
 
+  @doc """
+  Returns a new path with fewer vertices along its straight runs.
+
+  Each figure is cut into runs of `:line_to` segments. A run ends at a
+  curve or at the end of the figure; its first and last vertex are kept,
+  and so are curves and closes. Use it on polylines that carry more detail
+  than the output can show, such as GPS tracks or sensor data, before
+  stroking or serializing them.
+
+  `algorithm` is one of:
+
+    * `:rdp` (default) – Ramer-Douglas-Peucker. No dropped vertex is more
+      than `tolerance` away from the simplified line.
+    * `:visvalingam` – Visvalingam-Whyatt. Drops the vertices whose
+      triangle with their neighbours has an area below `tolerance²`,
+      smallest first; it keeps the overall shape smoother.
+
+  `tolerance` is either a distance in user units or `:auto`. With `:auto`
+  it is `:pixel_tolerance` device pixels under `:transform`: for `:rdp` no
+  vertex then moves more than that many pixels, and for `:visvalingam` no
+  dropped triangle covers more than its square in square pixels. Options:
+
+    * `:transform` – the `t:Blendend.Matrix2D.t/0` the path will be drawn
+      with; without it user units are taken as pixels.
+    * `:pixel_tolerance` – defaults to `0.5`.
+
+  On success, returns `{:ok, new_path}`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec simplify(t(), number() | :auto, :rdp | :visvalingam, keyword()) ::
+          {:ok, t()} | {:error, term()}
+  def simplify(path, tolerance, algorithm \\ :rdp, opts \\ [])
+
+  def simplify(path, :auto, algorithm, opts) do
+    tolerance = Keyword.get(opts, :pixel_tolerance, 0.5)
+    Native.path_simplify(path, tolerance * 1.0, algorithm, Keyword.get(opts, :transform))
+  end
+
+  def simplify(path, tolerance, algorithm, _opts) do
+    Native.path_simplify(path, tolerance * 1.0, algorithm, nil)
+  end
+
+  @doc """
+  Same as `simplify/4`, but returns the new path directly and raises on
+  failure.
+  """
+  @spec simplify!(t(), number() | :auto, :rdp | :visvalingam, keyword()) :: t()
+  def simplify!(path, tolerance, algorithm \\ :rdp, opts \\ []) do
+    case simplify(path, tolerance, algorithm, opts) do
+      {:ok, new_path} -> new_path
+      {:error, reason} -> raise Error.new(:path_simplify, reason)
+    end
+  end
+
   @doc """
   Normalizes a path in-place by removing redundant vertices and simplifying its data.
 
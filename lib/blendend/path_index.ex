@@ -0,0 +1,195 @@
+defmodule Blendend.PathIndex do
+  @moduledoc """
+  A spatial index over many paths for picking and area queries.
+
+  `Blendend.Path.hit_test/4` tests one path per call. With thousands of
+  shapes on screen (map regions, chart marks) finding the one under the
+  pointer that way means one NIF call per shape. A path index keeps the
+  bounding boxes of all paths in an R-tree and answers a query in one call:
+  only the paths whose boxes contain the point are hit-tested exactly.
+
+      {:ok, index} =
+        regions
+        |> Enum.map(fn region -> {region.id, region.path} end)
+        |> Blendend.PathIndex.new()
+
+      case Blendend.PathIndex.pick(index, mouse_x, mouse_y) do
+        {:ok, nil} -> :nothing
+        {:ok, id} -> highlight(id)
+      end
+
+  Every path is stored with an integer id. The index holds a snapshot of
+  each path, so changing a path afterwards does not affect it. Results come
+  back in insertion order; when paths are drawn in that order, the last id
+  is the one on top.
+
+  The tree is packed in one go, so `insert/2` rebuilds it as a whole: add
+  paths in large batches rather than one by one. Queries from other
+  processes keep running on the previous tree during a rebuild.
+  """
+
+  alias Blendend.{Error, Native, Path}
+
+  @typedoc "Opaque path index resource."
+  @opaque t :: reference()
+
+  @type entry :: {integer(), Path.t()}
+
+  @doc """
+  Builds an index over `entries`, a list of `{id, path}` tuples.
+
+  Empty paths are accepted but can never match a query.
+
+  On success, returns `{:ok, index}`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec new([entry()]) :: {:ok, t()} | {:error, term()}
+  def new(entries \\ []), do: Native.path_index_new(entries)
+
+  @doc """
+  Same as `new/1`, but returns the index directly and raises on failure.
+  """
+  @spec new!([entry()]) :: t()
+  def new!(entries \\ []) do
+    case new(entries) do
+      {:ok, index} -> index
+      {:error, reason} -> raise Error.new(:path_index_new, reason)
+    end
+  end
+
+  @doc """
+  Adds `entries` (`{id, path}` tuples) to the index.
+
+  On success, returns `:ok`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec insert(t(), [entry()]) :: :ok | {:error, term()}
+  def insert(index, entries), do: Native.path_index_insert(index, entries)
+
+  @doc """
+  Same as `insert/2`, but returns the index.
+
+  On success, returns `index`.
+
+  On failure, raises `Blendend.Error`.
+  """
+  @spec insert!(t(), [entry()]) :: t()
+  def insert!(index, entries) do
+    case insert(index, entries) do
+      :ok -> index
+      {:error, reason} -> raise Error.new(:path_index_insert, reason)
+    end
+  end
+
+  @doc """
+  Returns the number of paths in the index, empty paths not counted.
+
+  On success, returns `{:ok, count}`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec size(t()) :: {:ok, non_neg_integer()} | {:error, term()}
+  def size(index), do: Native.path_index_size(index)
+
+  @doc """
+  Same as `size/1`, but returns the count directly and raises on failure.
+  """
+  @spec size!(t()) :: non_neg_integer()
+  def size!(index) do
+    case size(index) do
+      {:ok, count} -> count
+      {:error, reason} -> raise Error.new(:path_index_size, reason)
+    end
+  end
+
+  @doc """
+  Returns the ids of all paths that contain `(x, y)`, in insertion order.
+
+  Points on a path's boundary count as inside, as `:part` does for
+  `Blendend.Path.hit_test/4`.
+
+  Options:
+
+    * `:fill_rule` – `:non_zero` (default) or `:even_odd`.
+
+  On success, returns `{:ok, ids}`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec query_point(t(), number(), number(), [{:fill_rule, :non_zero | :even_odd}]) ::
+          {:ok, [integer()]} | {:error, term()}
+  def query_point(index, x, y, opts \\ []) do
+    rule = Keyword.get(opts, :fill_rule, :non_zero)
+    Native.path_index_query_point(index, x * 1.0, y * 1.0, rule)
+  end
+
+  @doc """
+  Same as `query_point/4`, but returns the ids directly and raises on failure.
+  """
+  @spec query_point!(t(), number(), number(), [{:fill_rule, :non_zero | :even_odd}]) ::
+          [integer()]
+  def query_point!(index, x, y, opts \\ []) do
+    case query_point(index, x, y, opts) do
+      {:ok, ids} -> ids
+      {:error, reason} -> raise Error.new(:path_index_query_point, reason)
+    end
+  end
+
+  @doc """
+  Returns the id of the last inserted path that contains `(x, y)`, the one
+  drawn on top, or `nil`. Takes the options of `query_point/4`.
+
+  On success, returns `{:ok, id_or_nil}`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec pick(t(), number(), number(), [{:fill_rule, :non_zero | :even_odd}]) ::
+          {:ok, integer() | nil} | {:error, term()}
+  def pick(index, x, y, opts \\ []) do
+    case query_point(index, x, y, opts) do
+      {:ok, ids} -> {:ok, List.last(ids)}
+      {:error, _} = error -> error
+    end
+  end
+
+  @doc """
+  Same as `pick/4`, but returns the id (or `nil`) directly and raises on
+  failure.
+  """
+  @spec pick!(t(), number(), number(), [{:fill_rule, :non_zero | :even_odd}]) ::
+          integer() | nil
+  def pick!(index, x, y, opts \\ []) do
+    case pick(index, x, y, opts) do
+      {:ok, id} -> id
+      {:error, reason} -> raise Error.new(:path_index_query_point, reason)
+    end
+  end
+
+  @doc """
+  Returns the ids of all paths whose bounding boxes intersect the rectangle
+  `{x, y, w, h}`, in insertion order. Only boxes are compared; use it to
+  find the candidates for a rubber-band selection or a viewport.
+
+  On success, returns `{:ok, ids}`.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec query_rect(t(), {number(), number(), number(), number()}) ::
+          {:ok, [integer()]} | {:error, term()}
+  def query_rect(index, {x, y, w, h}) do
+    Native.path_index_query_rect(index, x * 1.0, y * 1.0, w * 1.0, h * 1.0)
+  end
+
+  @doc """
+  Same as `query_rect/2`, but returns the ids directly and raises on failure.
+  """
+  @spec query_rect!(t(), {number(), number(), number(), number()}) :: [integer()]
+  def query_rect!(index, rect) do
+    case query_rect(index, rect) do
+      {:ok, ids} -> ids
+      {:error, reason} -> raise Error.new(:path_index_query_rect, reason)
+    end
+  end
+end
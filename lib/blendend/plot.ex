@@ -0,0 +1,58 @@
+defmodule Blendend.Plot do
+  @moduledoc """
+  Helpers for drawing large data series.
+
+  A line chart of ten million samples drawn into 2000 pixels of width
+  spends nearly all of its time on vertices that land in the same pixel
+  column. `decimate_m4/4` reduces the series natively to at most four
+  points per column, and returns them packed, ready for
+  `Blendend.Canvas.Stroke.polyline/3` or `Blendend.Path.add_polyline/3`.
+  The samples never become Elixir terms:
+
+      xs = for x <- timestamps, into: <<>>, do: <<x::float-native-64>>
+      ys = for y <- values, into: <<>>, do: <<y::float-native-64>>
+
+      {:ok, points} = Blendend.Plot.decimate_m4(xs, ys, {t0, t1}, 2000)
+      Blendend.Canvas.Stroke.polyline!(canvas, points, stroke: color)
+
+  The points stay in data coordinates; map them to the chart area with the
+  canvas transform or the `:matrix` option of `Blendend.Path.add_polyline/3`.
+  """
+
+  alias Blendend.{Error, Native}
+
+  @doc """
+  Decimates the series `xs`/`ys` for drawing `pixel_width` columns wide.
+
+  `xs` and `ys` are binaries of native-endian f64, one value per sample,
+  with `xs` in ascending order. `{x_min, x_max}` is the x span of the chart,
+  split into `pixel_width` equal columns, at most 65536. Per column, M4
+  keeps the first and the last sample, and the ones with the smallest and
+  the largest `y`; a polyline through them covers the same pixels as one
+  through the whole series. Samples outside the span or with a NaN are
+  skipped.
+
+  On success, returns `{:ok, points}`, a binary of native-endian f64
+  `(x, y)` pairs in sample order.
+
+  On failure, returns `{:error, reason}`.
+  """
+  @spec decimate_m4(binary(), binary(), {number(), number()}, pos_integer()) ::
+          {:ok, binary()} | {:error, term()}
+  def decimate_m4(xs, ys, {x_min, x_max}, pixel_width) do
+    threads = :erlang.system_info(:dirty_cpu_schedulers_online)
+    Native.plot_decimate_m4(xs, ys, x_min * 1.0, x_max * 1.0, pixel_width, threads)
+  end
+
+  @doc """
+  Same as `decimate_m4/4`, but returns the points directly and raises on
+  failure.
+  """
+  @spec decimate_m4!(binary(), binary(), {number(), number()}, pos_integer()) :: binary()
+  def decimate_m4!(xs, ys, x_range, pixel_width) do
+    case decimate_m4(xs, ys, x_range, pixel_width) do
+      {:ok, points} -> points
+      {:error, reason} -> raise Error.new(:plot_decimate_m4, reason)
+    end
+  end
+end
@@ -0,0 +1,75 @@
+defmodule Blendend.Style do
+  @moduledoc """
+  Precompiled draw styles.
+
+  Every draw call normally parses its keyword list of style options
+  (`:fill`, `:stroke`, `:stroke_width`, `:comp_op`, ...) in the NIF. When the
+  same handful of styles is reused across thousands of shapes, compile them
+  once and pass the compiled style instead of the list:
+
+      axis = Blendend.Style.compile!(stroke: Color.rgb!(90, 90, 90), stroke_width: 1.0)
+      bar = Blendend.Style.compile!(fill: Color.rgb!(30, 120, 220))
+
+      draw 800, 600 do
+        line 40, 560, 760, 560, axis
+        for {x, h} <- bars, do: rect(x, 560 - h, 12, h, bar)
+      end
+
+  A compiled style is accepted wherever a draw function of
+  `Blendend.Canvas.Fill`, `Blendend.Canvas.Stroke`, `Blendend.Canvas.clear/2`
+  or the `Blendend.Draw` shape helpers takes style options.
+  `Blendend.Draw.Batch` still takes keyword lists; it already encodes each
+  distinct style only once.
+
+  Compiled styles are immutable. They keep the colors, gradients and
+  patterns they were built from alive, but later changes to a gradient or
+  pattern (stops, transform, extend mode) are still visible, since the
+  resource itself is shared rather than copied.
+  """
+
+  alias Blendend.{Draw, Error, Native}
+
+  @typedoc "Opaque compiled style resource."
+  @opaque t :: reference()
+
+  @doc """
+  Validates `opts` and compiles them into a reusable style.
+
+  Takes the same options as the draw functions, including `mode: :fill |
+  :stroke`, which fixes the mode `Blendend.Draw` helpers use for shapes that
+  can be either. Integer values are accepted for numeric options.
+
+  Unlike a plain draw call, which ignores options with malformed values,
+  compilation fails with `{:error, :style_compile_invalid_opts}`.
+  """
+  @spec compile(keyword()) :: {:ok, t()} | {:error, term()}
+  def compile(opts) when is_list(opts) do
+    {mode, opts} = Draw.classify_mode(opts)
+
+    opts =
+      Enum.map(opts, fn
+        {key, value} when is_integer(value) -> {key, value * 1.0}
+        other -> other
+      end)
+
+    Native.style_compile(opts, mode)
+  end
+
+  @doc """
+  Same as `compile/1`, but returns the style directly and raises on failure.
+  """
+  @spec compile!(keyword()) :: t()
+  def compile!(opts) do
+    case compile(opts) do
+      {:ok, style} -> style
+      {:error, reason} -> raise Error.new(:style_compile, reason)
+    end
+  end
+
+  @doc """
+  Returns the mode (`:fill` or `:stroke`) `Blendend.Draw` helpers use for
+  this style.
+  """
+  @spec mode(t()) :: :fill | :stroke
+  def mode(style), do: Native.style_mode(style)
+end
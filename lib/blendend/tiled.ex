@@ -0,0 +1,108 @@
+defmodule Blendend.Tiled do
+  @moduledoc """
+  Renders scenes larger than memory straight to a file.
+
+  `Blendend.Canvas.new/3` allocates the whole image up front: a 40000×30000
+  poster is 4.8 GB of pixels before anything is drawn. `render/5` instead
+  takes the scene as a recorded `Blendend.Draw.Batch`, cuts the output into
+  full-width bands and, band by band, replays the batch into one reused band
+  image shifted to that band's offset. Everything outside the band is
+  clipped away by the rasterizer, and the finished rows are streamed into a
+  PNG (or raw) file before the next band is drawn. Peak memory is one band
+  plus the encoder's buffers, independent of the output height.
+
+      alias Blendend.Draw.Batch
+
+      :ok =
+        Blendend.Tiled.render("wall_map.png", 40_000, 30_000, fn batch ->
+          Enum.reduce(roads, batch, fn road, batch ->
+            Batch.stroke_path(batch, road, stroke: asphalt, stroke_width: 6.0)
+          end)
+        end)
+
+  The batch is indexed once before the first band: every draw op gets its
+  bounding box, and each band then draws only the ops whose box touches it.
+  Ops with unbounded extent, and state changes such as transforms and
+  styles, still run in every band, so taller bands still mean fewer passes.
+  """
+
+  alias Blendend.{Canvas, Error, Native}
+  alias Blendend.Draw.Batch
+
+  @typedoc """
+  Options for `render/5`; any `t:Blendend.Canvas.png_opt/0` may be given as
+  well and is applied to the PNG encoder.
+  """
+  @type opt ::
+          {:format, :png | :raw}
+          | {:tile_height, pos_integer()}
+          | {:threads, non_neg_integer()}
+          | Canvas.png_opt()
+
+  @tiled_keys [:format, :tile_height, :threads]
+
+  @doc """
+  Renders `scene` into a `width × height` image written to `path`.
+
+  `scene` is a `Blendend.Draw.Batch` or a function that receives an empty
+  batch and returns the recorded one. The image starts out transparent;
+  record a full-size rectangle first for a background.
+
+  Options:
+
+    * `:format` – `:png` (default) or `:raw`. Raw output is the canvas'
+      own pixel data, premultiplied BGRA rows of `width * 4` bytes with no
+      header, as read back by `Blendend.Image.from_raw/5` with `:prgb32`.
+    * `:tile_height` – rows rendered per band. Defaults to as many rows as
+      fit in about 16 MB.
+    * `:threads` – worker threads of each band's rendering context, as for
+      `Blendend.Canvas.new/3` (default `0`, synchronous).
+    * Encoder options of `Blendend.Canvas.to_png/2` (`:compression`,
+      `:filter`, `:fast`, `:opaque`). The PNG is streamed row by row, so
+      its `:threads` option does not apply here.
+
+  On success, returns `:ok`.
+
+  On failure, returns `{:error, reason}` or, for an op that could not be
+  replayed, `{:error, {reason, offset}}` as `Blendend.Canvas.exec/2` does.
+  No partial file is left behind.
+  """
+  @spec render(Path.t(), pos_integer(), pos_integer(), Batch.t() | (Batch.t() -> Batch.t()), [
+          opt()
+        ]) :: :ok | {:error, term()}
+  def render(path, width, height, scene, opts \\ [])
+
+  def render(path, width, height, scene, opts) when is_function(scene, 1) do
+    render(path, width, height, scene.(Batch.new()), opts)
+  end
+
+  def render(path, width, height, %Batch{} = batch, opts) do
+    {tiled, png_opts} = Keyword.split(opts, @tiled_keys)
+    {ops, refs} = Batch.encode(batch)
+
+    Native.tiled_render(
+      IO.chardata_to_string(path),
+      width,
+      height,
+      ops,
+      refs,
+      Keyword.get(tiled, :format, :png),
+      Keyword.get(tiled, :tile_height, 0),
+      Keyword.get(tiled, :threads, 0),
+      png_opts
+    )
+  end
+
+  @doc """
+  Same as `render/5`, but returns `:ok` or raises `Blendend.Error`.
+  """
+  @spec render!(Path.t(), pos_integer(), pos_integer(), Batch.t() | (Batch.t() -> Batch.t()), [
+          opt()
+        ]) :: :ok
+  def render!(path, width, height, scene, opts \\ []) do
+    case render(path, width, height, scene, opts) do
+      :ok -> :ok
+      {:error, reason} -> raise Error.new(:tiled_render, reason)
+    end
+  end
+end
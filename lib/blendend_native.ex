@@ -8,6 +8,7 @@ defmodule Blendend.Native do
   end
 
   def canvas_new(_w, _h), do: :erlang.nif_error(:nif_not_loaded)
+  def canvas_new(_w, _h, _opts), do: :erlang.nif_error(:nif_not_loaded)
   def canvas_save(_canvas, _path), do: :erlang.nif_error(:nif_not_loaded)
 
   def canvas_size(_canvas), do: :erlang.nif_error(:nif_not_loaded)
@@ -52,13 +53,43 @@ defmodule Blendend.Native do
   def canvas_set_fill_rule(_canvas, _rule), do: :erlang.nif_error(:nif_not_loaded)
 
   def canvas_to_png_base64(_canvas), do: :erlang.nif_error(:nif_not_loaded)
+  def canvas_to_png_base64(_canvas, _opts), do: :erlang.nif_error(:nif_not_loaded)
   def canvas_to_png(_canvas), do: :erlang.nif_error(:nif_not_loaded)
+  def canvas_to_png(_canvas, _opts), do: :erlang.nif_error(:nif_not_loaded)
   def canvas_to_qoi(_canvas), do: :erlang.nif_error(:nif_not_loaded)
+
+  def canvas_write_file(_canvas, _path, _format, _sync, _png_opts),
+    do: :erlang.nif_error(:nif_not_loaded)
+
+  def canvas_dirty_rects(_canvas), do: :erlang.nif_error(:nif_not_loaded)
+  def canvas_export_delta(_canvas, _format, _png_opts), do: :erlang.nif_error(:nif_not_loaded)
+
+  def canvas_pixels(_canvas), do: :erlang.nif_error(:nif_not_loaded)
+  def canvas_clone(_canvas), do: :erlang.nif_error(:nif_not_loaded)
+  def canvas_to_image(_canvas, _format), do: :erlang.nif_error(:nif_not_loaded)
+  def canvas_begin_layer(_canvas, _x, _y, _w, _h, _format), do: :erlang.nif_error(:nif_not_loaded)
+  def canvas_end_layer(_canvas, _opts \\ []), do: :erlang.nif_error(:nif_not_loaded)
+
+  def canvas_fill_instances(_canvas, _shape, _positions, _scales, _rotations, _colors, _opts),
+    do: :erlang.nif_error(:nif_not_loaded)
+
   def canvas_blit_image(_c, _img, _x, _y), do: :erlang.nif_error(:nif_not_loaded)
 
   def canvas_blit_image_scaled(_c, _img, _x, _y, _w, _h),
     do: :erlang.nif_error(:nif_not_loaded)
 
+  def canvas_exec(_canvas, _ops), do: :erlang.nif_error(:nif_not_loaded)
+  def canvas_exec(_canvas, _ops, _refs), do: :erlang.nif_error(:nif_not_loaded)
+
+  def tiled_render(_path, _w, _h, _ops, _refs, _format, _tile_height, _threads, _png_opts),
+    do: :erlang.nif_error(:nif_not_loaded)
+
+  def display_list_new(_ops, _refs), do: :erlang.nif_error(:nif_not_loaded)
+  def display_list_bounds(_list), do: :erlang.nif_error(:nif_not_loaded)
+
+  def display_list_replay(_canvas, _list, _transform, _clip),
+    do: :erlang.nif_error(:nif_not_loaded)
+
   # ------------------------
   # Image
   # ------------------------
@@ -68,6 +99,15 @@ defmodule Blendend.Native do
   def image_get_pixel(_image, _x, _y), do: :erlang.nif_error(:nif_not_loaded)
   def image_decode_qoi(_binary), do: :erlang.nif_error(:nif_not_loaded)
   def image_blur(_image, _sigma), do: :erlang.nif_error(:nif_not_loaded)
+  def image_pixels(_image), do: :erlang.nif_error(:nif_not_loaded)
+  def image_from_raw(_binary, _w, _h, _format, _stride), do: :erlang.nif_error(:nif_not_loaded)
+
+  # ------------------------
+  # Animation
+  # ------------------------
+  def anim_new(_path, _format, _fps, _plays, _png_opts), do: :erlang.nif_error(:nif_not_loaded)
+  def anim_add_frame(_anim, _canvas), do: :erlang.nif_error(:nif_not_loaded)
+  def anim_finish(_anim), do: :erlang.nif_error(:nif_not_loaded)
 
   # ------------------------
   # Styles
@@ -88,6 +128,9 @@ defmodule Blendend.Native do
   def pattern_set_transform(_pattern, _matrix), do: :erlang.nif_error(:nif_not_loaded)
   def pattern_reset_transform(_pattern), do: :erlang.nif_error(:nif_not_loaded)
 
+  def style_compile(_opts, _mode), do: :erlang.nif_error(:nif_not_loaded)
+  def style_mode(_style), do: :erlang.nif_error(:nif_not_loaded)
+
   # ------------------------
   # Path
   # ------------------------
@@ -177,11 +220,26 @@ defmodule Blendend.Native do
   def path_close(_p), do: :erlang.nif_error(:nif_not_loaded)
   def path_hit_test(_p, _x, _y), do: :erlang.nif_error(:nif_not_loaded)
   def path_hit_test(_p, _x, _y, _rule), do: :erlang.nif_error(:nif_not_loaded)
+  def path_hit_test_many(_p, _points, _rule, _threads), do: :erlang.nif_error(:nif_not_loaded)
+  def path_to_binary(_p), do: :erlang.nif_error(:nif_not_loaded)
+  def path_from_binary(_bin), do: :erlang.nif_error(:nif_not_loaded)
+  def path_from_svg_d(_d), do: :erlang.nif_error(:nif_not_loaded)
+  def path_index_new(_entries), do: :erlang.nif_error(:nif_not_loaded)
+  def path_index_insert(_index, _entries), do: :erlang.nif_error(:nif_not_loaded)
+  def path_index_size(_index), do: :erlang.nif_error(:nif_not_loaded)
+  def path_index_query_point(_index, _x, _y, _rule), do: :erlang.nif_error(:nif_not_loaded)
+  def path_index_query_rect(_index, _x, _y, _w, _h), do: :erlang.nif_error(:nif_not_loaded)
   def path_clear(_p), do: :erlang.nif_error(:nif_not_loaded)
   def path_equals(_p1, _p2), do: :erlang.nif_error(:nif_not_loaded)
   def path_fit_to(_p, _rect_tuple), do: :erlang.nif_error(:nif_not_loaded)
 
-  def path_flatten(_path, _tolerance), do: :erlang.nif_error(:nif_not_loaded)
+  def path_flatten(_path, _tolerance, _threads), do: :erlang.nif_error(:nif_not_loaded)
+  def path_simplify(_path, _tolerance, _algorithm, _matrix),
+    do: :erlang.nif_error(:nif_not_loaded)
+
+  def plot_decimate_m4(_xs, _ys, _x_min, _x_max, _width, _threads),
+    do: :erlang.nif_error(:nif_not_loaded)
+
   # ------------------------
   # Matrix
   # ------------------------
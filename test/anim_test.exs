@@ -0,0 +1,59 @@
+defmodule Blendend.AnimTest do
+  use ExUnit.Case, async: true
+
+  alias Blendend.{Anim, Canvas, Image}
+  alias Blendend.Canvas.Fill
+  alias Blendend.Style.Color
+
+  defp tmp_path(name) do
+    Path.join(System.tmp_dir!(), "blendend_anim_#{System.unique_integer([:positive])}_#{name}")
+  end
+
+  defp draw_frame(canvas, x) do
+    :ok = Canvas.clear(canvas, fill: Color.rgb!(255, 255, 255))
+    :ok = Fill.rect(canvas, x, 10, 12, 12, fill: Color.rgb!(30, 120, 220))
+  end
+
+  @tag :canvas
+  test "writes APNG and GIF, skipping unchanged frames" do
+    {:ok, canvas} = Canvas.new(48, 32)
+    apng = tmp_path("a.png")
+    gif = tmp_path("a.gif")
+
+    on_exit(fn ->
+      File.rm(apng)
+      File.rm(gif)
+    end)
+
+    for {path, format} <- [{apng, :apng}, {gif, :gif}] do
+      {:ok, anim} = Anim.new(path, format, 10, loop: 0)
+
+      # The third frame repeats the second one.
+      for x <- [2, 20, 20, 30] do
+        draw_frame(canvas, x)
+        assert :ok = Anim.add_frame(anim, canvas)
+      end
+
+      assert :ok = Anim.finish(anim)
+      assert {:error, :anim_closed} = Anim.add_frame(anim, canvas)
+    end
+
+    # acTL right after IHDR: three distinct frames, looping forever.
+    <<_sig::binary-8, _ihdr::binary-25, 8::32, "acTL", 3::32, 0::32, _::binary>> =
+      File.read!(apng)
+
+    # Decoders without APNG support show the first frame.
+    {:ok, first} = Image.from_data(File.read!(apng))
+    assert Image.pixel_at!(first, 5, 15) == {30, 120, 220, 255}
+    assert Image.pixel_at!(first, 25, 15) == {255, 255, 255, 255}
+
+    data = File.read!(gif)
+    assert <<"GIF89a", 48::little-16, 32::little-16, _::binary>> = data
+    assert :binary.last(data) == 0x3B
+
+    {:ok, small} = Canvas.new(10, 10)
+    {:ok, anim} = Anim.new(tmp_path("mismatch.gif"), :gif, 24)
+    assert :ok = Anim.add_frame(anim, canvas)
+    assert {:error, :anim_add_frame_size_mismatch} = Anim.add_frame(anim, small)
+  end
+end
@@ -19,6 +19,23 @@ defmodule Blendend.CanvasBasicTest do
     assert %{width: 64, height: 64} = decode_qoi!(c)
   end
 
+  @tag :canvas
+  test "new/3 with threads renders the same pixels as a synchronous canvas" do
+    {:ok, c} = Canvas.new(64, 64, threads: 2, command_queue_limit: 32)
+
+    :ok = Canvas.clear(c, fill: Blendend.Style.Color.rgb!(255, 255, 255, 255))
+    :ok = Fill.rect(c, 8, 8, 16, 16, fill: Blendend.Style.Color.rgb!(0, 0, 0, 255))
+
+    img = decode_qoi!(c)
+    assert pixel!(img, 10, 10) == {0, 0, 0, 255}
+    assert pixel!(img, 40, 40) == {255, 255, 255, 255}
+  end
+
+  @tag :canvas
+  test "new/3 rejects unknown options" do
+    assert {:error, :canvas_invalid_options} = Canvas.new(8, 8, bogus: 1)
+  end
+
   @tag :canvas
   test "clear/2 fills background with a solid color" do
     {:ok, c} = Canvas.new(8, 8)
@@ -73,4 +90,159 @@ defmodule Blendend.CanvasBasicTest do
     assert :ok = Canvas.set_fill_rule(c, :non_zero)
     assert :ok = Canvas.set_fill_rule(c, :even_odd)
   end
+
+  @tag :canvas
+  test "polygon/3 accepts packed f64 and f32 point binaries" do
+    white = Blendend.Style.Color.rgb!(255, 255, 255)
+    black = Blendend.Style.Color.rgb!(0, 0, 0)
+    points = [{4.0, 4.0}, {28.0, 6.0}, {16.0, 28.0}]
+
+    render = fn pts ->
+      {:ok, c} = Canvas.new(32, 32)
+      :ok = Canvas.clear(c, fill: white)
+      :ok = Fill.polygon(c, pts, fill: black)
+      Canvas.to_qoi!(c)
+    end
+
+    f64 = for {x, y} <- points, into: <<>>, do: <<x::float-native-64, y::float-native-64>>
+    f32 = for {x, y} <- points, into: <<>>, do: <<x::float-native-32, y::float-native-32>>
+
+    expected = render.(points)
+    assert render.(f64) == expected
+    assert render.({:f32, f32}) == expected
+
+    {:ok, c} = Canvas.new(8, 8)
+    assert {:error, _} = Fill.polygon(c, <<1, 2, 3>>, fill: black)
+  end
+
+  @tag :canvas
+  test "to_png_base64/1 matches to_png/1 and leaves the canvas drawable" do
+    {:ok, c} = Canvas.new(40, 30)
+    :ok = Canvas.clear(c, fill: Blendend.Style.Color.rgb!(255, 255, 255))
+
+    assert {:ok, b64} = Canvas.to_png_base64(c)
+    assert Base.decode64!(b64) == Canvas.to_png!(c)
+
+    :ok = Fill.rect(c, 0, 0, 10, 10, fill: Blendend.Style.Color.rgb!(0, 0, 0))
+    assert pixel!(decode_qoi!(c), 5, 5) == {0, 0, 0, 255}
+    assert Base.decode64!(Canvas.to_png_base64!(c)) == Canvas.to_png!(c)
+  end
+
+  @tag :canvas
+  test "write_file/4 streams PNG and QOI files matching the in-memory encoders" do
+    {:ok, c} = Canvas.new(70, 90)
+    :ok = Canvas.clear(c, fill: Blendend.Style.Color.rgb!(255, 255, 255))
+    :ok = Fill.circle(c, 35, 45, 30, fill: Blendend.Style.Color.rgb!(30, 120, 220))
+
+    dir = System.tmp_dir!()
+    qoi = Path.join(dir, "blendend_write_#{System.unique_integer([:positive])}.qoi")
+    png = Path.join(dir, "blendend_write_#{System.unique_integer([:positive])}.png")
+
+    on_exit(fn ->
+      File.rm(qoi)
+      File.rm(png)
+    end)
+
+    assert :ok = Canvas.write_file(c, qoi, :qoi, fsync: true)
+    assert ImageHelpers.decode_qoi!(File.read!(qoi)) == decode_qoi!(c)
+
+    assert :ok = Canvas.write_file(c, png, :png, compression: 1)
+    {:ok, from_file} = Blendend.Image.from_data(File.read!(png))
+    {:ok, from_binary} = Blendend.Image.from_data(Canvas.to_png!(c))
+
+    for x <- [0, 20, 35, 69], y <- [0, 45, 89] do
+      assert Blendend.Image.pixel_at!(from_file, x, y) ==
+               Blendend.Image.pixel_at!(from_binary, x, y)
+    end
+
+    assert {:error, :canvas_write_file_invalid_format} = Canvas.write_file(c, png, :gif)
+
+    written = File.read!(png)
+
+    assert {:error, :canvas_write_file_invalid_options} =
+             Canvas.write_file(c, png, :png, fsync: :maybe)
+
+    assert File.read!(png) == written
+    assert Path.wildcard(png <> ".tmp.*") == []
+  end
+
+  @tag :canvas
+  test "clone/1 and to_image/2 copy pixels that later drawing leaves alone" do
+    {:ok, c} = Canvas.new(20, 20)
+    :ok = Fill.rect(c, 0, 0, 10, 20, fill: Blendend.Style.Color.rgb!(200, 0, 0))
+
+    {:ok, copy} = Canvas.clone(c)
+    {:ok, snapshot} = Canvas.to_image(c)
+    {:ok, mask} = Canvas.to_image(c, format: :a8)
+
+    :ok = Fill.rect(c, 0, 0, 20, 20, fill: Blendend.Style.Color.rgb!(0, 0, 255))
+    :ok = Fill.rect(copy, 10, 0, 10, 20, fill: Blendend.Style.Color.rgb!(0, 200, 0))
+
+    assert Blendend.Image.pixel_at!(snapshot, 5, 5) == {200, 0, 0, 255}
+    assert Blendend.Image.pixel_at!(snapshot, 15, 5) == {0, 0, 0, 0}
+    assert {:ok, {20, 20}} = Blendend.Image.size(mask)
+
+    {:ok, from_copy} = Canvas.to_image(copy)
+    assert Blendend.Image.pixel_at!(from_copy, 5, 5) == {200, 0, 0, 255}
+    assert Blendend.Image.pixel_at!(from_copy, 15, 5) == {0, 200, 0, 255}
+
+    assert {:error, :canvas_to_image_invalid_format} = Canvas.to_image(c, format: :rgb24)
+  end
+
+  @tag :canvas
+  test "layers composite a group with one opacity" do
+    {:ok, c} = Canvas.new(40, 20)
+    red = Blendend.Style.Color.rgb!(255, 0, 0)
+
+    :ok = Canvas.begin_layer(c, {0, 0, 30, 20})
+    :ok = Fill.rect(c, 0, 0, 20, 20, fill: red)
+    :ok = Fill.rect(c, 10, 0, 30, 20, fill: red)
+    assert {:ok, image} = Canvas.to_image(c)
+    assert Blendend.Image.pixel_at!(image, 5, 5) == {0, 0, 0, 0}
+    :ok = Canvas.end_layer(c, alpha: 0.5)
+
+    {:ok, image} = Canvas.to_image(c)
+    {_, _, _, a} = single = Blendend.Image.pixel_at!(image, 5, 5)
+    assert Blendend.Image.pixel_at!(image, 15, 5) == single
+    assert a in 126..129
+    # Clipped to the layer bounds.
+    assert Blendend.Image.pixel_at!(image, 35, 5) == {0, 0, 0, 0}
+
+    assert {:error, :canvas_end_layer_no_layer} = Canvas.end_layer(c)
+  end
+
+  test "fill_instances draws every instance in its own color" do
+    {:ok, c} = Canvas.new(40, 20)
+    red = Blendend.Style.Color.rgb!(255, 0, 0)
+    positions =
+      for x <- [5.0, 25.0], into: <<>>, do: <<x::float-native-64, 10.0::float-native-64>>
+
+    :ok = Canvas.fill_instances(c, {:rect, 6, 6}, positions, fill: red)
+    {:ok, image} = Canvas.to_image(c)
+    assert Blendend.Image.pixel_at!(image, 5, 10) == {255, 0, 0, 255}
+    assert Blendend.Image.pixel_at!(image, 25, 10) == {255, 0, 0, 255}
+    assert Blendend.Image.pixel_at!(image, 15, 10) == {0, 0, 0, 0}
+
+    :ok =
+      Canvas.fill_instances(c, {:circle, 3}, [{5.0, 10.0}, {25.0, 10.0}],
+        colors: <<0, 0, 255, 255, 0, 255, 0, 255>>,
+        scales: <<1.0::float-native-64, 2.0::float-native-64>>
+      )
+
+    {:ok, image} = Canvas.to_image(c)
+    assert Blendend.Image.pixel_at!(image, 5, 10) == {0, 0, 255, 255}
+    assert Blendend.Image.pixel_at!(image, 29, 10) == {0, 255, 0, 255}
+
+    # Overlapping instances of one opaque color take the merged path; the
+    # overlap must still be filled, not cancelled out.
+    {:ok, c} = Canvas.new(40, 20)
+    :ok = Canvas.fill_instances(c, {:circle, 8}, [{14.0, 10.0}, {26.0, 10.0}], fill: red)
+    {:ok, image} = Canvas.to_image(c)
+    assert Blendend.Image.pixel_at!(image, 20, 10) == {255, 0, 0, 255}
+    assert Blendend.Image.pixel_at!(image, 14, 10) == {255, 0, 0, 255}
+    assert Blendend.Image.pixel_at!(image, 26, 10) == {255, 0, 0, 255}
+
+    assert {:error, :canvas_fill_instances_invalid_colors} =
+             Canvas.fill_instances(c, {:circle, 3}, positions, colors: <<0, 0, 0>>)
+  end
 end
@@ -0,0 +1,84 @@
+defmodule Blendend.CanvasExecTest do
+  use ExUnit.Case, async: true
+
+  alias Blendend.Canvas
+  alias Blendend.Canvas.{Fill, Stroke}
+  alias Blendend.Draw.Batch
+  alias Blendend.Style.Color
+
+  defp blank do
+    {:ok, c} = Canvas.new(64, 64)
+    :ok = Canvas.clear(c, fill: Color.rgb!(255, 255, 255))
+    c
+  end
+
+  @tag :canvas
+  test "exec/2 renders the same pixels as individual draw calls" do
+    red = Color.rgb!(255, 0, 0)
+    blue = Color.rgb!(0, 0, 255)
+
+    direct = blank()
+    :ok = Fill.rect(direct, 4, 4, 20, 20, fill: red)
+    :ok = Fill.circle(direct, 40, 40, 10, fill: blue, alpha: 0.5)
+    :ok = Canvas.translate(direct, 10, 0)
+    :ok = Stroke.line(direct, 0, 60, 40, 60, stroke: red, stroke_width: 3)
+
+    batched = blank()
+
+    batch =
+      Batch.new()
+      |> Batch.rect(4, 4, 20, 20, fill: red)
+      |> Batch.circle(40, 40, 10, fill: blue, alpha: 0.5)
+      |> Batch.translate(10, 0)
+      |> Batch.line(0, 60, 40, 60, stroke: red, stroke_width: 3)
+
+    assert :ok = Canvas.exec(batched, batch)
+    assert Canvas.to_qoi!(batched) == Canvas.to_qoi!(direct)
+  end
+
+  @tag :canvas
+  test "exec/2 restores the canvas state afterwards" do
+    c = blank()
+    :ok = Canvas.exec(c, Batch.new() |> Batch.translate(30, 30))
+    {:ok, m} = Canvas.user_transform(c)
+    assert Blendend.Matrix2D.to_list!(m) == [1.0, 0.0, 0.0, 1.0, 0.0, 0.0]
+  end
+
+  @tag :canvas
+  test "exec/2 re-applies the style after a restore" do
+    red = Color.rgb!(255, 0, 0)
+
+    batch =
+      Batch.new()
+      |> Batch.save()
+      |> Batch.rect(4, 4, 20, 20, fill: red)
+      |> Batch.restore()
+      |> Batch.rect(34, 34, 20, 20, fill: red)
+
+    c = blank()
+    assert :ok = Canvas.exec(c, batch)
+    {:ok, image} = Canvas.to_image(c)
+    assert Blendend.Image.pixel_at!(image, 44, 44) == {255, 0, 0, 255}
+  end
+
+  test "packed points must hold whole pairs" do
+    pair = <<1.0::float-native-64, 2.0::float-native-64>>
+    pair32 = <<1.0::float-native-32, 2.0::float-native-32>>
+    assert %Batch{} = Batch.polyline(Batch.new(), pair <> pair)
+    assert %Batch{} = Batch.polygon(Batch.new(), {:f32, pair32 <> pair32})
+
+    assert_raise ArgumentError, fn ->
+      Batch.polyline(Batch.new(), pair <> <<0.0::float-native-64>>)
+    end
+
+    assert_raise ArgumentError, fn ->
+      Batch.polygon(Batch.new(), {:f32, pair32 <> <<0.0::float-native-32>>})
+    end
+  end
+
+  @tag :canvas
+  test "malformed ops report their byte offset" do
+    c = blank()
+    assert {:error, {:canvas_exec_invalid_op, 1}} = Blendend.Native.canvas_exec(c, <<1, 0xFF>>)
+  end
+end
@@ -0,0 +1,58 @@
+defmodule Blendend.DisplayListTest do
+  use ExUnit.Case, async: true
+
+  alias Blendend.{Canvas, DisplayList}
+  alias Blendend.Draw.Batch
+  alias Blendend.Style.Color
+
+  defp blank(w, h) do
+    {:ok, c} = Canvas.new(w, h)
+    :ok = Canvas.clear(c, fill: Color.rgb!(255, 255, 255))
+    c
+  end
+
+  defp scene do
+    red = Color.rgb!(255, 0, 0)
+    blue = Color.rgb!(0, 0, 255)
+
+    Batch.new()
+    |> Batch.rect(4, 4, 20, 20, fill: red)
+    |> Batch.translate(10, 0)
+    |> Batch.circle(30, 40, 10, fill: blue, alpha: 0.5)
+    |> Batch.line(0, 60, 40, 60, stroke: red, stroke_width: 3)
+  end
+
+  @tag :canvas
+  test "replay/3 draws what exec/2 draws, at any scale" do
+    list = DisplayList.new!(scene())
+
+    direct = blank(64, 64)
+    :ok = Canvas.exec(direct, scene())
+    replayed = blank(64, 64)
+    assert :ok = DisplayList.replay(replayed, list)
+    assert Canvas.to_qoi!(replayed) == Canvas.to_qoi!(direct)
+
+    direct = blank(128, 128)
+    :ok = Canvas.scale(direct, 2, 2)
+    :ok = Canvas.exec(direct, scene())
+    replayed = blank(128, 128)
+    assert :ok = DisplayList.replay(replayed, list, transform: {2, 0, 0, 2, 0, 0})
+    assert Canvas.to_qoi!(replayed) == Canvas.to_qoi!(direct)
+  end
+
+  @tag :canvas
+  test "bounds/1 and clipped replay" do
+    list = DisplayList.new!(scene())
+    {x0, y0, x1, y1} = DisplayList.bounds!(list)
+    assert x0 <= 4.0 and y0 <= 4.0 and x1 >= 50.0 and y1 >= 61.5
+
+    c = blank(64, 64)
+    assert :ok = DisplayList.replay(c, list, clip: {0, 0, 32, 32})
+    {:ok, image} = Canvas.to_image(c)
+    assert Blendend.Image.pixel_at!(image, 10, 10) == {255, 0, 0, 255}
+    assert Blendend.Image.pixel_at!(image, 20, 60) == {255, 255, 255, 255}
+
+    assert {:error, {:display_list_new_invalid_op, 1}} =
+             Blendend.Native.display_list_new(<<1, 0xFF>>, {})
+  end
+end
@@ -4,6 +4,7 @@ defmodule Blendend.ImagePixelTest do
   alias Blendend.Canvas
   alias Blendend.Image
   alias Blendend.Style.Color
+  alias Blendend.Test.ImageHelpers
 
   test "pixel_at!/3 reads RGBA from a decoded PNG image" do
     {:ok, canvas} = Canvas.new(2, 2)
@@ -18,4 +19,160 @@ defmodule Blendend.ImagePixelTest do
     assert Image.pixel_at!(image, 1, 1) == {0, 255, 0, 255}
     assert Image.pixel_at!(image, 0, 1) == {0, 0, 0, 0}
   end
+
+  test "pixels/1 exposes the raw PRGB32 buffer of canvases and images" do
+    {:ok, canvas} = Canvas.new(3, 2)
+    :ok = Canvas.clear(canvas)
+    :ok = Canvas.Fill.rect(canvas, 1, 0, 1, 1, fill: Color.rgb!(255, 0, 0, 255))
+
+    assert {:ok, %{width: 3, height: 2, stride: stride, format: :prgb32, data: data}} =
+             Canvas.pixels(canvas)
+
+    assert byte_size(data) == stride * 2
+    <<_::binary-size(4), red::unsigned-native-32, _::binary>> = data
+    assert red == 0xFFFF0000
+
+    {:ok, image} = Image.from_data(Canvas.to_png!(canvas))
+    %{data: image_data, stride: image_stride} = Image.pixels!(image)
+    row = fn bin, stride, y -> binary_part(bin, y * stride, 3 * 4) end
+
+    assert row.(image_data, image_stride, 0) == row.(data, stride, 0)
+    assert row.(image_data, image_stride, 1) == row.(data, stride, 1)
+  end
+
+  test "pixels/1 data does not change when the canvas is drawn on" do
+    {:ok, canvas} = Canvas.new(4, 4)
+    :ok = Canvas.clear(canvas)
+    :ok = Canvas.translate(canvas, 1, 0)
+    %{data: before} = Canvas.pixels!(canvas)
+    snapshot = :binary.copy(before)
+
+    :ok = Canvas.Fill.rect(canvas, 0, 0, 2, 2, fill: Color.rgb!(255, 0, 0, 255))
+    assert before == snapshot
+
+    # Drawing goes on with the transform set before the export.
+    %{data: after_draw} = Canvas.pixels!(canvas)
+    <<first::unsigned-native-32, second::unsigned-native-32, _::binary>> = after_draw
+    assert {first, second} == {0, 0xFFFF0000}
+
+    # Views taken under a clip are copies too.
+    :ok = Canvas.Clip.to_rect(canvas, 0, 0, 4, 4)
+    %{data: clipped} = Canvas.pixels!(canvas)
+    :ok = Canvas.Fill.rect(canvas, 0, 0, 4, 4, fill: Color.rgb!(0, 0, 255, 255))
+    assert clipped == after_draw
+  end
+
+  test "from_raw/5 wraps native pixels and premultiplies straight RGBA" do
+    {:ok, canvas} = Canvas.new(4, 4)
+    :ok = Canvas.clear(canvas)
+    :ok = Canvas.Fill.rect(canvas, 0, 0, 2, 2, fill: Color.rgb!(0, 0, 255, 255))
+
+    %{data: data, width: w, height: h, stride: stride} = Canvas.pixels!(canvas)
+    image = Image.from_raw!(:binary.copy(data), w, h, :prgb32, stride)
+    assert Image.pixel_at!(image, 1, 1) == {0, 0, 255, 255}
+    assert Image.pixel_at!(image, 3, 3) == {0, 0, 0, 0}
+
+    rgba = <<255, 0, 0, 255, 0, 255, 0, 128>>
+    image = Image.from_raw!(rgba, 2, 1, :rgba)
+    assert Image.pixel_at!(image, 0, 0) == {255, 0, 0, 255}
+    assert {0, 255, 0, 128} = Image.pixel_at!(image, 1, 0)
+
+    assert {:error, :image_from_raw_invalid_stride} = Image.from_raw(<<0, 0, 0>>, 1, 1, :bgra)
+  end
+
+  test "to_png/2 encoder options round-trip the same pixels" do
+    {:ok, canvas} = Canvas.new(24, 16)
+    :ok = Canvas.clear(canvas)
+    :ok = Canvas.Fill.rect(canvas, 0, 0, 12, 16, fill: Color.rgb!(255, 0, 0, 128))
+    :ok = Canvas.Fill.circle(canvas, 16, 8, 6, fill: Color.rgb!(20, 200, 90))
+
+    {:ok, reference} = Image.from_data(Canvas.to_png!(canvas))
+
+    close? = fn {r0, g0, b0, a0}, {r1, g1, b1, a1} ->
+      a0 == a1 and abs(r0 - r1) <= 1 and abs(g0 - g1) <= 1 and abs(b0 - b1) <= 1
+    end
+
+    for opts <- [
+          [compression: 0],
+          [compression: 9, filter: :paeth],
+          [filter: :none],
+          [filter: :adaptive],
+          [fast: true]
+        ] do
+      {:ok, image} = Image.from_data(Canvas.to_png!(canvas, opts))
+
+      for x <- 0..23, y <- 0..15 do
+        assert close?.(Image.pixel_at!(image, x, y), Image.pixel_at!(reference, x, y))
+      end
+    end
+
+    {:ok, opaque} = Image.from_data(Canvas.to_png!(canvas, opaque: true))
+    assert Image.pixel_at!(opaque, 16, 8) == {20, 200, 90, 255}
+    assert close?.(Image.pixel_at!(opaque, 2, 2), {128, 0, 0, 255})
+
+    assert {:error, :canvas_to_png_invalid_options} = Canvas.to_png(canvas, compression: 12)
+  end
+
+  test "to_png/2 with several threads stitches stripes into one valid PNG" do
+    {:ok, canvas} = Canvas.new(40, 300)
+    :ok = Canvas.clear(canvas, fill: Color.rgb!(255, 255, 255))
+    :ok = Canvas.Fill.rect(canvas, 0, 60, 40, 140, fill: Color.rgb!(30, 120, 220, 200))
+    :ok = Canvas.Fill.circle(canvas, 20, 150, 18, fill: Color.rgb!(220, 40, 40))
+
+    {:ok, single} = Image.from_data(Canvas.to_png!(canvas, threads: 1))
+    {:ok, striped} = Image.from_data(Canvas.to_png!(canvas, threads: 4))
+
+    for x <- [0, 20, 39], y <- [0, 63, 64, 75, 149, 150, 224, 225, 299] do
+      assert Image.pixel_at!(striped, x, y) == Image.pixel_at!(single, x, y)
+    end
+  end
+
+  test "export_delta/2 encodes only the regions drawn since the last export" do
+    {:ok, canvas} = Canvas.new(200, 100)
+    :ok = Canvas.clear(canvas, fill: Color.rgb!(255, 255, 255))
+
+    assert {:ok, [%{x: 0, y: 0, width: 200, height: 100}]} = Canvas.export_delta(canvas)
+    assert {:ok, []} = Canvas.export_delta(canvas)
+
+    :ok = Canvas.Fill.rect(canvas, 20, 30, 10, 10, fill: Color.rgb!(255, 0, 0))
+    :ok = Canvas.translate(canvas, 150, 0)
+    :ok = Canvas.Fill.circle(canvas, 10, 50, 5, fill: Color.rgb!(0, 0, 255))
+
+    {:ok, rects} = Canvas.dirty_rects(canvas)
+    assert length(rects) == 2
+
+    assert {:ok, deltas} = Canvas.export_delta(canvas, format: :qoi)
+    assert Enum.map(deltas, &Map.delete(&1, :data)) == rects
+
+    red = Enum.find(deltas, &(&1.x < 100))
+    assert red.x <= 20 and red.y <= 30 and red.x + red.width >= 30 and red.y + red.height >= 40
+    assert red.width < 20 and red.height < 20
+
+    %{data: pixels} = ImageHelpers.decode_qoi!(red.data)
+    assert byte_size(pixels) == red.width * red.height * 4
+    assert ImageHelpers.pixel_at(ImageHelpers.decode_qoi!(red.data), 25 - red.x, 35 - red.y) ==
+             {255, 0, 0, 255}
+
+    blue = Enum.find(deltas, &(&1.x >= 100))
+    assert blue.x <= 155 and blue.x + blue.width >= 165
+
+    assert {:ok, []} = Canvas.dirty_rects(canvas)
+  end
+
+  test "dirty_rects/1 records a layer once, as its box on the canvas" do
+    {:ok, canvas} = Canvas.new(200, 100)
+    {:ok, _} = Canvas.export_delta(canvas)
+
+    :ok = Canvas.begin_layer(canvas, {40, 20, 30, 30})
+    :ok = Canvas.clear(canvas, fill: Color.rgb!(0, 0, 255))
+    :ok = Canvas.begin_layer(canvas, {50, 30, 10, 10})
+    :ok = Canvas.Fill.circle(canvas, 55, 35, 20, fill: Color.rgb!(255, 0, 0))
+    :ok = Canvas.end_layer(canvas)
+    assert {:ok, []} = Canvas.dirty_rects(canvas)
+
+    :ok = Canvas.end_layer(canvas)
+    assert {:ok, [%{x: x, y: y, width: w, height: h}]} = Canvas.dirty_rects(canvas)
+    assert x in 39..40 and y in 19..20
+    assert x + w in 70..71 and y + h in 50..51
+  end
 end
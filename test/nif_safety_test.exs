@@ -105,4 +105,35 @@ defmodule Blendend.NifSafetyTest do
     max_us = Enum.max(times_us)
     assert max_us < 6_000
   end
+
+  @tag :safety
+  test "concurrent access to one canvas is serialized" do
+    {:ok, canvas} = Canvas.new(64, 64)
+    color = Blendend.Style.Color.rgb!(200, 40, 40)
+
+    results =
+      1..8
+      |> Task.async_stream(
+        fn i ->
+          for j <- 1..200 do
+            if rem(j, 50) == 0 do
+              Canvas.to_png(canvas)
+            else
+              Canvas.Fill.rect(canvas, rem(i * j, 60), rem(j, 60), 4, 4, fill: color)
+            end
+          end
+        end,
+        timeout: :infinity
+      )
+      |> Enum.flat_map(fn {:ok, rs} -> rs end)
+
+    assert Enum.all?(results, fn
+             :ok -> true
+             {:ok, png} when is_binary(png) -> true
+             {:error, :canvas_busy} -> true
+             _ -> false
+           end)
+
+    assert {:ok, _} = Canvas.to_png(canvas)
+  end
 end
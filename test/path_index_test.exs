@@ -0,0 +1,41 @@
+defmodule Blendend.PathIndexTest do
+  use ExUnit.Case, async: true
+  alias Blendend.{Path, PathIndex}
+
+  defp square(x, y, size) do
+    Path.new!()
+    |> Path.move_to!(x, y)
+    |> Path.line_to!(x + size, y)
+    |> Path.line_to!(x + size, y + size)
+    |> Path.line_to!(x, y + size)
+    |> Path.close!()
+  end
+
+  test "point queries hit-test the candidates exactly" do
+    grid = for i <- 0..99, do: {i, square(rem(i, 10) * 20, div(i, 10) * 20, 10)}
+    index = PathIndex.new!(grid)
+    assert PathIndex.size!(index) == 100
+
+    assert PathIndex.query_point!(index, 45, 65) == [32]
+    assert PathIndex.query_point!(index, 55, 65) == []
+    assert PathIndex.pick!(index, 55, 65) == nil
+
+    # A later path on top of 32.
+    :ok = PathIndex.insert(index, [{1000, square(40, 60, 30)}])
+    assert PathIndex.query_point!(index, 45, 65) == [32, 1000]
+    assert PathIndex.pick!(index, 45, 65) == 1000
+    assert PathIndex.pick!(index, 55, 65) == 1000
+
+    ring = Path.add_circle!(Path.add_circle!(Path.new!(), 300, 300, 40), 300, 300, 20)
+    :ok = PathIndex.insert(index, [{2000, ring}])
+    assert PathIndex.query_point!(index, 300, 300, fill_rule: :even_odd) == []
+    assert PathIndex.query_point!(index, 300, 300) == [2000]
+  end
+
+  test "rect queries compare bounding boxes" do
+    index = PathIndex.new!(for i <- 0..9, do: {i, square(i * 20, 0, 10)})
+    assert PathIndex.query_rect!(index, {15, -5, 30, 10}) == [1, 2]
+    assert PathIndex.query_rect!(index, {500, 0, 10, 10}) == []
+    assert {:error, :path_index_new_invalid_entries} = PathIndex.new([{:a, square(0, 0, 1)}])
+  end
+end
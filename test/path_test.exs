@@ -32,4 +32,117 @@ defmodule Blendend.PathTest do
     a2 = Path.add_path!(a, b)
     assert Path.vertex_count!(a2) == count + Path.vertex_count!(b)
   end
+
+  test "hit_test_many agrees with hit_test, on the grid path too" do
+    ring =
+      Path.new!()
+      |> Path.add_circle!(50, 50, 40)
+      |> Path.add_circle!(50, 50, 20)
+      |> Path.move_to!(0, 0)
+      |> Path.line_to!(30, 0)
+      |> Path.line_to!(0, 30)
+
+    assert Path.hit_test_many!(ring, [{50, 50}, {50, 20}, {5, 5}, {200, 0}], :even_odd) ==
+             <<0, 1, 1, 0>>
+
+    :rand.seed(:exsss, {1, 2, 3})
+    points = for _ <- 1..70_000, do: {:rand.uniform() * 120 - 10, :rand.uniform() * 120 - 10}
+    codes = Path.hit_test_many!(ring, points, :even_odd)
+    assert byte_size(codes) == 70_000
+
+    points
+    |> Enum.with_index()
+    |> Enum.take_every(97)
+    |> Enum.each(fn {{x, y}, i} ->
+      expected = %{out: 0, in: 1, part: 2}[Path.hit_test(ring, x, y, :even_odd)]
+      assert :binary.at(codes, i) == expected
+    end)
+
+    assert {:error, :path_hit_test_many_invalid_points} = Path.hit_test_many(ring, <<1, 2, 3>>)
+  end
+
+  test "flatten keeps lines within tolerance, threaded or not" do
+    circle = Path.new!() |> Path.add_circle!(50, 50, 40)
+    flat = Path.flatten!(circle, 0.1)
+
+    for {{x, y}, _} <- Path.segments(flat) do
+      assert_in_delta :math.sqrt((x - 50) * (x - 50) + (y - 50) * (y - 50)), 40, 0.1
+    end
+
+    big = Path.new!() |> Path.add_circle!(0, 0, 1000)
+    serial = Path.flatten!(big, 1.0e-6)
+    assert Path.vertex_count!(serial) > 65_536
+    assert Path.to_binary!(Path.flatten!(big, 1.0e-6, threads: 4)) == Path.to_binary!(serial)
+
+    assert {:error, :path_flatten_invalid_tolerance} = Path.flatten(circle, 0)
+  end
+
+  test "simplify drops vertices within tolerance" do
+    track =
+      Enum.reduce(1..999, Path.new!() |> Path.move_to!(0, 0), fn i, p ->
+        Path.line_to!(p, i, i + rem(i, 2) * 0.1)
+      end)
+
+    assert Path.vertex_count!(Path.simplify!(track, 0.5)) == 2
+    assert Path.vertex_count!(Path.simplify!(track, 0.5, :visvalingam)) < 50
+    assert Path.vertex_count!(Path.simplify!(track, 0.01)) == 1000
+
+    zoomed = Blendend.Matrix2D.identity!() |> Blendend.Matrix2D.scale!(100, 100)
+    assert Path.vertex_count!(Path.simplify!(track, :auto, :rdp, transform: zoomed)) > 500
+
+    # Stretches distances 100 times but keeps areas, so :visvalingam still
+    # drops the zig-zag.
+    squashed = Blendend.Matrix2D.identity!() |> Blendend.Matrix2D.scale!(100, 0.01)
+    simplified = Path.simplify!(track, :auto, :visvalingam, transform: squashed)
+    assert Path.vertex_count!(simplified) < 50
+
+    assert {:error, :path_simplify_invalid_algorithm} = Path.simplify(track, 1, :fast)
+  end
+
+  test "to_binary/from_binary round-trip" do
+    p =
+      Path.new!()
+      |> Path.move_to!(10, 10)
+      |> Path.quad_to!(20, 0, 30, 10)
+      |> Path.cubic_to!(40, 20, 50, 0, 60, 10)
+      |> Path.close!()
+      |> Path.add_circle!(100, 100, 5)
+
+    bin = Path.to_binary!(p)
+    n = Path.vertex_count!(p)
+    assert <<"BLP1", ^n::little-32, _::binary>> = bin
+    assert Path.equal?(Path.from_binary!(bin), p)
+    assert Path.to_binary!(Path.from_binary!(Path.to_binary!(Path.new!()))) == <<"BLP1", 0::32>>
+
+    assert {:error, :path_from_binary_invalid_binary} =
+             Path.from_binary(binary_part(bin, 0, byte_size(bin) - 1))
+
+    assert {:error, :path_from_binary_invalid_commands} =
+             Path.from_binary(<<"BLP1", 1::little-32, 2, 0::56, 0::128>>)
+  end
+
+  test "from_svg_d builds the same path as the builder calls" do
+    d = "M10,10 h20 v10 l-5-5 5 5 z m5 5 c1 1 2 2 3 3 s4 4 5 5 Q40 40 50 40 T60 40"
+    svg = Path.from_svg_d!(d)
+
+    built =
+      Path.new!()
+      |> Path.move_to!(10, 10)
+      |> Path.line_to!(30, 10)
+      |> Path.line_to!(30, 20)
+      |> Path.line_to!(25, 15)
+      |> Path.line_to!(30, 20)
+      |> Path.close!()
+      |> Path.move_to!(15, 15)
+      |> Path.cubic_to!(16, 16, 17, 17, 18, 18)
+      |> Path.cubic_to!(19, 19, 22, 22, 23, 23)
+      |> Path.quad_to!(40, 40, 50, 40)
+      |> Path.quad_to!(60, 40, 60, 40)
+
+    assert Path.equal?(svg, built)
+    assert Path.vertex_count!(Path.from_svg_d!("M0 0a10 10 0 1010 10")) > 2
+
+    assert {:error, {:path_from_svg_d_expected_number, 8}} = Path.from_svg_d("M0 0 L 1")
+    assert {:error, {:path_from_svg_d_expected_move, 0}} = Path.from_svg_d("L0 0")
+  end
 end
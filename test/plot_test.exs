@@ -0,0 +1,36 @@
+defmodule Blendend.PlotTest do
+  use ExUnit.Case, async: true
+  alias Blendend.Plot
+
+  test "decimate_m4 keeps first, last, min and max per column" do
+    n = 600_000
+    ys = for i <- 0..(n - 1), do: :math.sin(i * 0.0037) * i
+    xs_bin = for i <- 0..(n - 1), into: <<>>, do: <<i * 1.0::float-native-64>>
+    ys_bin = for y <- ys, into: <<>>, do: <<y::float-native-64>>
+
+    points = Plot.decimate_m4!(xs_bin, ys_bin, {0, n}, 60)
+    assert byte_size(points) <= 60 * 4 * 16
+
+    kept = for <<x::float-native-64, y::float-native-64 <- points>>, do: {x, y}
+    assert kept == Enum.sort(kept)
+
+    columns = Enum.group_by(kept, fn {x, _} -> trunc(x / 10_000) end)
+
+    ys
+    |> Enum.chunk_every(10_000)
+    |> Enum.with_index()
+    |> Enum.each(fn {chunk, c} ->
+      col = columns[c]
+      assert {c * 10_000.0, hd(chunk)} == hd(col)
+      assert {c * 10_000.0 + 9_999, List.last(chunk)} == List.last(col)
+      assert Enum.min(chunk) == col |> Enum.map(&elem(&1, 1)) |> Enum.min()
+      assert Enum.max(chunk) == col |> Enum.map(&elem(&1, 1)) |> Enum.max()
+    end)
+
+    assert {:error, :plot_decimate_m4_invalid_ys} =
+             Plot.decimate_m4(xs_bin, <<0.0::float-native-64>>, {0, n}, 60)
+
+    assert {:error, :plot_decimate_m4_invalid_width} =
+             Plot.decimate_m4(xs_bin, ys_bin, {0, n}, 65_537)
+  end
+end
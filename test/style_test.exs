@@ -0,0 +1,45 @@
+defmodule Blendend.StyleTest do
+  use ExUnit.Case, async: true
+
+  alias Blendend.{Canvas, Style}
+  alias Blendend.Canvas.{Fill, Stroke}
+  alias Blendend.Style.Color
+
+  defp render(fun) do
+    {:ok, c} = Canvas.new(48, 48)
+    :ok = Canvas.clear(c, fill: Color.rgb!(255, 255, 255))
+    fun.(c)
+    Canvas.to_qoi!(c)
+  end
+
+  @tag :canvas
+  test "compiled styles render like the keyword lists they came from" do
+    fill_opts = [fill: Color.rgb!(200, 30, 30), alpha: 0.5, comp_op: :multiply]
+    stroke_opts = [stroke: Color.rgb!(0, 0, 200), stroke_width: 3, join: :round]
+
+    fill = Style.compile!(fill_opts)
+    stroke = Style.compile!(stroke_opts)
+
+    assert Style.mode(fill) == :fill
+    assert Style.mode(stroke) == :stroke
+
+    expected =
+      render(fn c ->
+        :ok = Fill.circle(c, 24, 24, 16, fill_opts)
+        :ok = Stroke.rect(c, 6, 6, 30, 30, Keyword.put(stroke_opts, :stroke_width, 3.0))
+      end)
+
+    assert render(fn c ->
+             :ok = Fill.circle(c, 24, 24, 16, fill)
+             :ok = Stroke.rect(c, 6, 6, 30, 30, stroke)
+           end) == expected
+  end
+
+  test "compile/1 rejects malformed values" do
+    assert {:error, :style_compile_invalid_opts} = Style.compile(fill: :not_a_color)
+    assert_raise Blendend.Error, fn -> Style.compile!(stroke_width: "wide") end
+    assert {:error, :style_compile_invalid_opts} = Style.compile(stroke_cap: :rund)
+    assert {:error, :style_compile_invalid_opts} = Style.compile(stroke_join: :mitre)
+    assert {:error, :style_compile_invalid_opts} = Style.compile(comp_op: :typo)
+  end
+end
@@ -0,0 +1,57 @@
+defmodule Blendend.TiledTest do
+  use ExUnit.Case, async: true
+
+  alias Blendend.{Canvas, Image, Tiled}
+  alias Blendend.Draw.Batch
+  alias Blendend.Style.Color
+
+  defp scene do
+    Batch.new()
+    |> Batch.rect(0, 0, 40, 50, fill: Color.rgb!(255, 255, 255))
+    |> Batch.circle(20, 24, 15, fill: Color.rgb!(30, 120, 220))
+    |> Batch.reset_transform()
+    |> Batch.line(0, 3, 40, 47, stroke: Color.rgb!(220, 40, 40), stroke_width: 3)
+  end
+
+  defp tmp_path(name) do
+    Path.join(System.tmp_dir!(), "blendend_tiled_#{System.unique_integer([:positive])}_#{name}")
+  end
+
+  @tag :canvas
+  test "render/5 matches a canvas render across band boundaries" do
+    {:ok, canvas} = Canvas.new(40, 50)
+    :ok = Canvas.exec(canvas, scene())
+    {:ok, reference} = Image.from_data(Canvas.to_png!(canvas))
+
+    png = tmp_path("scene.png")
+    raw = tmp_path("scene.raw")
+
+    on_exit(fn ->
+      File.rm(png)
+      File.rm(raw)
+    end)
+
+    assert :ok = Tiled.render(png, 40, 50, scene(), tile_height: 7)
+    assert :ok = Tiled.render(raw, 40, 50, fn _ -> scene() end, format: :raw, tile_height: 7)
+    assert File.stat!(raw).size == 40 * 50 * 4
+
+    {:ok, tiled_png} = Image.from_data(File.read!(png))
+    {:ok, tiled_raw} = Image.from_raw(File.read!(raw), 40, 50, :prgb32)
+
+    for x <- [0, 10, 20, 35], y <- [0, 6, 7, 13, 14, 24, 48, 49] do
+      expected = Image.pixel_at!(reference, x, y)
+      assert Image.pixel_at!(tiled_png, x, y) == expected
+      assert Image.pixel_at!(tiled_raw, x, y) == expected
+    end
+  end
+
+  @tag :canvas
+  test "render/5 reports bad ops without leaving a file behind" do
+    path = tmp_path("bad.png")
+
+    assert {:error, {:tiled_render_invalid_op, 0}} =
+             Tiled.render(path, 8, 8, %Batch{ops: [<<0xFF>>]})
+
+    refute File.exists?(path)
+  end
+end